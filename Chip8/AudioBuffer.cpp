@@ -0,0 +1,100 @@
+#include "AudioBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+AudioBuffer::AudioBuffer(u32 capacity, u32 sample_rate)
+		: m_sample_rate(sample_rate ? sample_rate : default_sample_rate),
+		m_head(0),
+		m_starved(false),
+		m_underruns(0),
+		m_latency_samples(0),
+		m_tail(0),
+		m_dropped_samples(0)
+{
+		u32 size = 1;
+
+		while (size < capacity)
+		{
+				size <<= 1;
+		}
+
+		m_samples.resize(size);
+		memset(m_samples.data(), silence, size);
+		m_mask = size - 1;
+}
+
+AudioBuffer::~AudioBuffer()
+{
+}
+
+u32 AudioBuffer::GetBuffered()
+{
+		return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_relaxed);
+}
+
+u32 AudioBuffer::GetCapacity()
+{
+		return static_cast<u32>(m_samples.size());
+}
+
+u64 AudioBuffer::GetDroppedSamples()
+{
+		return m_dropped_samples.load(std::memory_order_relaxed);
+}
+
+double AudioBuffer::GetLatency()
+{
+		return static_cast<double>(m_latency_samples.load(std::memory_order_relaxed)) / m_sample_rate;
+}
+
+u32 AudioBuffer::GetSampleRate()
+{
+		return m_sample_rate;
+}
+
+u64 AudioBuffer::GetUnderruns()
+{
+		return m_underruns.load(std::memory_order_relaxed);
+}
+
+u32 AudioBuffer::Read(u8 *samples, u32 count)
+{
+		u32 head = m_head.load(std::memory_order_relaxed);
+		u32 buffered = m_tail.load(std::memory_order_acquire) - head;
+		u32 available = std::min(buffered, count);
+		u32 offset = head & m_mask;
+		u32 first = std::min(available, GetCapacity() - offset);
+
+		memcpy(samples, &m_samples[offset], first);
+		memcpy(samples + first, &m_samples[0], available - first);
+		memset(samples + available, silence, count - available);
+		m_head.store(head + available, std::memory_order_release);
+		m_latency_samples.store(buffered, std::memory_order_relaxed);
+
+		// Count each time the buffer runs dry rather than every short read, so
+		// a producer that stops on purpose counts once.
+		if (available < count && !m_starved)
+				m_underruns.fetch_add(1, std::memory_order_relaxed);
+
+		m_starved = available < count;
+
+		return available;
+}
+
+u32 AudioBuffer::Write(const u8 *samples, u32 count)
+{
+		u32 tail = m_tail.load(std::memory_order_relaxed);
+		u32 space = GetCapacity() - (tail - m_head.load(std::memory_order_acquire));
+		u32 written = std::min(space, count);
+		u32 offset = tail & m_mask;
+		u32 first = std::min(written, GetCapacity() - offset);
+
+		memcpy(&m_samples[offset], samples, first);
+		memcpy(&m_samples[0], samples + first, written - first);
+		m_tail.store(tail + written, std::memory_order_release);
+
+		if (written < count)
+				m_dropped_samples.fetch_add(count - written, std::memory_order_relaxed);
+
+		return written;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Cpu.h"
+#include <atomic>
+#include <vector>
+
+// Carries unsigned 8-bit mono samples from one producer thread to one
+// consumer thread without either of them ever waiting. Writes that don't fit
+// are dropped and reads that come up short are padded with silence, so the
+// producer never stalls on a slow consumer and the consumer never stalls on
+// a slow producer. Both are counted, along with how much audio was buffered
+// at the last read, which is the latency the buffer adds.
+class AudioBuffer
+{
+public:
+		static const u8 silence = 0x80;
+		static const u32 default_sample_rate = 44100;
+
+		// The capacity is rounded up to a power of two.
+		AudioBuffer(u32 capacity, u32 sample_rate = default_sample_rate);
+		~AudioBuffer();
+
+		u32 GetCapacity();
+		u32 GetSampleRate();
+
+		u32 Write(const u8 *samples, u32 count);
+
+		u32 Read(u8 *samples, u32 count);
+		u32 GetBuffered();
+
+		// Safe to call from any thread.
+		u64 GetDroppedSamples();
+		double GetLatency();
+		u64 GetUnderruns();
+
+private:
+		std::vector<u8> m_samples;
+		u32 m_mask;
+		u32 m_sample_rate;
+
+		alignas(64) std::atomic<u32> m_head;
+		bool m_starved;
+		std::atomic<u64> m_underruns;
+		std::atomic<u32> m_latency_samples;
+
+		alignas(64) std::atomic<u32> m_tail;
+		std::atomic<u64> m_dropped_samples;
+};
@@ -0,0 +1,31 @@
+#include "AudioDevice.h"
+#include <algorithm>
+
+AudioDevice::AudioDevice(AudioBuffer &buffer, QObject *parent)
+		: QIODevice(parent),
+		m_buffer(buffer)
+{
+}
+
+AudioDevice::~AudioDevice()
+{
+}
+
+bool AudioDevice::isSequential() const
+{
+		return true;
+}
+
+qint64 AudioDevice::readData(char *data, qint64 max_size)
+{
+		u32 size = static_cast<u32>(std::min<qint64>(max_size, m_buffer.GetCapacity()));
+
+		m_buffer.Read(reinterpret_cast<u8 *>(data), size);
+
+		return size;
+}
+
+qint64 AudioDevice::writeData(const char * /*data*/, qint64 /*max_size*/)
+{
+		return -1;
+}
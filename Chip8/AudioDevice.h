@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QtCore\qiodevice.h>
+#include "AudioBuffer.h"
+
+// Lets QAudioOutput pull samples straight from an AudioBuffer on its own
+// schedule. Reads always return as much as was asked for, padded with
+// silence, so the output never stops and restarts when the buffer runs dry.
+class AudioDevice : public QIODevice
+{
+public:
+		AudioDevice(AudioBuffer &buffer, QObject *parent = 0);
+		~AudioDevice();
+
+		bool isSequential() const override;
+
+protected:
+		qint64 readData(char *data, qint64 max_size) override;
+		qint64 writeData(const char *data, qint64 max_size) override;
+
+private:
+		AudioBuffer &m_buffer;
+};
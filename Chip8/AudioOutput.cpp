@@ -0,0 +1,68 @@
+#include "AudioOutput.h"
+
+AudioOutput::AudioOutput(AudioBuffer &buffer, u32 period)
+		: m_buffer(buffer),
+		m_period(period ? period : default_period),
+		m_samples(m_period),
+		m_running(false)
+{
+		m_sink = [](const u8 * /*samples*/, u32 /*count*/) {};
+}
+
+AudioOutput::~AudioOutput()
+{
+		Stop();
+}
+
+double AudioOutput::GetLatency()
+{
+		return m_buffer.GetLatency() + static_cast<double>(m_period) / m_buffer.GetSampleRate();
+}
+
+bool AudioOutput::IsRunning()
+{
+		return m_running.load();
+}
+
+u32 AudioOutput::Pull()
+{
+		u32 read = m_buffer.Read(m_samples.data(), m_period);
+
+		m_sink(m_samples.data(), m_period);
+
+		return read;
+}
+
+void AudioOutput::Run()
+{
+		Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(static_cast<double>(m_period) / m_buffer.GetSampleRate()));
+		Clock::time_point due = Clock::now();
+
+		while (m_running.load(std::memory_order_relaxed))
+		{
+				Pull();
+				due += period;
+				std::this_thread::sleep_until(due);
+		}
+}
+
+void AudioOutput::SetSink(Sink sink)
+{
+		m_sink = sink;
+}
+
+void AudioOutput::Start()
+{
+		if (m_running.exchange(true))
+				return;
+
+		m_thread = std::thread(&AudioOutput::Run, this);
+}
+
+void AudioOutput::Stop()
+{
+		if (!m_running.exchange(false))
+				return;
+
+		m_thread.join();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "AudioBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Drains an AudioBuffer into a sink one period at a time, paced by the host
+// clock like a sound card would be, for running the audio path without one.
+// The default sink throws the samples away; a WavSink records them. Every
+// period reaches the sink whole, padded with silence when the producer fell
+// behind.
+class AudioOutput
+{
+public:
+		using Clock = std::chrono::steady_clock;
+		using Sink = std::function<void(const u8 *samples, u32 count)>;
+
+		static const u32 default_period = 512;
+
+		AudioOutput(AudioBuffer &buffer, u32 period = default_period);
+		~AudioOutput();
+
+		void SetSink(Sink sink);
+
+		// Hands one period to the sink and returns how many of its samples
+		// came from the buffer.
+		u32 Pull();
+
+		void Start();
+		void Stop();
+		bool IsRunning();
+
+		// Seconds from a sample being written to the buffer to it reaching the
+		// sink: what was buffered at the last pull plus the period it went out
+		// in.
+		double GetLatency();
+
+private:
+		AudioBuffer &m_buffer;
+		u32 m_period;
+		std::vector<u8> m_samples;
+		Sink m_sink;
+
+		std::thread m_thread;
+		std::atomic<bool> m_running;
+
+		void Run();
+};
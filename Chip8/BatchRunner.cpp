@@ -0,0 +1,171 @@
+#include "BatchRunner.h"
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+		const u64 fnv_offset_basis = 0xCBF29CE484222325;
+		const u64 fnv_prime = 0x100000001B3;
+
+		u64 HashBytes(u64 hash, const void *data, size_t size)
+		{
+				const u8 *bytes = static_cast<const u8 *>(data);
+
+				for (size_t byte = 0; byte < size; ++byte)
+				{
+						hash = (hash ^ bytes[byte]) * fnv_prime;
+				}
+
+				return hash;
+		}
+}
+
+BatchRunner::BatchRunner(u32 threads)
+		: m_threads(threads)
+{
+		if (!m_threads)
+				m_threads = std::max(1U, std::thread::hardware_concurrency());
+}
+
+BatchRunner::~BatchRunner()
+{
+}
+
+u32 BatchRunner::GetThreadCount()
+{
+		return m_threads;
+}
+
+u64 BatchRunner::Hash(const Result &result)
+{
+		u64 hash = fnv_offset_basis;
+
+		hash = HashBytes(hash, result.screen, sizeof result.screen);
+		hash = HashBytes(hash, result.data_registers, sizeof result.data_registers);
+		hash = HashBytes(hash, &result.program_counter, sizeof result.program_counter);
+		hash = HashBytes(hash, &result.index, sizeof result.index);
+
+		return hash;
+}
+
+std::vector<BatchRunner::Result> BatchRunner::Run(const std::vector<Job> &jobs)
+{
+		std::vector<Result> results(jobs.size());
+		u32 thread_count = static_cast<u32>(std::min<size_t>(m_threads, jobs.size()));
+
+		if (!thread_count)
+				return results;
+
+		std::vector<Worker> workers(thread_count);
+
+		for (u32 job = 0; job < jobs.size(); ++job)
+		{
+				workers[job % thread_count].jobs.push_back(job);
+		}
+
+		auto work = [&](u32 worker)
+		{
+				u32 job;
+
+				while (Take(workers, worker, job))
+				{
+						results[job] = RunJob(jobs[job]);
+				}
+		};
+
+		std::vector<std::thread> threads;
+
+		for (u32 worker = 1; worker < thread_count; ++worker)
+		{
+				threads.emplace_back(work, worker);
+		}
+
+		work(0);
+
+		for (auto &thread : threads)
+		{
+				thread.join();
+		}
+
+		return results;
+}
+
+BatchRunner::Result BatchRunner::RunJob(const Job &job)
+{
+		Cpu cpu;
+		TraceRecorder recorder;
+		Result result;
+		auto run = [&](u32 cycles)
+		{
+				if (recorder.IsOpen())
+						cpu.Run(cycles, recorder);
+				else
+						cpu.Run(cycles);
+		};
+
+		if (!job.trace_file.empty())
+				recorder.Open(job.trace_file);
+
+		cpu.SetSeed(job.seed);
+		cpu.SetCyclesPerTick(job.cycles_per_tick);
+		cpu.SetQuirks(job.quirks);
+		result.loaded = cpu.LoadProgram(job.program, job.program_size);
+
+		if (result.loaded)
+		{
+				for (const auto &key_event : job.input)
+				{
+						if (key_event.cycle > job.cycles || cpu.GetFault() != Cpu::Fault::none)
+								break;
+
+						if (key_event.cycle > cpu.GetCycles())
+								run(static_cast<u32>(key_event.cycle - cpu.GetCycles()));
+
+						cpu.SetKey(key_event.key, key_event.pressed);
+				}
+
+				if (job.cycles > cpu.GetCycles())
+						run(static_cast<u32>(job.cycles - cpu.GetCycles()));
+		}
+
+		memcpy(result.screen, cpu.GetScreen(), sizeof result.screen);
+		memcpy(result.data_registers, cpu.GetDataRegisters(), sizeof result.data_registers);
+		result.program_counter = cpu.GetProgramCounter();
+		result.index = cpu.GetIndex();
+		result.cycles = cpu.GetCycles();
+		result.fault = cpu.GetFault();
+		result.hash = Hash(result);
+
+		return result;
+}
+
+bool BatchRunner::Take(std::vector<Worker> &workers, u32 worker, u32 &job)
+{
+		{
+				std::lock_guard<std::mutex> lock(workers[worker].mutex);
+
+				if (!workers[worker].jobs.empty())
+				{
+						job = workers[worker].jobs.front();
+						workers[worker].jobs.pop_front();
+						return true;
+				}
+		}
+
+		for (u32 offset = 1; offset < workers.size(); ++offset)
+		{
+				Worker &victim = workers[(worker + offset) % workers.size()];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+
+				if (!victim.jobs.empty())
+				{
+						job = victim.jobs.back();
+						victim.jobs.pop_back();
+						return true;
+				}
+		}
+
+		return false;
+}
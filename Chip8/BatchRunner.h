@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Cpu.h"
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Runs independent headless Cpu instances across worker threads. Every
+// worker owns a deque of jobs and, once it runs dry, steals from the back of
+// another worker's deque, so jobs with uneven cycle budgets still keep every
+// core busy until the batch is done.
+class BatchRunner
+{
+public:
+		struct KeyEvent
+		{
+				u32 cycle;
+				u8 key;
+				bool pressed;
+		};
+
+		// The program is not copied and has to outlive the run. Key events are
+		// applied in order once the Cpu has executed the given number of cycles.
+		// The timers hold still unless cycles_per_tick is set. With a
+		// trace_file, every retired instruction is traced into it by the worker
+		// thread that runs the job.
+		struct Job
+		{
+				const u8 *program;
+				u16 program_size;
+				std::vector<KeyEvent> input;
+				u32 cycles;
+				u64 seed = 0;
+				u32 cycles_per_tick = 0;
+				Cpu::Quirks quirks = Cpu::cosmac_vip_quirks;
+				std::string trace_file = std::string();
+		};
+
+		struct Result
+		{
+				u64 screen[Cpu::screen_height];
+				u8 data_registers[Cpu::data_registers];
+				u16 program_counter;
+				u16 index;
+				u64 cycles;
+				Cpu::Fault fault;
+				bool loaded;
+				u64 hash;
+		};
+
+		BatchRunner(u32 threads = 0);
+		~BatchRunner();
+
+		u32 GetThreadCount();
+		std::vector<Result> Run(const std::vector<Job> &jobs);
+
+		static Result RunJob(const Job &job);
+
+private:
+		struct Worker
+		{
+				std::mutex mutex;
+				std::deque<u32> jobs;
+		};
+
+		u32 m_threads;
+
+		static u64 Hash(const Result &result);
+		static bool Take(std::vector<Worker> &workers, u32 worker, u32 &job);
+};
@@ -0,0 +1,66 @@
+#include "Beeper.h"
+#include "Scheduler.h"
+#include <algorithm>
+
+namespace
+{
+		// Samples are synthesised on the stack in chunks of this many.
+		const u32 chunk_samples = 256;
+}
+
+Beeper::Beeper(u32 frequency, u8 volume)
+		: m_frequency(frequency),
+		m_volume(volume),
+		m_frame_rate(Scheduler::frames_per_second),
+		m_pending_samples(0.0),
+		m_phase(0)
+{
+}
+
+Beeper::~Beeper()
+{
+}
+
+double Beeper::GetFrameRate()
+{
+		return m_frame_rate;
+}
+
+u32 Beeper::RunFrame(bool on, AudioBuffer &buffer)
+{
+		u32 sample_rate = buffer.GetSampleRate();
+
+		m_pending_samples += sample_rate / m_frame_rate;
+
+		u32 samples = static_cast<u32>(m_pending_samples);
+		u32 written = 0;
+		u8 chunk[chunk_samples];
+
+		m_pending_samples -= samples;
+
+		while (samples)
+		{
+				u32 count = std::min(samples, chunk_samples);
+
+				// The phase counts in sample_rate steps per period, so the
+				// frequency needn't divide the sample rate.
+				for (u32 sample = 0; sample < count; ++sample)
+				{
+						u8 level = m_phase < sample_rate / 2 ? AudioBuffer::silence + m_volume : AudioBuffer::silence - m_volume;
+
+						chunk[sample] = on ? level : AudioBuffer::silence;
+						m_phase = (m_phase + m_frequency) % sample_rate;
+				}
+
+				written += buffer.Write(chunk, count);
+				samples -= count;
+		}
+
+		return written;
+}
+
+void Beeper::SetFrameRate(double frame_rate)
+{
+		if (frame_rate > 0.0)
+				m_frame_rate = frame_rate;
+}
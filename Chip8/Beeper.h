@@ -0,0 +1,31 @@
+#pragma once
+
+#include "AudioBuffer.h"
+
+// Turns the sound timer into a square wave, one emulated frame of samples at
+// a time. The wave keeps its phase from frame to frame and the fractions of a
+// sample that don't divide into a frame carry over, so consecutive frames
+// join up without clicks or drift.
+class Beeper
+{
+public:
+		static const u32 default_frequency = 440;
+		static const u8 default_volume = 0x20;
+
+		Beeper(u32 frequency = default_frequency, u8 volume = default_volume);
+		~Beeper();
+
+		double GetFrameRate();
+		void SetFrameRate(double frame_rate);
+
+		// Writes one frame at the buffer's sample rate, sounding the tone if on,
+		// and returns how many samples the buffer took.
+		u32 RunFrame(bool on, AudioBuffer &buffer);
+
+private:
+		u32 m_frequency;
+		u8 m_volume;
+		double m_frame_rate;
+		double m_pending_samples;
+		u32 m_phase;
+};
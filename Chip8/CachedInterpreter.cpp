@@ -0,0 +1,292 @@
+#include "CachedInterpreter.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+		// Bytes before a page that the longest fusion can reach into it from.
+		const u8 fusion_reach = 5;
+
+		const char *const fusion_names[] =
+		{
+				"none",
+				"LD I, nnn; DRW",
+				"LD Vx, kk; LD Vy, kk",
+				"ADD Vx, kk; SE Vy, kk",
+				"ADD Vx, kk; SE Vy, kk; JP nnn",
+				"LD Vx, DT; SE Vy, kk",
+		};
+}
+
+CachedInterpreter::CachedInterpreter(Cpu &cpu)
+		: m_cpu(cpu),
+		m_quirks(cpu.GetQuirks()),
+		m_fusion(true),
+		m_code_pages(0),
+		m_stale_pages(0)
+{
+		ResetFusionStats();
+		Invalidate();
+}
+
+CachedInterpreter::~CachedInterpreter()
+{
+}
+
+void CachedInterpreter::DecodeAddress(u16 address)
+{
+		const u8 *ram = m_cpu.GetRam();
+		u16 opcode = ram[address] << 8 | ram[(address + 1) % Cpu::ram_size];
+
+		m_cache[address] = Cpu::Decode(opcode, m_quirks);
+}
+
+void CachedInterpreter::DecodePages(u64 pages)
+{
+		for (u8 page = 0; page < Cpu::ram_size / Cpu::page_size; ++page)
+		{
+				if (!(pages & (1ULL << page)))
+						continue;
+
+				u16 first_address = page * Cpu::page_size;
+
+				// The opcode starting on the byte before a page reads its low byte
+				// from that page, so it has to be decoded again as well.
+				DecodeAddress((first_address + Cpu::ram_size - 1) % Cpu::ram_size);
+
+				for (u16 address = first_address; address < first_address + Cpu::page_size; ++address)
+				{
+						DecodeAddress(address);
+				}
+
+				for (u16 address = first_address + Cpu::ram_size - fusion_reach; address < first_address + Cpu::ram_size + Cpu::page_size; ++address)
+				{
+						FuseAddress(address % Cpu::ram_size);
+				}
+		}
+}
+
+void CachedInterpreter::ExecuteAddByteSkipEqualByte(Cpu &cpu, const Cpu::Instruction *instructions)
+{
+		cpu.m_pc = cpu.ConvertAddress(cpu.m_pc + 4);
+		cpu.AddByte(instructions[0].data_register_x, instructions[0].byte);
+		cpu.SkipEqualByte(instructions[2].data_register_x, instructions[2].byte);
+		cpu.m_cycles += 2;
+}
+
+void CachedInterpreter::ExecuteAddByteSkipEqualByteJump(Cpu &cpu, const Cpu::Instruction *instructions)
+{
+		cpu.AddByte(instructions[0].data_register_x, instructions[0].byte);
+
+		// The skip either steps over the jump or the jump runs as well.
+		if (cpu.GetDataRegister(instructions[2].data_register_x) == instructions[2].byte)
+		{
+				cpu.m_pc = cpu.ConvertAddress(cpu.m_pc + 4) + 2;
+				cpu.m_cycles += 2;
+		}
+		else
+		{
+				cpu.m_pc = instructions[4].address;
+				cpu.m_cycles += 3;
+		}
+}
+
+void CachedInterpreter::ExecuteStoreAddressDrawSprite(Cpu &cpu, const Cpu::Instruction *instructions)
+{
+		cpu.m_pc = cpu.ConvertAddress(cpu.m_pc + 4);
+		cpu.StoreAddress(instructions[0].address);
+		cpu.DrawSprite(instructions[2].data_register_x, instructions[2].data_register_y, instructions[2].nibble);
+		cpu.m_cycles += 2;
+}
+
+void CachedInterpreter::ExecuteStoreByteStoreByte(Cpu &cpu, const Cpu::Instruction *instructions)
+{
+		cpu.m_pc = cpu.ConvertAddress(cpu.m_pc + 4);
+		cpu.SetDataRegister(instructions[0].data_register_x, instructions[0].byte);
+		cpu.SetDataRegister(instructions[2].data_register_x, instructions[2].byte);
+		cpu.m_cycles += 2;
+}
+
+void CachedInterpreter::ExecuteStoreDelayTimerSkipEqualByte(Cpu &cpu, const Cpu::Instruction *instructions)
+{
+		// The delay timer is read at the cycle the first instruction runs on.
+		cpu.m_pc = cpu.ConvertAddress(cpu.m_pc + 4);
+		cpu.StoreDelayTimer(instructions[0].data_register_x);
+		cpu.SkipEqualByte(instructions[2].data_register_x, instructions[2].byte);
+		cpu.m_cycles += 2;
+}
+
+void CachedInterpreter::FuseAddress(u16 address)
+{
+		FusedInstruction &fused = m_fused[address];
+		const u8 *ram = m_cpu.GetRam();
+		u16 opcodes[3] = {};
+
+		fused.handler = nullptr;
+		fused.length = 1;
+		fused.fusion = Fusion::none;
+
+		// Fused instructions run from consecutive cache entries, so they never
+		// wrap around the end of ram.
+		for (u8 instruction = 0; instruction < 3 && address + instruction * 2 + 1 < Cpu::ram_size; ++instruction)
+		{
+				u16 instruction_address = address + instruction * 2;
+
+				opcodes[instruction] = ram[instruction_address] << 8 | ram[instruction_address + 1];
+		}
+
+		if (!m_fusion)
+				return;
+
+		if (opcodes[0] >> 12 == 0x7 && opcodes[1] >> 12 == 0x3 && opcodes[2] >> 12 == 0x1)
+		{
+				fused.handler = &ExecuteAddByteSkipEqualByteJump;
+				fused.length = 3;
+				fused.fusion = Fusion::add_byte_skip_equal_byte_jump;
+		}
+		else if (opcodes[0] >> 12 == 0x7 && opcodes[1] >> 12 == 0x3)
+		{
+				fused.handler = &ExecuteAddByteSkipEqualByte;
+				fused.length = 2;
+				fused.fusion = Fusion::add_byte_skip_equal_byte;
+		}
+		else if (opcodes[0] >> 12 == 0xA && opcodes[1] >> 12 == 0xD)
+		{
+				fused.handler = &ExecuteStoreAddressDrawSprite;
+				fused.length = 2;
+				fused.fusion = Fusion::store_address_draw_sprite;
+		}
+		else if (opcodes[0] >> 12 == 0x6 && opcodes[1] >> 12 == 0x6)
+		{
+				fused.handler = &ExecuteStoreByteStoreByte;
+				fused.length = 2;
+				fused.fusion = Fusion::store_byte_store_byte;
+		}
+		else if ((opcodes[0] & 0xF0FF) == 0xF007 && opcodes[1] >> 12 == 0x3)
+		{
+				fused.handler = &ExecuteStoreDelayTimerSkipEqualByte;
+				fused.length = 2;
+				fused.fusion = Fusion::store_delay_timer_skip_equal_byte;
+		}
+}
+
+std::string CachedInterpreter::GetFusionReport()
+{
+		std::string report;
+		char line[96];
+		u64 total_saved = 0;
+
+		for (const FusionStats &stats : GetFusionStats())
+		{
+				snprintf(line, sizeof line, "%-32s %12llu fired %12llu dispatches saved\n", stats.name, static_cast<unsigned long long>(stats.fired), static_cast<unsigned long long>(stats.saved));
+				report += line;
+				total_saved += stats.saved;
+		}
+
+		snprintf(line, sizeof line, "%-32s %12s       %12llu dispatches saved\n", "Total", "", static_cast<unsigned long long>(total_saved));
+		report += line;
+
+		return report;
+}
+
+std::vector<CachedInterpreter::FusionStats> CachedInterpreter::GetFusionStats()
+{
+		std::vector<FusionStats> stats;
+
+		for (u8 fusion = 1; fusion < fusion_count; ++fusion)
+		{
+				stats.push_back({ static_cast<Fusion>(fusion), fusion_names[fusion], m_fired[fusion], m_fused_cycles[fusion] - m_fired[fusion] });
+		}
+
+		return stats;
+}
+
+void CachedInterpreter::Invalidate()
+{
+		m_quirks = m_cpu.GetQuirks();
+		m_cpu.TakeWrittenPages();
+		DecodePages(~0ULL);
+		m_code_pages = 0;
+		m_stale_pages = 0;
+}
+
+void CachedInterpreter::InvalidatePages(u64 pages)
+{
+		// Most guest writes land in data, so pages nothing has run from yet are
+		// only marked and decoded when execution first reaches them.
+		if (pages & m_code_pages)
+				DecodePages(pages & m_code_pages);
+
+		m_stale_pages |= pages & ~m_code_pages;
+}
+
+void CachedInterpreter::ResetFusionStats()
+{
+		memset(m_fired, NULL, sizeof m_fired);
+		memset(m_fused_cycles, NULL, sizeof m_fused_cycles);
+}
+
+u32 CachedInterpreter::Run(u32 cycles)
+{
+		u32 executed = 0;
+
+		if (m_cpu.GetQuirks() != m_quirks)
+				Invalidate();
+
+		InvalidatePages(m_cpu.TakeWrittenPages());
+
+		while (executed < cycles && m_cpu.GetFault() == Cpu::Fault::none)
+		{
+				u16 pc = m_cpu.GetProgramCounter();
+				u16 address = pc % Cpu::ram_size;
+
+				// A fusion reads up to fusion_reach bytes on, which can be in the
+				// next page.
+				u64 pages = 1ULL << (address / Cpu::page_size) | 1ULL << ((address + fusion_reach) % Cpu::ram_size / Cpu::page_size);
+
+				if (pages & ~m_code_pages)
+				{
+						DecodePages(pages & m_stale_pages);
+						m_stale_pages &= ~pages;
+						m_code_pages |= pages;
+				}
+
+				const FusedInstruction &fused = m_fused[address];
+
+				// Near the end of the budget a fusion could overshoot it, so the
+				// instructions run one at a time instead.
+				if (fused.handler && executed + fused.length <= cycles)
+				{
+						u64 start = m_cpu.GetCycles();
+
+						fused.handler(m_cpu, &m_cache[address]);
+
+						u32 fused_cycles = static_cast<u32>(m_cpu.GetCycles() - start);
+
+						executed += fused_cycles;
+						++m_fired[static_cast<u8>(fused.fusion)];
+						m_fused_cycles[static_cast<u8>(fused.fusion)] += fused_cycles;
+				}
+				else
+				{
+						m_cpu.Execute(m_cache[address]);
+						++executed;
+				}
+
+				if (m_cpu.GetProgramCounter() <= pc)
+						executed += m_cpu.SkipIdleLoop(cycles - executed);
+
+				u64 written_pages = m_cpu.TakeWrittenPages();
+
+				if (written_pages)
+						InvalidatePages(written_pages);
+		}
+
+		return executed;
+}
+
+void CachedInterpreter::SetFusion(bool fusion)
+{
+		m_fusion = fusion;
+		Invalidate();
+}
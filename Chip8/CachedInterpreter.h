@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Cpu.h"
+#include <string>
+#include <vector>
+
+// Runs a Cpu from a cache holding the decoded instruction for every ram
+// address, so the hot loop is a load and an indirect call per instruction.
+// The cache is decoded for the Cpu's quirks and rebuilt when they change.
+// Common runs of two or three instructions are fused at decode time into a
+// single handler that executes all of them, saving the dispatches between.
+// Writes only cost a decode on pages that have run, other pages are decoded
+// again once execution reaches them.
+class CachedInterpreter
+{
+public:
+		enum class Fusion
+				: u8
+		{
+				none,
+				store_address_draw_sprite,
+				store_byte_store_byte,
+				add_byte_skip_equal_byte,
+				add_byte_skip_equal_byte_jump,
+				store_delay_timer_skip_equal_byte
+		};
+
+		static const u8 fusion_count = 6;
+
+		// How often a fusion ran and how many dispatches it saved, which is one
+		// less than the instructions it executed each time.
+		struct FusionStats
+		{
+				Fusion fusion;
+				const char *name;
+				u64 fired;
+				u64 saved;
+		};
+
+		CachedInterpreter(Cpu &cpu);
+		~CachedInterpreter();
+
+		void Invalidate();
+		u32 Run(u32 cycles);
+
+		// Off falls back to one dispatch per instruction, for comparison.
+		void SetFusion(bool fusion);
+
+		std::vector<FusionStats> GetFusionStats();
+		std::string GetFusionReport();
+		void ResetFusionStats();
+
+private:
+		// Receives the cached instructions from the first one on, two entries
+		// per instruction, and updates the program counter and cycles itself.
+		using FusedHandler = void (*)(Cpu &cpu, const Cpu::Instruction *instructions);
+
+		struct FusedInstruction
+		{
+				FusedHandler handler;
+				u8 length;
+				Fusion fusion;
+		};
+
+		Cpu &m_cpu;
+		Cpu::Quirks m_quirks;
+		bool m_fusion;
+		Cpu::Instruction m_cache[Cpu::ram_size];
+		FusedInstruction m_fused[Cpu::ram_size];
+		u64 m_fired[fusion_count];
+		u64 m_fused_cycles[fusion_count];
+		u64 m_code_pages;
+		u64 m_stale_pages;
+
+		void DecodeAddress(u16 address);
+		void DecodePages(u64 pages);
+		void FuseAddress(u16 address);
+		void InvalidatePages(u64 pages);
+
+		static void ExecuteAddByteSkipEqualByte(Cpu &cpu, const Cpu::Instruction *instructions);
+		static void ExecuteAddByteSkipEqualByteJump(Cpu &cpu, const Cpu::Instruction *instructions);
+		static void ExecuteStoreAddressDrawSprite(Cpu &cpu, const Cpu::Instruction *instructions);
+		static void ExecuteStoreByteStoreByte(Cpu &cpu, const Cpu::Instruction *instructions);
+		static void ExecuteStoreDelayTimerSkipEqualByte(Cpu &cpu, const Cpu::Instruction *instructions);
+};
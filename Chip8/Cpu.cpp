@@ -1,15 +1,227 @@
 #include "Cpu.h"
+#include "Profiler.h"
+#include "TraceRecorder.h"
+#include <climits>
+#include <cstddef>
+#include <cstring>
 #include <memory>
-#include <random>
+#include <type_traits>
 
-Cpu::Cpu()
+namespace
 {
-		LoadFont();
-		ClearScreen();
+		using Operation = Cpu::Operation;
+
+		// Operations index into the Cpu::Handlers tables, so the order of both
+		// must match.
+		const u8 operation_count = static_cast<u8>(Operation::set_data_registers) + 1;
+
+		Operation DecodeOperation(u16 opcode)
+		{
+				u8 low_nibble = opcode & 0x000F;
+				u8 low_byte = opcode & 0x00FF;
+
+				switch (opcode >> 12)
+				{
+				case 0x0:
+						if (opcode == 0x00E0)
+								return Operation::clear_screen;
+						if (opcode == 0x00EE)
+								return Operation::return_;
+						return Operation::machine_routine;
+				case 0x1: return Operation::jump;
+				case 0x2: return Operation::call;
+				case 0x3: return Operation::skip_equal_byte;
+				case 0x4: return Operation::skip_not_equal_byte;
+				case 0x5: return low_nibble == 0x0 ? Operation::skip_equal_register : Operation::invalid;
+				case 0x6: return Operation::store_byte;
+				case 0x7: return Operation::add_byte;
+				case 0x8:
+						switch (low_nibble)
+						{
+						case 0x0: return Operation::store_data_register;
+						case 0x1: return Operation::or_registers;
+						case 0x2: return Operation::and_registers;
+						case 0x3: return Operation::xor_registers;
+						case 0x4: return Operation::add_registers;
+						case 0x5: return Operation::subtract_register;
+						case 0x6: return Operation::shift_register_right;
+						case 0x7: return Operation::subtract_registers;
+						case 0xE: return Operation::shift_register_left;
+						}
+						return Operation::invalid;
+				case 0x9: return low_nibble == 0x0 ? Operation::skip_not_equal_register : Operation::invalid;
+				case 0xA: return Operation::store_address;
+				case 0xB: return Operation::jump_plus;
+				case 0xC: return Operation::store_random_number;
+				case 0xD: return Operation::draw_sprite;
+				case 0xE:
+						switch (low_byte)
+						{
+						case 0x9E: return Operation::skip_key_pressed;
+						case 0xA1: return Operation::skip_key_not_pressed;
+						}
+						return Operation::invalid;
+				case 0xF:
+						switch (low_byte)
+						{
+						case 0x07: return Operation::store_delay_timer;
+						case 0x0A: return Operation::wait_key;
+						case 0x15: return Operation::set_delay_timer;
+						case 0x18: return Operation::set_sound_timer;
+						case 0x1E: return Operation::add_index;
+						case 0x29: return Operation::set_text_character;
+						case 0x33: return Operation::store_binary_coded_decimal;
+						case 0x55: return Operation::store_data_registers;
+						case 0x65: return Operation::set_data_registers;
+						}
+						return Operation::invalid;
+				}
+
+				return Operation::invalid;
+		}
+
+		// Every possible opcode is classified once at startup so decoding at
+		// run time is a single table lookup instead of a chain of nibble tests.
+		struct OperationTable
+		{
+				u8 operations[0x10000];
+
+				OperationTable()
+				{
+						for (u32 opcode = 0; opcode <= 0xFFFF; ++opcode)
+						{
+								operations[opcode] = static_cast<u8>(DecodeOperation(static_cast<u16>(opcode)));
+						}
+				}
+		};
+
+		const OperationTable operation_table;
+
+		// Named after the Cpu methods the operations run.
+		const char *const operation_names[] =
+		{
+				"Invalid",
+				"MachineRoutine",
+				"ClearScreen",
+				"Return",
+				"Jump",
+				"Call",
+				"SkipEqualByte",
+				"SkipNotEqualByte",
+				"SkipEqualRegister",
+				"StoreByte",
+				"AddByte",
+				"StoreDataRegister",
+				"OrRegisters",
+				"AndRegisters",
+				"XorRegisters",
+				"AddRegisters",
+				"SubtractRegister",
+				"ShiftRegisterRight",
+				"SubtractRegisters",
+				"ShiftRegisterLeft",
+				"SkipNotEqualRegister",
+				"StoreAddress",
+				"JumpPlus",
+				"StoreRandomNumber",
+				"DrawSprite",
+				"SkipKeyPressed",
+				"SkipKeyNotPressed",
+				"StoreDelayTimer",
+				"WaitKey",
+				"SetDelayTimer",
+				"SetSoundTimer",
+				"AddIndex",
+				"SetTextCharacter",
+				"StoreBinaryCodedDecimal",
+				"StoreDataRegisters",
+				"SetDataRegisters",
+		};
+
+		static_assert(sizeof operation_names / sizeof *operation_names == operation_count, "operation_names doesn't match Operation");
 }
 
-Cpu::~Cpu()
+template <Cpu::Quirks quirks>
+struct Cpu::Handlers
+{
+		static const Handler table[];
+};
+
+template <Cpu::Quirks quirks>
+const Cpu::Handler Cpu::Handlers<quirks>::table[] =
+{
+		&Cpu::ExecuteInvalid,
+		&Cpu::ExecuteMachineRoutine,
+		&Cpu::ExecuteClearScreen,
+		&Cpu::ExecuteReturn,
+		&Cpu::ExecuteJump<quirks>,
+		&Cpu::ExecuteCall,
+		&Cpu::ExecuteSkipEqualByte,
+		&Cpu::ExecuteSkipNotEqualByte,
+		&Cpu::ExecuteSkipEqualRegister,
+		&Cpu::ExecuteStoreByte,
+		&Cpu::ExecuteAddByte,
+		&Cpu::ExecuteStoreDataRegister,
+		&Cpu::ExecuteOrRegisters,
+		&Cpu::ExecuteAndRegisters,
+		&Cpu::ExecuteXorRegisters,
+		&Cpu::ExecuteAddRegisters,
+		&Cpu::ExecuteSubtractRegister,
+		&Cpu::ExecuteShiftRegisterRight<quirks>,
+		&Cpu::ExecuteSubtractRegisters,
+		&Cpu::ExecuteShiftRegisterLeft<quirks>,
+		&Cpu::ExecuteSkipNotEqualRegister,
+		&Cpu::ExecuteStoreAddress,
+		&Cpu::ExecuteJumpPlus<quirks>,
+		&Cpu::ExecuteStoreRandomNumber,
+		&Cpu::ExecuteDrawSprite,
+		&Cpu::ExecuteSkipKeyPressed,
+		&Cpu::ExecuteSkipKeyNotPressed,
+		&Cpu::ExecuteStoreDelayTimer,
+		&Cpu::ExecuteWaitKey,
+		&Cpu::ExecuteSetDelayTimer,
+		&Cpu::ExecuteSetSoundTimer,
+		&Cpu::ExecuteAddIndex,
+		&Cpu::ExecuteSetTextCharacter,
+		&Cpu::ExecuteStoreBinaryCodedDecimal,
+		&Cpu::ExecuteStoreDataRegisters<quirks>,
+		&Cpu::ExecuteSetDataRegisters<quirks>,
+};
+
+const Cpu::Handler *const Cpu::handler_tables[quirk_combinations] =
+{
+		Handlers<0x0>::table, Handlers<0x1>::table, Handlers<0x2>::table, Handlers<0x3>::table,
+		Handlers<0x4>::table, Handlers<0x5>::table, Handlers<0x6>::table, Handlers<0x7>::table,
+		Handlers<0x8>::table, Handlers<0x9>::table, Handlers<0xA>::table, Handlers<0xB>::table,
+		Handlers<0xC>::table, Handlers<0xD>::table, Handlers<0xE>::table, Handlers<0xF>::table
+};
+
+Cpu::Cpu()
+		: m_pc(program_start),
+		m_i(0),
+		m_stack_pointer(0),
+		m_delay_timer(0),
+		m_sound_timer(0),
+		m_fault(Fault::none),
+		m_quirks(cosmac_vip_quirks),
+		m_keys(0),
+		m_dirty_rows(~0U),
+		m_cycles(0),
+		m_cycles_per_tick(0),
+		m_delay_timer_cycle(0),
+		m_sound_timer_cycle(0),
+		m_random(0),
+		m_random_generator(&Cpu::Pcg),
+		m_written_pages(0)
 {
+		static_assert(std::is_trivially_copyable<Cpu>::value, "Cpu must stay trivially copyable");
+		static_assert(offsetof(Cpu, m_keys) + sizeof m_keys <= 64, "Cpu hot state must fit in the first cache line");
+
+		memset(m_data_registers, NULL, sizeof m_data_registers);
+		memset(m_stack, NULL, sizeof m_stack);
+		memset(m_screen, NULL, sizeof m_screen);
+		memset(m_ram, NULL, sizeof m_ram);
+		LoadFont();
 }
 
 void Cpu::AddByte(DataRegisters data_register, u8 byte)
@@ -19,6 +231,11 @@ void Cpu::AddByte(DataRegisters data_register, u8 byte)
 		SetDataRegister(data_register, result);
 }
 
+void Cpu::AddCycles(u32 cycles)
+{
+		m_cycles += cycles;
+}
+
 void Cpu::AddIndex(DataRegisters data_register)
 {
 		u16 address = GetIndex() + GetDataRegister(data_register);
@@ -46,12 +263,24 @@ void Cpu::AndRegisters(DataRegisters data_register_x, DataRegisters data_registe
 
 void Cpu::Call(u16 address)
 {
-		m_stack.push(m_pc);
+		if (m_stack_pointer == stack_entries)
+		{
+				RaiseFault(Fault::stack_overflow);
+				return;
+		}
+
+		m_stack[m_stack_pointer++] = m_pc;
 		m_pc = ConvertAddress(address);
 }
 
 void Cpu::ClearScreen()
 {
+		for (u8 row = 0; row < screen_height; ++row)
+		{
+				if (m_screen[row])
+						m_dirty_rows |= 1U << row;
+		}
+
 		memset(m_screen, NULL, sizeof m_screen);
 }
 
@@ -60,6 +289,269 @@ u16 Cpu::ConvertAddress(u16 address)
 		return address & 0xFFF;
 }
 
+u8 Cpu::CountDown(u8 timer, u64 timer_cycle)
+{
+		if (!m_cycles_per_tick)
+				return timer;
+
+		// Ticks fall on multiples of m_cycles_per_tick, so a timer read right
+		// after a snapshot or a batch boundary sees the same value as one read
+		// in a single long run.
+		u64 ticks = m_cycles / m_cycles_per_tick - timer_cycle / m_cycles_per_tick;
+
+		return ticks < timer ? static_cast<u8>(timer - ticks) : 0;
+}
+
+Cpu::Instruction Cpu::Decode(u16 opcode, Quirks quirks)
+{
+		static_assert(sizeof Handlers<cosmac_vip_quirks>::table / sizeof *Handlers<cosmac_vip_quirks>::table == operation_count, "Cpu::Handlers doesn't match Operation");
+
+		Instruction instruction;
+
+		instruction.handler = handler_tables[quirks % quirk_combinations][operation_table.operations[opcode]];
+		instruction.address = opcode & 0x0FFF;
+		instruction.byte = opcode & 0x00FF;
+		instruction.nibble = opcode & 0x000F;
+		instruction.data_register_x = static_cast<DataRegisters>((opcode & 0x0F00) >> 8);
+		instruction.data_register_y = static_cast<DataRegisters>((opcode & 0x00F0) >> 4);
+
+		return instruction;
+}
+
+void Cpu::DrawSprite(DataRegisters data_register_x, DataRegisters data_register_y, u8 rows)
+{
+		u8 x = GetDataRegister(data_register_x) % screen_width;
+		u8 y = GetDataRegister(data_register_y) % screen_height;
+		u64 collisions = 0;
+
+		for (u8 row = 0; row < rows; ++row)
+		{
+				u64 sprite = static_cast<u64>(m_ram[ConvertAddress(m_i + row)]) << (screen_width - 8);
+				u64 sprite_row = (sprite >> x) | (sprite << ((screen_width - x) % screen_width));
+				u8 screen_row_index = (y + row) % screen_height;
+				u64 &screen_row = m_screen[screen_row_index];
+
+				collisions |= screen_row & sprite_row;
+				screen_row ^= sprite_row;
+
+				if (sprite_row)
+						m_dirty_rows |= 1U << screen_row_index;
+		}
+
+		SetDataRegister(DataRegisters::vF, collisions != 0);
+}
+
+void Cpu::Execute(const Instruction &instruction)
+{
+		m_pc = ConvertAddress(m_pc + 2);
+		instruction.handler(*this, instruction);
+		++m_cycles;
+}
+
+void Cpu::ExecuteAddByte(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.AddByte(instruction.data_register_x, instruction.byte);
+}
+
+void Cpu::ExecuteAddIndex(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.AddIndex(instruction.data_register_x);
+}
+
+void Cpu::ExecuteAddRegisters(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.AddRegisters(instruction.data_register_x, instruction.data_register_y);
+}
+
+void Cpu::ExecuteAndRegisters(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.AndRegisters(instruction.data_register_x, instruction.data_register_y);
+}
+
+void Cpu::ExecuteCall(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.Call(instruction.address);
+}
+
+void Cpu::ExecuteClearScreen(Cpu &cpu, const Instruction & /*instruction*/)
+{
+		cpu.ClearScreen();
+}
+
+void Cpu::ExecuteDrawSprite(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.DrawSprite(instruction.data_register_x, instruction.data_register_y, instruction.nibble);
+}
+
+void Cpu::ExecuteInvalid(Cpu &cpu, const Instruction & /*instruction*/)
+{
+		cpu.RaiseFault(Fault::invalid_opcode);
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::ExecuteJump(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.Jump<quirks>(instruction.address);
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::ExecuteJumpPlus(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.JumpPlus<quirks>(instruction.address);
+}
+
+void Cpu::ExecuteMachineRoutine(Cpu & /*cpu*/, const Instruction & /*instruction*/)
+{
+		// 0NNN calls native code on the original hardware and is ignored.
+}
+
+void Cpu::ExecuteOrRegisters(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.OrRegisters(instruction.data_register_x, instruction.data_register_y);
+}
+
+void Cpu::ExecuteReturn(Cpu &cpu, const Instruction & /*instruction*/)
+{
+		cpu.Return();
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::ExecuteSetDataRegisters(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SetDataRegisters<quirks>(instruction.data_register_x);
+}
+
+void Cpu::ExecuteSetDelayTimer(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SetDelayTimer(instruction.data_register_x);
+}
+
+void Cpu::ExecuteSetSoundTimer(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SetSoundTimer(instruction.data_register_x);
+}
+
+void Cpu::ExecuteSetTextCharacter(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SetTextCharacter(instruction.data_register_x);
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::ExecuteShiftRegisterLeft(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.ShiftRegisterLeft<quirks>(instruction.data_register_x, instruction.data_register_y);
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::ExecuteShiftRegisterRight(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.ShiftRegisterRight<quirks>(instruction.data_register_x, instruction.data_register_y);
+}
+
+void Cpu::ExecuteSkipEqualByte(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SkipEqualByte(instruction.data_register_x, instruction.byte);
+}
+
+void Cpu::ExecuteSkipEqualRegister(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SkipEqualRegister(instruction.data_register_x, instruction.data_register_y);
+}
+
+void Cpu::ExecuteSkipKeyNotPressed(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SkipKeyNotPressed(instruction.data_register_x);
+}
+
+void Cpu::ExecuteSkipKeyPressed(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SkipKeyPressed(instruction.data_register_x);
+}
+
+void Cpu::ExecuteSkipNotEqualByte(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SkipNotEqualByte(instruction.data_register_x, instruction.byte);
+}
+
+void Cpu::ExecuteSkipNotEqualRegister(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SkipNotEqualRegister(instruction.data_register_x, instruction.data_register_y);
+}
+
+void Cpu::ExecuteStoreAddress(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.StoreAddress(instruction.address);
+}
+
+void Cpu::ExecuteStoreBinaryCodedDecimal(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.StoreBinaryCodedDecimal(instruction.data_register_x);
+}
+
+void Cpu::ExecuteStoreByte(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SetDataRegister(instruction.data_register_x, instruction.byte);
+}
+
+void Cpu::ExecuteStoreDataRegister(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.StoreDataRegister(instruction.data_register_x, instruction.data_register_y);
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::ExecuteStoreDataRegisters(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.StoreDataRegisters<quirks>(instruction.data_register_x);
+}
+
+void Cpu::ExecuteStoreDelayTimer(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.StoreDelayTimer(instruction.data_register_x);
+}
+
+void Cpu::ExecuteStoreRandomNumber(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.StoreRandomNumber(instruction.data_register_x, instruction.byte);
+}
+
+void Cpu::ExecuteSubtractRegister(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SubtractRegister(instruction.data_register_x, instruction.data_register_y);
+}
+
+void Cpu::ExecuteSubtractRegisters(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.SubtractRegisters(instruction.data_register_x, instruction.data_register_y);
+}
+
+void Cpu::ExecuteWaitKey(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.WaitKey(instruction.data_register_x);
+}
+
+void Cpu::ExecuteXorRegisters(Cpu &cpu, const Instruction &instruction)
+{
+		cpu.XorRegisters(instruction.data_register_x, instruction.data_register_y);
+}
+
+u16 Cpu::Fetch()
+{
+		u8 high_byte = m_ram[ConvertAddress(m_pc)];
+		u8 low_byte = m_ram[ConvertAddress(m_pc + 1)];
+
+		return high_byte << 8 | low_byte;
+}
+
+u64 Cpu::GetCycles()
+{
+		return m_cycles;
+}
+
+u32 Cpu::GetCyclesPerTick()
+{
+		return m_cycles_per_tick;
+}
+
 u8 Cpu::GetDataRegister(DataRegisters data_register)
 {
 		return m_data_registers[static_cast<u8>(data_register)];
@@ -72,7 +564,17 @@ const u8 *Cpu::GetDataRegisters()
 
 u8 Cpu::GetDelayTimer()
 {
-		return m_delay_timer;
+		return CountDown(m_delay_timer, m_delay_timer_cycle);
+}
+
+u32 Cpu::GetDirtyRows()
+{
+		return m_dirty_rows;
+}
+
+Cpu::Fault Cpu::GetFault()
+{
+		return m_fault;
 }
 
 u16 Cpu::GetIndex()
@@ -85,34 +587,95 @@ const u8 *Cpu::GetRam()
 		return m_ram;
 }
 
-const u8 *Cpu::GetScreen()
+const u64 *Cpu::GetScreen()
 {
 		return m_screen;
 }
 
+Cpu::Operation Cpu::GetOperation(u16 opcode)
+{
+		return static_cast<Operation>(operation_table.operations[opcode]);
+}
+
+const char *Cpu::GetOperationName(u16 opcode)
+{
+		return operation_names[operation_table.operations[opcode]];
+}
+
+bool Cpu::GetPixel(u8 x, u8 y)
+{
+		return (m_screen[y % screen_height] >> (screen_width - 1 - x % screen_width)) & 1;
+}
+
 u16 Cpu::GetProgramCounter()
 {
 		return m_pc;
 }
 
+Cpu::Quirks Cpu::GetQuirks()
+{
+		return m_quirks;
+}
+
 u8 Cpu::GetSoundTimer()
 {
-		return m_sound_timer;
+		return CountDown(m_sound_timer, m_sound_timer_cycle);
 }
 
 u16 Cpu::GetStack()
 {
-		return m_stack.top();
+		return m_stack_pointer ? m_stack[m_stack_pointer - 1] : 0;
+}
+
+u8 Cpu::GetStackPointer()
+{
+		return m_stack_pointer;
+}
+
+bool Cpu::IsKeyPressed(u8 key)
+{
+		return (m_keys >> (key % keys)) & 1;
+}
+
+bool Cpu::IsWaitingForKey()
+{
+		u16 pc = ConvertAddress(m_pc);
+
+		return !m_keys && m_fault == Fault::none && m_ram[pc] >> 4 == 0xF && m_ram[ConvertAddress(pc + 1)] == 0x0A;
 }
 
 void Cpu::Jump(u16 address)
 {
-		m_pc = ConvertAddress(address);
+		if (m_quirks & jump_wraps)
+				Jump<jump_wraps>(address);
+		else
+				Jump<0>(address);
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::Jump(u16 address)
+{
+		m_pc = quirks & jump_wraps ? ConvertAddress(address) : address;
+}
+
+void Cpu::JumpPlus(u16 address)
+{
+		switch (m_quirks & (jump_plus_uses_v0 | jump_wraps))
+		{
+		case 0: JumpPlus<0>(address); break;
+		case jump_plus_uses_v0: JumpPlus<jump_plus_uses_v0>(address); break;
+		case jump_wraps: JumpPlus<jump_wraps>(address); break;
+		default: JumpPlus<jump_plus_uses_v0 | jump_wraps>(address); break;
+		}
 }
 
+template <Cpu::Quirks quirks>
 void Cpu::JumpPlus(u16 address)
 {
-		m_pc = address + GetDataRegister(DataRegisters::v0);
+		// CHIP-48 reads BNNN as BXNN and adds VX.
+		u16 target = address + m_data_registers[quirks & jump_plus_uses_v0 ? 0 : (address >> 8) & 0xF];
+
+		m_pc = quirks & jump_wraps ? ConvertAddress(target) : target;
 }
 
 void Cpu::LoadFont()
@@ -140,6 +703,46 @@ void Cpu::LoadFont()
 		memcpy(m_ram, font, sizeof font);
 }
 
+bool Cpu::LoadProgram(const u8 *program, u16 size)
+{
+		if (size > program_size)
+				return false;
+
+		memcpy(m_ram + program_start, program, size);
+		m_pc = program_start;
+		m_written_pages = ~0ULL;
+
+		return true;
+}
+
+void Cpu::LoadState(const State &state)
+{
+		memcpy(m_ram, state.ram, sizeof m_ram);
+		memcpy(m_screen, state.screen, sizeof m_screen);
+		memcpy(m_stack, state.stack, sizeof m_stack);
+		memcpy(m_data_registers, state.registers, sizeof m_data_registers);
+		m_cycles = state.cycles;
+		m_random = state.random;
+		m_pc = state.pc;
+		m_i = state.i;
+		m_keys = state.keys;
+		m_stack_pointer = state.stack_pointer;
+		m_delay_timer = state.delay_timer;
+		m_delay_timer_cycle = m_cycles;
+		m_sound_timer = state.sound_timer;
+		m_sound_timer_cycle = m_cycles;
+		m_fault = state.fault;
+
+		// Nothing cached about the previous state can be trusted any more.
+		m_written_pages = ~0ULL;
+		m_dirty_rows = ~0U;
+}
+
+void Cpu::MarkWritten(u16 address)
+{
+		m_written_pages |= 1ULL << (ConvertAddress(address) / page_size);
+}
+
 void Cpu::OrRegisters(DataRegisters data_register_x, DataRegisters data_register_y)
 {
 		u8 result = GetDataRegister(data_register_x) | GetDataRegister(data_register_y);
@@ -147,10 +750,124 @@ void Cpu::OrRegisters(DataRegisters data_register_x, DataRegisters data_register
 		SetDataRegister(data_register_x, result);
 }
 
+// PCG32 (XSH RR), which passes statistical tests with only a u64 of state.
+u8 Cpu::Pcg(u64 &state)
+{
+		u64 old_state = state;
+		u32 xorshifted = static_cast<u32>(((old_state >> 18) ^ old_state) >> 27);
+		u32 rotation = static_cast<u32>(old_state >> 59);
+
+		state = old_state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+		return static_cast<u8>(((xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31))) >> 24);
+}
+
+u32 Cpu::PublishFrame(u64 *screen)
+{
+		u32 dirty_rows = m_dirty_rows;
+
+		for (u8 row = 0; row < screen_height; ++row)
+		{
+				if ((dirty_rows >> row) & 1)
+						screen[row] = m_screen[row];
+		}
+
+		m_dirty_rows = 0;
+
+		return dirty_rows;
+}
+
+void Cpu::RaiseFault(Fault fault)
+{
+		// Leave the program counter on the offending opcode so it can be inspected.
+		m_pc = ConvertAddress(m_pc - 2);
+		m_fault = fault;
+}
+
 void Cpu::Return()
 {
-		m_pc = m_stack.top();
-		m_stack.pop();
+		if (!m_stack_pointer)
+		{
+				RaiseFault(Fault::stack_underflow);
+				return;
+		}
+
+		m_pc = m_stack[--m_stack_pointer];
+}
+
+u32 Cpu::Run(u32 cycles)
+{
+		NullProfiler profiler;
+
+		return Run(cycles, profiler);
+}
+
+template <typename Profiler>
+u32 Cpu::Run(u32 cycles, Profiler &profiler)
+{
+		u32 executed = 0;
+
+		while (executed < cycles && m_fault == Fault::none)
+		{
+				u16 pc = m_pc;
+				u16 opcode = Fetch();
+
+				profiler.CountInstruction(ConvertAddress(pc), opcode);
+				Execute(Decode(opcode, m_quirks));
+				profiler.Retire(m_data_registers, m_i);
+				++executed;
+
+				// Idle loops are only ever re-entered through a jump back.
+				if (m_pc <= pc)
+				{
+						u32 skipped = SkipIdleLoop(cycles - executed);
+
+						if (skipped)
+						{
+								profiler.CountIdleCycles(ConvertAddress(m_pc), skipped);
+								profiler.Retire(m_data_registers, m_i);
+						}
+
+						executed += skipped;
+				}
+		}
+
+		return executed;
+}
+
+template u32 Cpu::Run(u32 cycles, NullProfiler &profiler);
+template u32 Cpu::Run(u32 cycles, Profiler &profiler);
+template u32 Cpu::Run(u32 cycles, TraceRecorder &profiler);
+
+void Cpu::SaveState(State &state)
+{
+		static_assert(sizeof(State) == ram_size + sizeof(u64) * (screen_height + 2) + sizeof(u16) * (stack_entries + 3) + data_registers + 4 + sizeof State::reserved, "Cpu::State must not contain padding");
+
+		memcpy(state.ram, m_ram, sizeof state.ram);
+		memcpy(state.screen, m_screen, sizeof state.screen);
+		memcpy(state.stack, m_stack, sizeof state.stack);
+		memcpy(state.registers, m_data_registers, sizeof state.registers);
+		state.cycles = m_cycles;
+		state.random = m_random;
+		state.pc = m_pc;
+		state.i = m_i;
+		state.keys = m_keys;
+		state.stack_pointer = m_stack_pointer;
+		state.delay_timer = GetDelayTimer();
+		state.sound_timer = GetSoundTimer();
+		state.fault = m_fault;
+		memset(state.reserved, NULL, sizeof state.reserved);
+}
+
+void Cpu::SetCyclesPerTick(u32 cycles_per_tick)
+{
+		// Restart both timers from their current values, so a new rate only
+		// applies to the ticks still to come.
+		m_delay_timer = GetDelayTimer();
+		m_delay_timer_cycle = m_cycles;
+		m_sound_timer = GetSoundTimer();
+		m_sound_timer_cycle = m_cycles;
+		m_cycles_per_tick = cycles_per_tick;
 }
 
 void Cpu::SetDataRegister(DataRegisters data_register, u8 byte)
@@ -160,15 +877,29 @@ void Cpu::SetDataRegister(DataRegisters data_register, u8 byte)
 
 void Cpu::SetDataRegisters(DataRegisters data_register)
 {
+		if (m_quirks & index_increments)
+				SetDataRegisters<index_increments>(data_register);
+		else
+				SetDataRegisters<0>(data_register);
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::SetDataRegisters(DataRegisters data_register)
+{
+		u16 index = m_i;
+
 		for (u8 current_data_register = 0; current_data_register <= static_cast<u8>(data_register); ++current_data_register)
 		{
-				m_data_registers[current_data_register] = m_ram[m_i++];
+				m_data_registers[current_data_register] = m_ram[ConvertAddress(index++)];
 		}
+
+		m_i = quirks & index_increments ? index : m_i;
 }
 
 void Cpu::SetDelayTimer(DataRegisters data_register)
 {
 		m_delay_timer = GetDataRegister(data_register);
+		m_delay_timer_cycle = m_cycles;
 }
 
 void Cpu::SetIndex(u16 address)
@@ -176,9 +907,35 @@ void Cpu::SetIndex(u16 address)
 		m_i = address;
 }
 
+void Cpu::SetKey(u8 key, bool pressed)
+{
+		u16 mask = 1 << (key % keys);
+
+		if (pressed)
+				m_keys |= mask;
+		else
+				m_keys &= ~mask;
+}
+
+void Cpu::SetQuirks(Quirks quirks)
+{
+		m_quirks = quirks % quirk_combinations;
+}
+
+void Cpu::SetRandomGenerator(RandomGenerator random_generator)
+{
+		m_random_generator = random_generator;
+}
+
+void Cpu::SetSeed(u64 seed)
+{
+		m_random = seed;
+}
+
 void Cpu::SetSoundTimer(DataRegisters data_register)
 {
 		m_sound_timer = GetDataRegister(data_register);
+		m_sound_timer_cycle = m_cycles;
 }
 
 void Cpu::SetTextCharacter(DataRegisters data_register)
@@ -191,9 +948,18 @@ void Cpu::SetTextCharacter(DataRegisters data_register)
 
 void Cpu::ShiftRegisterLeft(DataRegisters data_register_x, DataRegisters data_register_y)
 {
-		u8 data_register_y_value = GetDataRegister(data_register_y);
-		u8 result = data_register_y_value << 1;
-		u8 most_significant_bit = (data_register_y_value & 0x80) >> 7;
+		if (m_quirks & shift_uses_vy)
+				ShiftRegisterLeft<shift_uses_vy>(data_register_x, data_register_y);
+		else
+				ShiftRegisterLeft<0>(data_register_x, data_register_y);
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::ShiftRegisterLeft(DataRegisters data_register_x, DataRegisters data_register_y)
+{
+		u8 value = GetDataRegister(quirks & shift_uses_vy ? data_register_y : data_register_x);
+		u8 result = value << 1;
+		u8 most_significant_bit = (value & 0x80) >> 7;
 
 		SetDataRegister(data_register_x, result);
 		SetDataRegister(DataRegisters::vF, most_significant_bit);
@@ -201,9 +967,18 @@ void Cpu::ShiftRegisterLeft(DataRegisters data_register_x, DataRegisters data_re
 
 void Cpu::ShiftRegisterRight(DataRegisters data_register_x, DataRegisters data_register_y)
 {
-		u8 data_register_y_value = GetDataRegister(data_register_y);
-		u8 result = data_register_y_value >> 1;
-		u8 least_significant_bit = data_register_y_value & 0x01;
+		if (m_quirks & shift_uses_vy)
+				ShiftRegisterRight<shift_uses_vy>(data_register_x, data_register_y);
+		else
+				ShiftRegisterRight<0>(data_register_x, data_register_y);
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::ShiftRegisterRight(DataRegisters data_register_x, DataRegisters data_register_y)
+{
+		u8 value = GetDataRegister(quirks & shift_uses_vy ? data_register_y : data_register_x);
+		u8 result = value >> 1;
+		u8 least_significant_bit = value & 0x01;
 
 		SetDataRegister(data_register_x, result);
 		SetDataRegister(DataRegisters::vF, least_significant_bit);
@@ -221,6 +996,18 @@ void Cpu::SkipEqualRegister(DataRegisters data_register_x, DataRegisters data_re
 				m_pc += 2;
 }
 
+void Cpu::SkipKeyNotPressed(DataRegisters data_register)
+{
+		if (!IsKeyPressed(GetDataRegister(data_register)))
+				m_pc += 2;
+}
+
+void Cpu::SkipKeyPressed(DataRegisters data_register)
+{
+		if (IsKeyPressed(GetDataRegister(data_register)))
+				m_pc += 2;
+}
+
 void Cpu::SkipNotEqualByte(DataRegisters data_register, u8 byte)
 {
 		if (GetDataRegister(data_register) != byte)
@@ -233,6 +1020,75 @@ void Cpu::SkipNotEqualRegister(DataRegisters data_register_x, DataRegisters data
 				m_pc += 2;
 }
 
+u32 Cpu::SkipIdleLoop(u32 cycles)
+{
+		u16 pc = ConvertAddress(m_pc);
+		u16 opcode = m_ram[pc] << 8 | m_ram[ConvertAddress(pc + 1)];
+		u16 jump_back = 0x1000 | pc;
+
+		// JP to itself never gets anywhere, and neither does FX0A before the
+		// host presses a key.
+		if (opcode == jump_back || IsWaitingForKey())
+		{
+				AddCycles(cycles);
+				return cycles;
+		}
+
+		u16 operation = opcode & 0xF0FF;
+
+		if (operation != 0xE09E && operation != 0xE0A1 && operation != 0xF007)
+				return 0;
+
+		u8 x = (opcode & 0x0F00) >> 8;
+		u16 next_opcode = m_ram[ConvertAddress(pc + 2)] << 8 | m_ram[ConvertAddress(pc + 3)];
+
+		// SKP or SKNP followed by a jump back spins until the host changes the
+		// key, which can't happen before Run returns.
+		if (operation != 0xF007)
+		{
+				if (next_opcode != jump_back || IsKeyPressed(m_data_registers[x]) == (operation == 0xE09E))
+						return 0;
+
+				u32 skipped = cycles - cycles % 2;
+
+				AddCycles(skipped);
+				return skipped;
+		}
+
+		// LD Vx, DT; SE Vx, 0; JP back polls the delay timer until it expires,
+		// so whole iterations up to the one that reads zero can be skipped.
+		u16 last_opcode = m_ram[ConvertAddress(pc + 4)] << 8 | m_ram[ConvertAddress(pc + 5)];
+
+		if (next_opcode != (0x3000 | x << 8) || last_opcode != jump_back || !GetDelayTimer())
+				return 0;
+
+		u32 iterations = cycles / 3;
+
+		if (m_cycles_per_tick)
+		{
+				u64 expiry = (m_delay_timer_cycle / m_cycles_per_tick + m_delay_timer) * m_cycles_per_tick;
+				u64 remaining = (expiry - m_cycles + 2) / 3;
+
+				if (remaining < iterations)
+						iterations = static_cast<u32>(remaining);
+		}
+
+		if (!iterations)
+				return 0;
+
+		// Leave Vx as the last skipped iteration would have.
+		m_cycles += 3 * (iterations - 1);
+		m_data_registers[x] = GetDelayTimer();
+		m_cycles += 3;
+
+		return 3 * iterations;
+}
+
+void Cpu::Step()
+{
+		Execute(Decode(Fetch(), m_quirks));
+}
+
 void Cpu::StoreAddress(u16 address)
 {
 		SetIndex(ConvertAddress(address));
@@ -248,7 +1104,8 @@ void Cpu::StoreBinaryCodedDecimal(DataRegisters data_register)
 
 		for (digit; digit < digits; ++digit)
 		{
-				m_ram[index + offset] = value % 10;
+				m_ram[ConvertAddress(index + offset)] = value % 10;
+				MarkWritten(index + offset);
 				value /= 10;
 				--offset;
 		}
@@ -261,11 +1118,8 @@ void Cpu::StoreDelayTimer(DataRegisters data_register)
 
 void Cpu::StoreRandomNumber(DataRegisters data_register, u8 mask)
 {
-		static std::random_device random_device;
-		static std::mt19937 mt19937(random_device());
-		static std::uniform_int_distribution<u32> uniform_int_distribution(0, UCHAR_MAX);
-		
-		u8 random_number = uniform_int_distribution(mt19937) & mask;
+		u8 random_number = m_random_generator(m_random) & mask;
+
 		SetDataRegister(data_register, random_number);
 }
 
@@ -276,10 +1130,24 @@ void Cpu::StoreDataRegister(DataRegisters data_register_x, DataRegisters data_re
 
 void Cpu::StoreDataRegisters(DataRegisters data_register)
 {
+		if (m_quirks & index_increments)
+				StoreDataRegisters<index_increments>(data_register);
+		else
+				StoreDataRegisters<0>(data_register);
+}
+
+template <Cpu::Quirks quirks>
+void Cpu::StoreDataRegisters(DataRegisters data_register)
+{
+		u16 index = m_i;
+
 		for (u8 current_data_register = 0; current_data_register <= static_cast<u8>(data_register); ++current_data_register)
 		{
-				m_ram[m_i++] = m_data_registers[current_data_register];
+				MarkWritten(index);
+				m_ram[ConvertAddress(index++)] = m_data_registers[current_data_register];
 		}
+
+		m_i = quirks & index_increments ? index : m_i;
 }
 
 void Cpu::SubtractRegister(DataRegisters data_register_x, DataRegisters data_register_y)
@@ -304,9 +1172,62 @@ void Cpu::SubtractRegisters(DataRegisters data_register_x, DataRegisters data_re
 		SetDataRegister(DataRegisters::vF, borrow_flag);
 }
 
+u64 Cpu::TakeWrittenPages()
+{
+		u64 written_pages = m_written_pages;
+
+		m_written_pages = 0;
+
+		return written_pages;
+}
+
+void Cpu::UnpackScreen(u8 *pixels)
+{
+		for (u8 y = 0; y < screen_height; ++y)
+		{
+				for (u8 x = 0; x < screen_width; ++x)
+				{
+						pixels[y * screen_width + x] = GetPixel(x, y);
+				}
+		}
+}
+
+void Cpu::WaitKey(DataRegisters data_register)
+{
+		// Without a key the instruction runs again, so the wait shows in the
+		// program counter and ends on the first cycle a key is down.
+		if (!m_keys)
+		{
+				m_pc = ConvertAddress(m_pc - 2);
+				return;
+		}
+
+		u8 key = 0;
+
+		while (!((m_keys >> key) & 1))
+		{
+				++key;
+		}
+
+		SetDataRegister(data_register, key);
+}
+
 void Cpu::XorRegisters(DataRegisters data_register_x, DataRegisters data_register_y)
 {
 		u8 result = GetDataRegister(data_register_x) ^ GetDataRegister(data_register_y);
 
 		SetDataRegister(data_register_x, result);
-}
\ No newline at end of file
+}
+
+u8 Cpu::Xorshift(u64 &state)
+{
+		// Zero is the one state xorshift never leaves.
+		if (!state)
+				state = 0x9E3779B97F4A7C15ULL;
+
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+
+		return static_cast<u8>(state >> 56);
+}
@@ -1,13 +1,16 @@
 #pragma once
 
 #include <cstdint>
-#include <stack>
 
 using u8 = std::uint8_t;
 using u16 = std::uint16_t;
 using u32 = std::uint32_t;
+using u64 = std::uint64_t;
 
-class Cpu
+// Hot state leads the object and the object is cache line aligned, so V0-VF,
+// PC, I, SP, the timers and the fault share one line. Cpu owns no heap memory
+// and is trivially copyable, so instances can be copied and pooled with memcpy.
+class alignas(64) Cpu
 {
 public:
 		static const u8 data_registers	= 0x10;
@@ -15,9 +18,27 @@ public:
 		static const u8 screen_width		= 0x40;
 		static const u8 screen_height		= 0x20;
 		static const u8 font_length			= 0x05;
+		static const u8 keys						= 0x10;
 
-		static const u16 ram_size				= 0xFFF;
+		static const u16 ram_size				= 0x1000;
+		static const u16 program_start	= 0x200;
+		static const u16 program_size		= ram_size - program_start;
 		static const u16 screen_size		= screen_width * screen_height;
+		static const u16 page_size			= 0x40;
+
+		// Interpreters disagree on a few instructions, one bit each. The COSMAC
+		// VIP does all of these, which is the default, while CHIP-48 and
+		// SUPER-CHIP programs expect only jump_wraps: shifts work on VX in
+		// place, FX55/FX65 leave I alone and BXNN adds VX.
+		using Quirks = u8;
+
+		static const Quirks shift_uses_vy		= 0x01;
+		static const Quirks index_increments	= 0x02;
+		static const Quirks jump_plus_uses_v0	= 0x04;
+		static const Quirks jump_wraps			= 0x08;
+		static const Quirks cosmac_vip_quirks	= 0x0F;
+		static const Quirks chip48_quirks		= jump_wraps;
+		static const u8 quirk_combinations		= 0x10;
 
 		enum class DataRegisters
 				: u8
@@ -28,21 +49,168 @@ public:
 				vC, vD, vE, vF
 		};
 
+		// What an opcode does, one value for each Cpu method an opcode can
+		// run, so tools share the opcode map the Cpu decodes with.
+		enum class Operation
+				: u8
+		{
+				invalid,
+				machine_routine,
+				clear_screen,
+				return_,
+				jump,
+				call,
+				skip_equal_byte,
+				skip_not_equal_byte,
+				skip_equal_register,
+				store_byte,
+				add_byte,
+				store_data_register,
+				or_registers,
+				and_registers,
+				xor_registers,
+				add_registers,
+				subtract_register,
+				shift_register_right,
+				subtract_registers,
+				shift_register_left,
+				skip_not_equal_register,
+				store_address,
+				jump_plus,
+				store_random_number,
+				draw_sprite,
+				skip_key_pressed,
+				skip_key_not_pressed,
+				store_delay_timer,
+				wait_key,
+				set_delay_timer,
+				set_sound_timer,
+				add_index,
+				set_text_character,
+				store_binary_coded_decimal,
+				store_data_registers,
+				set_data_registers
+		};
+
+		enum class Fault
+				: u8
+		{
+				none,
+				invalid_opcode,
+				stack_overflow,
+				stack_underflow
+		};
+
+		struct Instruction;
+
+		// Advances the generator state and returns the next random byte.
+		using RandomGenerator = u8 (*)(u64 &state);
+
+		// Handlers receive the already decoded operands, so executing an
+		// instruction never has to pick the opcode apart again.
+		using Handler = void (*)(Cpu &cpu, const Instruction &instruction);
+
+		struct Instruction
+		{
+				Handler handler;
+				u16 address;
+				u8 byte;
+				u8 nibble;
+				DataRegisters data_register_x;
+				DataRegisters data_register_y;
+		};
+
+		// Everything a snapshot restores, laid out without padding so snapshots
+		// can be compared and diffed as raw bytes.
+		struct State
+		{
+				u8 ram[ram_size];
+				u64 screen[screen_height];
+				u64 cycles;
+				u64 random;
+				u16 stack[stack_entries];
+				u8 registers[data_registers];
+				u16 pc;
+				u16 i;
+				u16 keys;
+				u8 stack_pointer;
+				u8 delay_timer;
+				u8 sound_timer;
+				Fault fault;
+				u8 reserved[6];
+		};
+
 		Cpu();
-		~Cpu();
+
+		// The handlers of every combination of quirks are instantiated with the
+		// quirks as a template argument, so they never test one at run time;
+		// decoding picks the handler table of the quirks asked for.
+		static Instruction Decode(u16 opcode, Quirks quirks = cosmac_vip_quirks);
+
+		static Operation GetOperation(u16 opcode);
+
+		// The name of the Cpu method an opcode runs, such as "AddByte".
+		static const char *GetOperationName(u16 opcode);
+
+		bool LoadProgram(const u8 *program, u16 size);
+		void LoadState(const State &state);
+		void SaveState(State &state);
+		u16 Fetch();
+		void Execute(const Instruction &instruction);
+		void Step();
+		u32 Run(u32 cycles);
+
+		// Runs like Run while reporting every instruction and skipped idle loop
+		// to profiler, and the registers and I each of them left behind.
+		// Instantiated for NullProfiler, which Run itself uses, Profiler and
+		// TraceRecorder.
+		template <typename Profiler>
+		u32 Run(u32 cycles, Profiler &profiler);
+
+		// Fast forwards through a side effect free spin loop at the program
+		// counter in whole iterations of at most cycles cycles, leaving the Cpu
+		// as if it had run them, and returns how many cycles it skipped.
+		u32 SkipIdleLoop(u32 cycles);
+		void AddCycles(u32 cycles);
 
 		u8 GetDataRegister(DataRegisters data_register);
 		void SetDataRegister(DataRegisters data_register, u8 byte);
 		const u8 *GetRam();
 		const u8 *GetDataRegisters();
-		const u8 *GetScreen();
+		u32 GetDirtyRows();
+		bool GetPixel(u8 x, u8 y);
+		const u64 *GetScreen();
+		u32 PublishFrame(u64 *screen);
+		void UnpackScreen(u8 *pixels);
 
 		u8 GetDelayTimer();
 		u8 GetSoundTimer();
+		u32 GetCyclesPerTick();
+		void SetCyclesPerTick(u32 cycles_per_tick);
 
 		u16 GetProgramCounter();
 		u16 GetIndex();
 		u16 GetStack();
+		u8 GetStackPointer();
+
+		bool IsKeyPressed(u8 key);
+		void SetKey(u8 key, bool pressed);
+
+		// True while the program counter is on an FX0A that no pressed key
+		// can finish, so running on only burns cycles until the keys change.
+		bool IsWaitingForKey();
+
+		Quirks GetQuirks();
+		void SetQuirks(Quirks quirks);
+
+		void SetRandomGenerator(RandomGenerator random_generator);
+		void SetSeed(u64 seed);
+		static u8 Pcg(u64 &state);
+		static u8 Xorshift(u64 &state);
+
+		u64 GetCycles();
+		Fault GetFault();
+		u64 TakeWrittenPages();
 
 		void AddByte(DataRegisters data_register, u8 byte);
 		void AddIndex(DataRegisters data_register);
@@ -50,6 +218,7 @@ public:
 		void AndRegisters(DataRegisters data_register_x, DataRegisters data_register_y);
 		void Call(u16 address);
 		void ClearScreen();
+		void DrawSprite(DataRegisters data_register_x, DataRegisters data_register_y, u8 rows);
 		void Jump(u16 address);
 		void JumpPlus(u16 address);
 		void OrRegisters(DataRegisters data_register_x, DataRegisters data_register_y);
@@ -62,6 +231,8 @@ public:
 		void ShiftRegisterRight(DataRegisters data_register_x, DataRegisters data_register_y);
 		void SkipEqualByte(DataRegisters data_register, u8 byte);
 		void SkipEqualRegister(DataRegisters data_register_x, DataRegisters data_register_y);
+		void SkipKeyNotPressed(DataRegisters data_register);
+		void SkipKeyPressed(DataRegisters data_register);
 		void SkipNotEqualByte(DataRegisters data_register, u8 byte);
 		void SkipNotEqualRegister(DataRegisters data_register_x, DataRegisters data_register_y);
 		void StoreAddress(u16 address);
@@ -72,21 +243,101 @@ public:
 		void StoreDataRegisters(DataRegisters data_register);
 		void SubtractRegister(DataRegisters data_register_x, DataRegisters data_register_y);
 		void SubtractRegisters(DataRegisters data_register_x, DataRegisters data_register_y);
+		void WaitKey(DataRegisters data_register);
 		void XorRegisters(DataRegisters data_register_x, DataRegisters data_register_y);
 
 private:
-		u8 m_ram[ram_size];
-		u8 m_screen[screen_size];
+		friend class CachedInterpreter;
+		friend class JitCompiler;
+
 		u8 m_data_registers[data_registers];
+		u16 m_pc;
+		u16 m_i;
+		u8 m_stack_pointer;
 		u8 m_delay_timer;
 		u8 m_sound_timer;
+		Fault m_fault;
+		Quirks m_quirks;
+		u16 m_keys;
 
-		u16 m_pc;
-		u16 m_i;
+		// One bit per screen row changed since the last PublishFrame.
+		u32 m_dirty_rows;
+		u64 m_cycles;
+
+		// The timers hold the value they were set to and count down one tick
+		// every m_cycles_per_tick cycles since, so they cost nothing to run and
+		// are only computed when read. Zero cycles per tick stops them.
+		u32 m_cycles_per_tick;
+		u64 m_delay_timer_cycle;
+		u64 m_sound_timer_cycle;
+		u64 m_random;
+		RandomGenerator m_random_generator;
+
+		// One bit per page_size bytes of ram the guest has written since the
+		// last TakeWrittenPages, so decode caches know what to throw away.
+		u64 m_written_pages;
+		u16 m_stack[stack_entries];
 
-		std::stack<u16> m_stack;
+		// One u64 per row with the leftmost pixel in the most significant bit,
+		// so a sprite row is drawn with a rotate, an and and an xor.
+		u64 m_screen[screen_height];
+		u8 m_ram[ram_size];
+
+		template <Quirks quirks>
+		struct Handlers;
+
+		static const Handler *const handler_tables[quirk_combinations];
 
 		u16 ConvertAddress(u16 address);
+		u8 CountDown(u8 timer, u64 timer_cycle);
 		void LoadFont();
+		void MarkWritten(u16 address);
+		void RaiseFault(Fault fault);
 		void SetIndex(u16 address);
+
+		// The instructions quirks change, as the handlers of each combination
+		// run them. The public versions follow the quirks set on the Cpu.
+		template <Quirks quirks> void Jump(u16 address);
+		template <Quirks quirks> void JumpPlus(u16 address);
+		template <Quirks quirks> void SetDataRegisters(DataRegisters data_register);
+		template <Quirks quirks> void ShiftRegisterLeft(DataRegisters data_register_x, DataRegisters data_register_y);
+		template <Quirks quirks> void ShiftRegisterRight(DataRegisters data_register_x, DataRegisters data_register_y);
+		template <Quirks quirks> void StoreDataRegisters(DataRegisters data_register);
+
+		static void ExecuteAddByte(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteAddIndex(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteAddRegisters(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteAndRegisters(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteCall(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteClearScreen(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteDrawSprite(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteInvalid(Cpu &cpu, const Instruction &instruction);
+		template <Quirks quirks> static void ExecuteJump(Cpu &cpu, const Instruction &instruction);
+		template <Quirks quirks> static void ExecuteJumpPlus(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteMachineRoutine(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteOrRegisters(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteReturn(Cpu &cpu, const Instruction &instruction);
+		template <Quirks quirks> static void ExecuteSetDataRegisters(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSetDelayTimer(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSetSoundTimer(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSetTextCharacter(Cpu &cpu, const Instruction &instruction);
+		template <Quirks quirks> static void ExecuteShiftRegisterLeft(Cpu &cpu, const Instruction &instruction);
+		template <Quirks quirks> static void ExecuteShiftRegisterRight(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSkipEqualByte(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSkipEqualRegister(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSkipKeyNotPressed(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSkipKeyPressed(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSkipNotEqualByte(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSkipNotEqualRegister(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteStoreAddress(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteStoreBinaryCodedDecimal(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteStoreByte(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteStoreDataRegister(Cpu &cpu, const Instruction &instruction);
+		template <Quirks quirks> static void ExecuteStoreDataRegisters(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteStoreDelayTimer(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteStoreRandomNumber(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSubtractRegister(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteSubtractRegisters(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteWaitKey(Cpu &cpu, const Instruction &instruction);
+		static void ExecuteXorRegisters(Cpu &cpu, const Instruction &instruction);
 };
\ No newline at end of file
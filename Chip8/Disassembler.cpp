@@ -0,0 +1,364 @@
+#include "Disassembler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using Operation = Cpu::Operation;
+
+namespace
+{
+		const u8 data_bytes_per_line = 8;
+
+		bool IsSkip(Operation operation)
+		{
+				switch (operation)
+				{
+				case Operation::skip_equal_byte:
+				case Operation::skip_not_equal_byte:
+				case Operation::skip_equal_register:
+				case Operation::skip_not_equal_register:
+				case Operation::skip_key_pressed:
+				case Operation::skip_key_not_pressed:
+						return true;
+				default:
+						return false;
+				}
+		}
+}
+
+Disassembler::Disassembler(const u8 *program, u16 size, Cpu::Quirks quirks)
+		: m_program_size(std::min(size, static_cast<u16>(Cpu::program_size))),
+		m_quirks(quirks),
+		m_instructions(Cpu::ram_size),
+		m_code_bytes(Cpu::ram_size),
+		m_leaders(Cpu::ram_size)
+{
+		memset(m_ram, NULL, sizeof m_ram);
+		memcpy(m_ram + Cpu::program_start, program, m_program_size);
+		FollowControlFlow();
+		BuildBlocks();
+		FindDataRegions();
+}
+
+Disassembler::~Disassembler()
+{
+}
+
+void Disassembler::BuildBlocks()
+{
+		BasicBlock block = {};
+		bool open = false;
+
+		// A block that ends without leaving on its own runs on into the next
+		// instruction, unless there is none.
+		auto close = [&]()
+		{
+				u16 next = block.address + block.size;
+
+				if (IsInProgram(next) && m_instructions[next])
+				{
+						block.exit = Exit::falls_through;
+						block.successors.push_back(next);
+				}
+				else
+				{
+						block.exit = Exit::stops;
+				}
+
+				m_blocks.push_back(block);
+				open = false;
+		};
+
+		for (u16 address = Cpu::program_start; address < Cpu::program_start + m_program_size; ++address)
+		{
+				if (!m_instructions[address])
+						continue;
+
+				if (open && (m_leaders[address] || block.address + block.size != address))
+						close();
+
+				if (!open)
+				{
+						block = { address, 0, 0, Exit::falls_through, {} };
+						open = true;
+				}
+
+				u16 opcode = GetOpcode(address);
+				Operation operation = Cpu::GetOperation(opcode);
+				u16 next = address + 2;
+
+				block.size += 2;
+				++block.instructions;
+
+				switch (operation)
+				{
+				case Operation::jump:
+						block.exit = Exit::jump;
+						block.successors = { static_cast<u16>(opcode & 0x0FFF) };
+						break;
+				case Operation::call:
+						block.exit = Exit::call;
+						block.successors = { static_cast<u16>(opcode & 0x0FFF), next };
+						break;
+				case Operation::return_:
+						block.exit = Exit::return_;
+						break;
+				case Operation::jump_plus:
+						block.exit = Exit::computed_jump;
+						break;
+				case Operation::invalid:
+						block.exit = Exit::stops;
+						break;
+				default:
+						if (!IsSkip(operation))
+								continue;
+
+						block.exit = Exit::skip;
+						block.successors = { next, static_cast<u16>(next + 2) };
+						break;
+				}
+
+				m_blocks.push_back(block);
+				open = false;
+		}
+
+		if (open)
+				close();
+}
+
+std::string Disassembler::Disassemble(u16 opcode, Cpu::Quirks quirks)
+{
+		u8 x = (opcode & 0x0F00) >> 8;
+		u8 y = (opcode & 0x00F0) >> 4;
+		u8 byte = opcode & 0x00FF;
+		u16 address = opcode & 0x0FFF;
+		char text[32];
+
+		switch (Cpu::GetOperation(opcode))
+		{
+		case Operation::machine_routine: snprintf(text, sizeof text, "SYS 0x%03X", address); break;
+		case Operation::clear_screen: snprintf(text, sizeof text, "CLS"); break;
+		case Operation::return_: snprintf(text, sizeof text, "RET"); break;
+		case Operation::jump: snprintf(text, sizeof text, "JP 0x%03X", address); break;
+		case Operation::call: snprintf(text, sizeof text, "CALL 0x%03X", address); break;
+		case Operation::skip_equal_byte: snprintf(text, sizeof text, "SE V%X, 0x%02X", x, byte); break;
+		case Operation::skip_not_equal_byte: snprintf(text, sizeof text, "SNE V%X, 0x%02X", x, byte); break;
+		case Operation::skip_equal_register: snprintf(text, sizeof text, "SE V%X, V%X", x, y); break;
+		case Operation::store_byte: snprintf(text, sizeof text, "LD V%X, 0x%02X", x, byte); break;
+		case Operation::add_byte: snprintf(text, sizeof text, "ADD V%X, 0x%02X", x, byte); break;
+		case Operation::store_data_register: snprintf(text, sizeof text, "LD V%X, V%X", x, y); break;
+		case Operation::or_registers: snprintf(text, sizeof text, "OR V%X, V%X", x, y); break;
+		case Operation::and_registers: snprintf(text, sizeof text, "AND V%X, V%X", x, y); break;
+		case Operation::xor_registers: snprintf(text, sizeof text, "XOR V%X, V%X", x, y); break;
+		case Operation::add_registers: snprintf(text, sizeof text, "ADD V%X, V%X", x, y); break;
+		case Operation::subtract_register: snprintf(text, sizeof text, "SUB V%X, V%X", x, y); break;
+		case Operation::subtract_registers: snprintf(text, sizeof text, "SUBN V%X, V%X", x, y); break;
+		case Operation::skip_not_equal_register: snprintf(text, sizeof text, "SNE V%X, V%X", x, y); break;
+		case Operation::store_address: snprintf(text, sizeof text, "LD I, 0x%03X", address); break;
+		case Operation::store_random_number: snprintf(text, sizeof text, "RND V%X, 0x%02X", x, byte); break;
+		case Operation::draw_sprite: snprintf(text, sizeof text, "DRW V%X, V%X, 0x%X", x, y, opcode & 0x000F); break;
+		case Operation::skip_key_pressed: snprintf(text, sizeof text, "SKP V%X", x); break;
+		case Operation::skip_key_not_pressed: snprintf(text, sizeof text, "SKNP V%X", x); break;
+		case Operation::store_delay_timer: snprintf(text, sizeof text, "LD V%X, DT", x); break;
+		case Operation::wait_key: snprintf(text, sizeof text, "LD V%X, K", x); break;
+		case Operation::set_delay_timer: snprintf(text, sizeof text, "LD DT, V%X", x); break;
+		case Operation::set_sound_timer: snprintf(text, sizeof text, "LD ST, V%X", x); break;
+		case Operation::add_index: snprintf(text, sizeof text, "ADD I, V%X", x); break;
+		case Operation::set_text_character: snprintf(text, sizeof text, "LD F, V%X", x); break;
+		case Operation::store_binary_coded_decimal: snprintf(text, sizeof text, "LD B, V%X", x); break;
+		case Operation::store_data_registers: snprintf(text, sizeof text, "LD [I], V%X", x); break;
+		case Operation::set_data_registers: snprintf(text, sizeof text, "LD V%X, [I]", x); break;
+
+		// Quirks change the registers these work on.
+		case Operation::shift_register_right:
+				if (quirks & Cpu::shift_uses_vy)
+						snprintf(text, sizeof text, "SHR V%X, V%X", x, y);
+				else
+						snprintf(text, sizeof text, "SHR V%X", x);
+				break;
+		case Operation::shift_register_left:
+				if (quirks & Cpu::shift_uses_vy)
+						snprintf(text, sizeof text, "SHL V%X, V%X", x, y);
+				else
+						snprintf(text, sizeof text, "SHL V%X", x);
+				break;
+		case Operation::jump_plus:
+				snprintf(text, sizeof text, "JP V%X, 0x%03X", quirks & Cpu::jump_plus_uses_v0 ? 0 : x, address);
+				break;
+
+		default:
+				snprintf(text, sizeof text, "DW 0x%04X", opcode);
+				break;
+		}
+
+		return text;
+}
+
+void Disassembler::FindDataRegions()
+{
+		for (u16 address = Cpu::program_start; address < Cpu::program_start + m_program_size; ++address)
+		{
+				if (m_code_bytes[address])
+						continue;
+
+				if (!m_data_regions.empty() && m_data_regions.back().address + m_data_regions.back().size == address)
+						++m_data_regions.back().size;
+				else
+						m_data_regions.push_back({ address, 1 });
+		}
+}
+
+void Disassembler::FollowControlFlow()
+{
+		u16 program_start = Cpu::program_start;
+		std::vector<u16> pending(1, program_start);
+
+		m_leaders[program_start] = true;
+
+		while (!pending.empty())
+		{
+				u16 address = pending.back();
+
+				pending.pop_back();
+
+				if (!IsInProgram(address) || !IsInProgram(address + 1) || m_instructions[address])
+						continue;
+
+				u16 opcode = GetOpcode(address);
+				Operation operation = Cpu::GetOperation(opcode);
+				u16 next = address + 2;
+				u16 target = opcode & 0x0FFF;
+
+				m_instructions[address] = true;
+				m_code_bytes[address] = true;
+				m_code_bytes[address + 1] = true;
+
+				switch (operation)
+				{
+				case Operation::jump:
+						m_leaders[target] = true;
+						pending.push_back(target);
+						break;
+				case Operation::call:
+						m_leaders[target] = true;
+						m_leaders[next % Cpu::ram_size] = true;
+						pending.push_back(next);
+						pending.push_back(target);
+						break;
+				case Operation::jump_plus:
+						m_computed_jumps.push_back(address);
+						break;
+				case Operation::return_:
+				case Operation::invalid:
+						break;
+				default:
+						pending.push_back(next);
+
+						if (IsSkip(operation))
+						{
+								m_leaders[next % Cpu::ram_size] = true;
+								m_leaders[(next + 2) % Cpu::ram_size] = true;
+								pending.push_back(next + 2);
+						}
+						break;
+				}
+		}
+
+		std::sort(m_computed_jumps.begin(), m_computed_jumps.end());
+}
+
+std::vector<u16> Disassembler::GetBlockAddresses()
+{
+		std::vector<u16> addresses;
+
+		for (const BasicBlock &block : m_blocks)
+		{
+				addresses.push_back(block.address);
+		}
+
+		return addresses;
+}
+
+const std::vector<Disassembler::BasicBlock> &Disassembler::GetBlocks()
+{
+		return m_blocks;
+}
+
+const std::vector<u16> &Disassembler::GetComputedJumps()
+{
+		return m_computed_jumps;
+}
+
+const std::vector<Disassembler::DataRegion> &Disassembler::GetDataRegions()
+{
+		return m_data_regions;
+}
+
+std::string Disassembler::GetListing()
+{
+		std::string listing;
+		char line[80];
+		size_t block = 0;
+		size_t data_region = 0;
+
+		// Blocks and data regions never overlap, so they are listed by merging
+		// the two in address order.
+		while (block < m_blocks.size() || data_region < m_data_regions.size())
+		{
+				if (data_region == m_data_regions.size() || (block < m_blocks.size() && m_blocks[block].address < m_data_regions[data_region].address))
+				{
+						const BasicBlock &basic_block = m_blocks[block++];
+
+						snprintf(line, sizeof line, "block_%03X:\n", basic_block.address);
+						listing += line;
+
+						for (u16 instruction = 0; instruction < basic_block.instructions; ++instruction)
+						{
+								u16 address = basic_block.address + instruction * 2;
+								u16 opcode = GetOpcode(address);
+								const char *comment = Cpu::GetOperation(opcode) == Operation::jump_plus ? "\t; computed jump" : "";
+
+								snprintf(line, sizeof line, "\t\t0x%03X  %04X  %s%s\n", address, opcode, Disassemble(opcode, m_quirks).c_str(), comment);
+								listing += line;
+						}
+				}
+				else
+				{
+						const DataRegion &region = m_data_regions[data_region++];
+
+						snprintf(line, sizeof line, "data_%03X:\n", region.address);
+						listing += line;
+
+						for (u16 offset = 0; offset < region.size; offset += data_bytes_per_line)
+						{
+								snprintf(line, sizeof line, "\t\t0x%03X        DB", region.address + offset);
+								listing += line;
+
+								for (u16 byte = offset; byte < region.size && byte < offset + data_bytes_per_line; ++byte)
+								{
+										snprintf(line, sizeof line, "%s 0x%02X", byte == offset ? "" : ",", m_ram[region.address + byte]);
+										listing += line;
+								}
+
+								listing += "\n";
+						}
+				}
+		}
+
+		return listing;
+}
+
+u16 Disassembler::GetOpcode(u16 address)
+{
+		return m_ram[address] << 8 | m_ram[(address + 1) % Cpu::ram_size];
+}
+
+bool Disassembler::IsCode(u16 address)
+{
+		return m_code_bytes[address % Cpu::ram_size];
+}
+
+bool Disassembler::IsInProgram(u16 address)
+{
+		return address >= Cpu::program_start && address < Cpu::program_start + m_program_size;
+}
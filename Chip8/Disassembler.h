@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Cpu.h"
+#include <string>
+#include <vector>
+
+// Decodes a program with the Cpu's own opcode map and recovers its control
+// flow graph by following jumps, calls, returns and skips from the entry
+// point. Computed jumps can't be followed and are reported instead, as are
+// the bytes no path reaches, which are taken to be data. A Disassembler only
+// reads its own copy of the program, so many can run on separate threads.
+class Disassembler
+{
+public:
+		// How control leaves a basic block.
+		enum class Exit
+				: u8
+		{
+				// Into the next block, which something else jumps into.
+				falls_through,
+				jump,
+
+				// To the subroutine, and on to the next block once it returns.
+				call,
+				return_,
+
+				// To the next instruction or the one after it.
+				skip,
+				computed_jump,
+
+				// Runs into an invalid opcode or off the end of the program.
+				stops
+		};
+
+		struct BasicBlock
+		{
+				u16 address;
+				u16 size;
+				u16 instructions;
+				Exit exit;
+				std::vector<u16> successors;
+		};
+
+		struct DataRegion
+		{
+				u16 address;
+				u16 size;
+		};
+
+		Disassembler(const u8 *program, u16 size, Cpu::Quirks quirks = Cpu::cosmac_vip_quirks);
+		~Disassembler();
+
+		// Mnemonics in the usual CHIP-8 assembler syntax, such as "LD V0, 0x05".
+		// Quirks pick the operands shifts and BNNN are shown with.
+		static std::string Disassemble(u16 opcode, Cpu::Quirks quirks = Cpu::cosmac_vip_quirks);
+
+		// Basic blocks in address order.
+		const std::vector<BasicBlock> &GetBlocks();
+
+		// The addresses of the blocks, which is where a cache or compiler can
+		// start decoding before the program first runs.
+		std::vector<u16> GetBlockAddresses();
+		const std::vector<u16> &GetComputedJumps();
+		const std::vector<DataRegion> &GetDataRegions();
+		bool IsCode(u16 address);
+
+		// The whole program, one line per instruction or up to eight data bytes,
+		// with a label on every block.
+		std::string GetListing();
+
+private:
+		u8 m_ram[Cpu::ram_size];
+		u16 m_program_size;
+		Cpu::Quirks m_quirks;
+		std::vector<bool> m_instructions;
+		std::vector<bool> m_code_bytes;
+		std::vector<bool> m_leaders;
+		std::vector<BasicBlock> m_blocks;
+		std::vector<u16> m_computed_jumps;
+		std::vector<DataRegion> m_data_regions;
+
+		void BuildBlocks();
+		void FindDataRegions();
+		void FollowControlFlow();
+		u16 GetOpcode(u16 address);
+		bool IsInProgram(u16 address);
+};
@@ -0,0 +1,144 @@
+#include "DisplayWidget.h"
+#include <QtGui\qevent.h>
+#include <QtGui\qpainter.h>
+#include <algorithm>
+
+namespace
+{
+		// Weight of the newest paint in the running average of paint times.
+		const double paint_time_weight = 0.1;
+}
+
+DisplayWidget::DisplayWidget(QWidget *parent)
+		: QWidget(parent),
+		m_image_count(0),
+		m_frame(nullptr),
+		m_frame_image(nullptr),
+		m_image(nullptr),
+		m_filter(Upscaler::Filter::nearest),
+		m_scale(0),
+		m_paint_time(0.0)
+{
+		// Every pixel is painted, so Qt doesn't have to clear the background.
+		setAttribute(Qt::WA_OpaquePaintEvent);
+		setMinimumSize(Cpu::screen_width, Cpu::screen_height);
+
+		for (Image &image : m_images)
+		{
+				image.frame = nullptr;
+		}
+}
+
+DisplayWidget::~DisplayWidget()
+{
+}
+
+double DisplayWidget::GetPaintTime()
+{
+		return m_paint_time;
+}
+
+QRect DisplayWidget::GetScreenRect()
+{
+		// Whole multiples keep every emulated pixel the same size.
+		int scale = std::max(1, std::min(width() / Cpu::screen_width, height() / Cpu::screen_height));
+		int screen_width = Cpu::screen_width * scale;
+		int screen_height = Cpu::screen_height * scale;
+
+		return QRect((width() - screen_width) / 2, (height() - screen_height) / 2, screen_width, screen_height);
+}
+
+void DisplayWidget::paintEvent(QPaintEvent * /*event*/)
+{
+		m_paint_timer.start();
+
+		QPainter painter(this);
+		QRect screen_rect = GetScreenRect();
+
+		painter.fillRect(0, 0, width(), screen_rect.top(), Qt::black);
+		painter.fillRect(0, screen_rect.bottom() + 1, width(), height() - screen_rect.bottom() - 1, Qt::black);
+		painter.fillRect(0, screen_rect.top(), screen_rect.left(), screen_rect.height(), Qt::black);
+		painter.fillRect(screen_rect.right() + 1, screen_rect.top(), width() - screen_rect.right() - 1, screen_rect.height(), Qt::black);
+
+		if (m_image)
+				painter.drawImage(screen_rect, *m_image);
+		else
+				painter.fillRect(screen_rect, Qt::black);
+
+		painter.end();
+
+		double paint_time = m_paint_timer.nsecsElapsed() / 1000000.0;
+
+		m_paint_time = m_paint_time ? m_paint_time + (paint_time - m_paint_time) * paint_time_weight : paint_time;
+}
+
+void DisplayWidget::Render()
+{
+		if (!m_frame)
+				return;
+
+		if (m_filter == Upscaler::Filter::nearest)
+		{
+				m_image = m_frame_image;
+		}
+		else
+		{
+				// Filter at the largest multiple of the filter's factor that still
+				// fits, and leave the rest of the way to the blit.
+				int filter_scale = Upscaler::GetFilterScale(m_filter);
+				int max_scale = Upscaler::max_scale;
+				int fitting_scale = std::min(GetScreenRect().width() / Cpu::screen_width, max_scale);
+				u8 scale = static_cast<u8>(std::max(fitting_scale / filter_scale, 1) * filter_scale);
+				u32 stride = Cpu::screen_width * scale;
+
+				if (scale != m_scale)
+				{
+						m_scaled_image = QImage(reinterpret_cast<uchar *>(m_scaled_pixels.data()), stride, Cpu::screen_height * scale, stride * sizeof(u32), QImage::Format_RGB32);
+						m_scale = scale;
+				}
+
+				m_upscaler.Scale(*m_frame, m_filter, scale, m_scaled_pixels.data(), stride);
+				m_image = &m_scaled_image;
+		}
+
+		update(GetScreenRect());
+}
+
+void DisplayWidget::resizeEvent(QResizeEvent *event)
+{
+		QWidget::resizeEvent(event);
+
+		if (m_filter != Upscaler::Filter::nearest)
+				Render();
+}
+
+void DisplayWidget::SetFilter(Upscaler::Filter filter)
+{
+		if (m_scaled_pixels.empty())
+				m_scaled_pixels.resize(Cpu::screen_size * Upscaler::max_scale * Upscaler::max_scale);
+
+		m_filter = filter;
+		Render();
+}
+
+void DisplayWidget::SetFrame(const TripleBuffer::Frame &frame)
+{
+		Image *image = std::find_if(m_images, m_images + m_image_count, [&](const Image &cached) { return cached.frame == &frame; });
+
+		// Wrapping the frame through the non-const constructor keeps QImage
+		// from copying it when the color table is set.
+		if (image == m_images + m_image_count && m_image_count < frame_buffers)
+		{
+				image->frame = &frame;
+				image->image = QImage(const_cast<u8 *>(frame.pixels[0]), Cpu::screen_width, Cpu::screen_height, sizeof frame.pixels[0], QImage::Format_Mono);
+				image->image.setColorTable({ qRgb(0x00, 0x00, 0x00), qRgb(0xFF, 0xFF, 0xFF) });
+				++m_image_count;
+		}
+
+		if (image == m_images + frame_buffers)
+				return;
+
+		m_frame = &frame;
+		m_frame_image = &image->image;
+		Render();
+}
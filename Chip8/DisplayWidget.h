@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QtCore\qelapsedtimer.h>
+#include <QtGui\qimage.h>
+#include <QtWidgets\qwidget.h>
+#include "TripleBuffer.h"
+#include "Upscaler.h"
+#include <vector>
+
+// Shows TripleBuffer frames. Every frame buffer is wrapped in a Format_Mono
+// QImage once and each paint is a single scaled blit of the current one, so
+// painting neither converts pixels nor allocates. Other filters than nearest
+// run the Upscaler into a preallocated image once per frame instead. The
+// average time spent painting is tracked so it can be kept in check at large
+// window sizes.
+class DisplayWidget : public QWidget
+{
+public:
+		static const u8 frame_buffers = 3;
+
+		DisplayWidget(QWidget *parent = 0);
+		~DisplayWidget();
+
+		double GetPaintTime();
+		void SetFilter(Upscaler::Filter filter);
+		void SetFrame(const TripleBuffer::Frame &frame);
+
+protected:
+		void paintEvent(QPaintEvent *event) override;
+		void resizeEvent(QResizeEvent *event) override;
+
+private:
+		struct Image
+		{
+				const TripleBuffer::Frame *frame;
+				QImage image;
+		};
+
+		Image m_images[frame_buffers];
+		u8 m_image_count;
+		const TripleBuffer::Frame *m_frame;
+		const QImage *m_frame_image;
+		const QImage *m_image;
+
+		Upscaler m_upscaler;
+		Upscaler::Filter m_filter;
+		std::vector<u32> m_scaled_pixels;
+		QImage m_scaled_image;
+		u8 m_scale;
+
+		QElapsedTimer m_paint_timer;
+		double m_paint_time;
+
+		QRect GetScreenRect();
+		void Render();
+};
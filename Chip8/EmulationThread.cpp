@@ -0,0 +1,283 @@
+#include "EmulationThread.h"
+#include <cstring>
+
+namespace
+{
+		// How long the thread sleeps between checks while nothing is loaded.
+		const std::chrono::milliseconds idle_wait(10);
+}
+
+EmulationThread::EmulationThread()
+		: m_scheduler(m_cpu),
+		m_loaded(false),
+		m_running(false),
+		m_audio(nullptr),
+		m_profiler(nullptr),
+		m_input_time(0),
+		m_parked(false),
+		m_command_pending(false),
+		m_program_pending(false),
+		m_mode(Scheduler::Mode::real_time),
+		m_multiplier(1.0),
+		m_quirks(Cpu::cosmac_vip_quirks)
+{
+		memset(m_screen, NULL, sizeof m_screen);
+		m_scheduler.SetRunner([this](u32 cycles) { return RunFrame(cycles); });
+}
+
+EmulationThread::~EmulationThread()
+{
+		Stop();
+}
+
+bool EmulationThread::AcquireFrame()
+{
+		return m_frames.Acquire();
+}
+
+const TripleBuffer::Frame &EmulationThread::GetFrame()
+{
+		return m_frames.GetFront();
+}
+
+bool EmulationThread::IsParked()
+{
+		return m_parked.load(std::memory_order_relaxed);
+}
+
+bool EmulationThread::IsRunning()
+{
+		return m_running.load();
+}
+
+bool EmulationThread::LoadProgram(const u8 *program, u16 size)
+{
+		if (size > Cpu::program_size)
+				return false;
+
+		std::lock_guard<std::mutex> lock(m_command_mutex);
+
+		m_program.assign(program, program + size);
+		m_program_pending = true;
+		m_command_pending.store(true, std::memory_order_release);
+		Wake();
+
+		return true;
+}
+
+void EmulationThread::Park()
+{
+		std::unique_lock<std::mutex> lock(m_park_mutex);
+
+		m_parked.store(true, std::memory_order_relaxed);
+
+		// Pairs with the fence in Wake, so either Wake sees the thread parked
+		// or the thread sees whatever Wake was called for.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		m_park_condition.wait(lock, [this]()
+		{
+				return !m_input.IsEmpty() || m_command_pending.load(std::memory_order_acquire) || !m_running.load(std::memory_order_relaxed);
+		});
+		m_parked.store(false, std::memory_order_relaxed);
+
+		// Nothing happened while parked, so there is nothing to catch up on.
+		m_scheduler.Resume();
+}
+
+void EmulationThread::PublishFrame()
+{
+		if (!m_cpu.PublishFrame(m_screen))
+				return;
+
+		TripleBuffer::Frame &frame = m_frames.GetBack();
+
+		for (u8 row = 0; row < Cpu::screen_height; ++row)
+		{
+				for (u8 byte = 0; byte < sizeof frame.pixels[row]; ++byte)
+				{
+						frame.pixels[row][byte] = static_cast<u8>(m_screen[row] >> (56 - byte * 8));
+				}
+		}
+
+		frame.number = m_scheduler.GetFrames();
+		frame.input_time = m_input_time;
+		m_frames.Publish();
+		m_input_time = 0;
+}
+
+void EmulationThread::Run()
+{
+		while (m_running.load(std::memory_order_relaxed))
+		{
+				if (m_command_pending.load(std::memory_order_acquire))
+						TakeCommands();
+
+				if (!m_loaded)
+				{
+						std::this_thread::sleep_for(idle_wait);
+						continue;
+				}
+
+				if (m_cpu.IsWaitingForKey() && !m_cpu.GetDelayTimer() && !m_cpu.GetSoundTimer() && m_input.IsEmpty())
+				{
+						Park();
+						continue;
+				}
+
+				if (m_scheduler.Update())
+						PublishFrame();
+
+				std::this_thread::sleep_for(m_scheduler.GetTimeUntilNextFrame(Scheduler::Clock::now()));
+		}
+}
+
+u32 EmulationThread::RunCpu(u32 cycles)
+{
+		return m_profiler ? m_cpu.Run(cycles, *m_profiler) : m_cpu.Run(cycles);
+}
+
+u32 EmulationThread::RunFrame(u32 cycles)
+{
+		bool paced = m_scheduler.GetMode() != Scheduler::Mode::uncapped;
+		bool sounding = m_cpu.GetSoundTimer() != 0;
+		Scheduler::Clock::time_point frame_start = m_scheduler.GetFrameStart();
+		Scheduler::Clock::time_point frame_end = m_scheduler.GetFrameEnd();
+		InputQueue::Event event;
+		u32 executed = 0;
+
+		// Each event lands on the cycle as far into the frame as it happened
+		// into the host time the frame stands for. Uncapped frames don't stand
+		// for any, so they take everything pending at their start.
+		while (m_input.Peek(event))
+		{
+				u32 cycle = 0;
+
+				if (paced)
+				{
+						if (event.time >= frame_end)
+								break;
+
+						if (event.time > frame_start)
+								cycle = static_cast<u32>((event.time - frame_start) * cycles / (frame_end - frame_start));
+				}
+
+				if (cycle > executed)
+						executed += RunCpu(cycle - executed);
+
+				m_cpu.SetKey(event.key, event.pressed);
+				m_input.Pop();
+
+				if (!m_input_time)
+						m_input_time = static_cast<u64>(event.time.time_since_epoch().count());
+		}
+
+		executed += RunCpu(cycles - executed);
+
+		if (m_profiler)
+				m_profiler->CountFrame(executed);
+
+		// A timer set during the frame sounds in it even if it already ran out
+		// by the end, so a one tick beep is still heard.
+		if (m_audio && paced)
+				m_beeper.RunFrame(sounding || m_cpu.GetSoundTimer(), *m_audio);
+
+		return executed;
+}
+
+void EmulationThread::SetAudio(AudioBuffer *audio)
+{
+		if (!m_running.load())
+				m_audio = audio;
+}
+
+void EmulationThread::SetProfiler(Profiler *profiler)
+{
+		if (!m_running.load())
+				m_profiler = profiler;
+}
+
+bool EmulationThread::SetKey(u8 key, bool pressed, InputQueue::Clock::time_point time)
+{
+		InputQueue::Event event = { time, static_cast<u8>(key % Cpu::keys), pressed };
+
+		if (!m_input.Push(event))
+				return false;
+
+		Wake();
+
+		return true;
+}
+
+void EmulationThread::SetMode(Scheduler::Mode mode, double multiplier)
+{
+		std::lock_guard<std::mutex> lock(m_command_mutex);
+
+		m_mode = mode;
+		m_multiplier = multiplier;
+		m_command_pending.store(true, std::memory_order_release);
+		Wake();
+}
+
+void EmulationThread::SetQuirks(Cpu::Quirks quirks)
+{
+		std::lock_guard<std::mutex> lock(m_command_mutex);
+
+		m_quirks = quirks;
+		m_command_pending.store(true, std::memory_order_release);
+		Wake();
+}
+
+void EmulationThread::Start()
+{
+		if (m_running.exchange(true))
+				return;
+
+		m_thread = std::thread(&EmulationThread::Run, this);
+}
+
+void EmulationThread::Stop()
+{
+		if (!m_running.exchange(false))
+				return;
+
+		Wake();
+		m_thread.join();
+}
+
+void EmulationThread::TakeCommands()
+{
+		std::lock_guard<std::mutex> lock(m_command_mutex);
+
+		m_command_pending.store(false, std::memory_order_relaxed);
+
+		if (m_program_pending)
+		{
+				Cpu cpu;
+
+				cpu.SetCyclesPerTick(m_cpu.GetCyclesPerTick());
+				cpu.SetQuirks(m_quirks);
+				cpu.SetSeed(static_cast<u64>(Scheduler::Clock::now().time_since_epoch().count()));
+				m_cpu = cpu;
+				m_loaded = m_cpu.LoadProgram(m_program.data(), static_cast<u16>(m_program.size()));
+				m_program_pending = false;
+		}
+
+		m_cpu.SetQuirks(m_quirks);
+
+		// Setting the mode also restarts the pacing, which a new program wants
+		// as much as a new mode does.
+		m_scheduler.SetMode(m_mode, m_multiplier);
+		m_beeper.SetFrameRate(m_scheduler.GetFrameRate());
+}
+
+void EmulationThread::Wake()
+{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (!m_parked.load(std::memory_order_relaxed))
+				return;
+
+		std::lock_guard<std::mutex> lock(m_park_mutex);
+
+		m_park_condition.notify_one();
+}
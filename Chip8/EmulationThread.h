@@ -0,0 +1,86 @@
+#pragma once
+
+#include "AudioBuffer.h"
+#include "Beeper.h"
+#include "Cpu.h"
+#include "InputQueue.h"
+#include "Profiler.h"
+#include "Scheduler.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a Cpu paced by a Scheduler on a thread of its own. Finished frames are
+// published through a TripleBuffer, so the GUI thread picks up the newest one
+// whenever it repaints and the emulation never waits for painting. Key events
+// come in through an InputQueue and land on the cycle matching the host time
+// they happened at, and programs under a mutex the emulation thread only
+// touches when a new one is pending. While FX0A waits for a key with both
+// timers stopped, nothing can change until the host does something, so the
+// thread sleeps until it does. With an AudioBuffer set, every paced frame
+// adds its samples of the sound timer's beep to it, which never blocks.
+class EmulationThread
+{
+public:
+		EmulationThread();
+		~EmulationThread();
+
+		bool LoadProgram(const u8 *program, u16 size);
+
+		// Only take effect while the thread is stopped, and the profiler is
+		// only safe to read then as well.
+		void SetAudio(AudioBuffer *audio);
+		void SetProfiler(Profiler *profiler);
+
+		bool SetKey(u8 key, bool pressed, InputQueue::Clock::time_point time = InputQueue::Clock::now());
+		void SetMode(Scheduler::Mode mode, double multiplier = 1.0);
+		void SetQuirks(Cpu::Quirks quirks);
+
+		void Start();
+		void Stop();
+		bool IsRunning();
+		bool IsParked();
+
+		bool AcquireFrame();
+		const TripleBuffer::Frame &GetFrame();
+
+private:
+		Cpu m_cpu;
+		Scheduler m_scheduler;
+		TripleBuffer m_frames;
+		u64 m_screen[Cpu::screen_height];
+		bool m_loaded;
+
+		std::thread m_thread;
+		std::atomic<bool> m_running;
+
+		AudioBuffer *m_audio;
+		Beeper m_beeper;
+		Profiler *m_profiler;
+
+		InputQueue m_input;
+		u64 m_input_time;
+
+		std::mutex m_park_mutex;
+		std::condition_variable m_park_condition;
+		std::atomic<bool> m_parked;
+
+		std::mutex m_command_mutex;
+		std::atomic<bool> m_command_pending;
+		std::vector<u8> m_program;
+		bool m_program_pending;
+		Scheduler::Mode m_mode;
+		double m_multiplier;
+		Cpu::Quirks m_quirks;
+
+		void Park();
+		void PublishFrame();
+		void Run();
+		u32 RunCpu(u32 cycles);
+		u32 RunFrame(u32 cycles);
+		void TakeCommands();
+		void Wake();
+};
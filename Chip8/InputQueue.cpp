@@ -0,0 +1,46 @@
+#include "InputQueue.h"
+
+InputQueue::InputQueue()
+		: m_head(0),
+		m_tail(0)
+{
+}
+
+InputQueue::~InputQueue()
+{
+}
+
+bool InputQueue::IsEmpty()
+{
+		return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+}
+
+bool InputQueue::Peek(Event &event)
+{
+		u32 head = m_head.load(std::memory_order_relaxed);
+
+		if (head == m_tail.load(std::memory_order_acquire))
+				return false;
+
+		event = m_events[head % capacity];
+
+		return true;
+}
+
+void InputQueue::Pop()
+{
+		m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool InputQueue::Push(const Event &event)
+{
+		u32 tail = m_tail.load(std::memory_order_relaxed);
+
+		if (tail - m_head.load(std::memory_order_acquire) == capacity)
+				return false;
+
+		m_events[tail % capacity] = event;
+		m_tail.store(tail + 1, std::memory_order_release);
+
+		return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Cpu.h"
+#include <atomic>
+#include <chrono>
+
+// Hands key events from one producer thread to one consumer thread without
+// either of them ever waiting. Every event carries the host time it happened
+// at, so the consumer can apply it at the matching point of emulated time
+// however late it gets to it. Events pushed into a full queue are dropped.
+class InputQueue
+{
+public:
+		using Clock = std::chrono::steady_clock;
+
+		static const u32 capacity = 256;
+
+		struct Event
+		{
+				Clock::time_point time;
+				u8 key;
+				bool pressed;
+		};
+
+		InputQueue();
+		~InputQueue();
+
+		bool Push(const Event &event);
+
+		bool IsEmpty();
+		bool Peek(Event &event);
+		void Pop();
+
+private:
+		Event m_events[capacity];
+
+		// Both indices only ever grow and each is written by one side only, so
+		// a slot is reused only once the consumer has popped it.
+		alignas(64) std::atomic<u32> m_head;
+		alignas(64) std::atomic<u32> m_tail;
+};
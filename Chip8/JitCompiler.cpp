@@ -0,0 +1,575 @@
+#include "JitCompiler.h"
+#include <bitset>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define JIT_X64
+#endif
+
+namespace
+{
+		// Generated blocks keep the Cpu pointer in rbx and address guest state
+		// as [rbx + disp32], so every helper here encodes that addressing mode.
+		class Emitter
+		{
+		public:
+				Emitter(u8 *code)
+						: m_code(code),
+						m_size(0)
+				{
+				}
+
+				u32 GetSize()
+				{
+						return m_size;
+				}
+
+				void Byte(u8 byte)
+				{
+						m_code[m_size++] = byte;
+				}
+
+				void Word(u16 word)
+				{
+						Byte(word & 0xFF);
+						Byte(word >> 8);
+				}
+
+				void Dword(u32 dword)
+				{
+						Word(dword & 0xFFFF);
+						Word(dword >> 16);
+				}
+
+				void Qword(u64 qword)
+				{
+						Dword(qword & 0xFFFFFFFF);
+						Dword(qword >> 32);
+				}
+
+				void Patch(u32 position, u32 target)
+				{
+						u32 relative = target - (position + 4);
+
+						m_code[position] = relative & 0xFF;
+						m_code[position + 1] = (relative >> 8) & 0xFF;
+						m_code[position + 2] = (relative >> 16) & 0xFF;
+						m_code[position + 3] = relative >> 24;
+				}
+
+				// Blocks are called as u32 block(Cpu *cpu, u32 budget). rbx holds the
+				// Cpu, ebp the budget and r12d the instructions retired by completed
+				// loop iterations, all of which survive calls out to the handlers.
+				void Prologue()
+				{
+						Byte(0x53);																// push rbx
+						Byte(0x55);																// push rbp
+						Byte(0x41); Byte(0x54);										// push r12
+#if defined(_WIN32)
+						Byte(0x48); Byte(0x89); Byte(0xCB);				// mov rbx, rcx
+						Byte(0x89); Byte(0xD5);										// mov ebp, edx
+#else
+						Byte(0x48); Byte(0x89); Byte(0xFB);				// mov rbx, rdi
+						Byte(0x89); Byte(0xF5);										// mov ebp, esi
+#endif
+						Byte(0x45); Byte(0x31); Byte(0xE4);				// xor r12d, r12d
+						Byte(0x48); Byte(0x83); Byte(0xEC); Byte(0x20);		// sub rsp, 32
+				}
+
+				void Exit(u32 executed)
+				{
+						Byte(0x44); Byte(0x89); Byte(0xE0);				// mov eax, r12d
+						Byte(0x05); Dword(executed);							// add eax, executed
+						Byte(0x48); Byte(0x83); Byte(0xC4); Byte(0x20);		// add rsp, 32
+						Byte(0x41); Byte(0x5C);										// pop r12
+						Byte(0x5D);																// pop rbp
+						Byte(0x5B);																// pop rbx
+						Byte(0xC3);																// ret
+				}
+
+				// Runs the block again from loop_start while at least another
+				// iteration of executed instructions fits in the budget.
+				void Loop(u32 executed, u32 loop_start)
+				{
+						Byte(0x41); Byte(0x81); Byte(0xC4); Dword(executed);		// add r12d, executed
+						Byte(0x89); Byte(0xE8);										// mov eax, ebp
+						Byte(0x44); Byte(0x29); Byte(0xE0);				// sub eax, r12d
+						Byte(0x3D); Dword(executed);							// cmp eax, executed
+						Byte(0x0F); Byte(0x83);										// jae loop_start
+						Dword(0);
+						Patch(m_size - 4, loop_start);
+				}
+
+				// Emits a jcc with a placeholder target and returns where to patch it.
+				u32 JumpIf(bool equal)
+				{
+						Byte(0x0F); Byte(equal ? 0x84 : 0x85);		// je/jne rel32
+						Dword(0);
+
+						return m_size - 4;
+				}
+
+				void CallHandler(Cpu::Handler handler, const Cpu::Instruction *instruction)
+				{
+#if defined(_WIN32)
+						Byte(0x48); Byte(0x89); Byte(0xD9);				// mov rcx, rbx
+						Byte(0x48); Byte(0xBA);										// mov rdx, instruction
+#else
+						Byte(0x48); Byte(0x89); Byte(0xDF);				// mov rdi, rbx
+						Byte(0x48); Byte(0xBE);										// mov rsi, instruction
+#endif
+						Qword(reinterpret_cast<u64>(instruction));
+						Byte(0x48); Byte(0xB8);										// mov rax, handler
+						Qword(reinterpret_cast<u64>(handler));
+						Byte(0xFF); Byte(0xD0);										// call rax
+				}
+
+				// op al, byte [rbx + displacement] for the 8-bit r, r/m forms.
+				void AluAl(u8 opcode, u32 displacement)
+				{
+						Byte(opcode); Byte(0x83); Dword(displacement);
+				}
+
+				void LoadAl(u32 displacement)
+				{
+						AluAl(0x8A, displacement);								// mov al, [rbx + displacement]
+				}
+
+				void StoreAl(u32 displacement)
+				{
+						Byte(0x88); Byte(0x83); Dword(displacement);		// mov [rbx + displacement], al
+				}
+
+				void StoreCl(u32 displacement)
+				{
+						Byte(0x88); Byte(0x8B); Dword(displacement);		// mov [rbx + displacement], cl
+				}
+
+				void StoreByte(u32 displacement, u8 byte)
+				{
+						Byte(0xC6); Byte(0x83); Dword(displacement); Byte(byte);		// mov byte [rbx + displacement], byte
+				}
+
+				void AddByte(u32 displacement, u8 byte)
+				{
+						Byte(0x80); Byte(0x83); Dword(displacement); Byte(byte);		// add byte [rbx + displacement], byte
+				}
+
+				void CompareByte(u32 displacement, u8 byte)
+				{
+						Byte(0x80); Byte(0xBB); Dword(displacement); Byte(byte);		// cmp byte [rbx + displacement], byte
+				}
+
+				void StoreWord(u32 displacement, u16 word)
+				{
+						Byte(0x66); Byte(0xC7); Byte(0x83); Dword(displacement); Word(word);		// mov word [rbx + displacement], word
+				}
+
+				void SetCarry()
+				{
+						Byte(0x0F); Byte(0x92); Byte(0xC1);				// setc cl
+				}
+
+				void SetNoCarry()
+				{
+						Byte(0x0F); Byte(0x93); Byte(0xC1);				// setnc cl
+				}
+
+				void ShiftRight()
+				{
+						Byte(0x88); Byte(0xC1);										// mov cl, al
+						Byte(0x80); Byte(0xE1); Byte(0x01);				// and cl, 1
+						Byte(0xD0); Byte(0xE8);										// shr al, 1
+				}
+
+				void ShiftLeft()
+				{
+						Byte(0x88); Byte(0xC1);										// mov cl, al
+						Byte(0xC0); Byte(0xE9); Byte(0x07);				// shr cl, 7
+						Byte(0xD0); Byte(0xE0);										// shl al, 1
+				}
+
+		private:
+				u8 *m_code;
+				u32 m_size;
+		};
+
+		const u8 alu_or = 0x0A;
+		const u8 alu_and = 0x22;
+		const u8 alu_xor = 0x32;
+		const u8 alu_add = 0x02;
+		const u8 alu_subtract = 0x2A;
+		const u8 alu_compare = 0x3A;
+
+		// Upper bound on the native code for one block, checked before compiling.
+		const u32 max_block_size = 0x1000;
+}
+
+JitCompiler::JitCompiler(Cpu &cpu)
+		: m_cpu(cpu),
+		m_code(nullptr),
+		m_code_used(0),
+		m_compiled_pages(0),
+		m_quirks(cpu.m_quirks)
+{
+#if defined(JIT_X64)
+#if defined(_WIN32)
+		m_code = static_cast<u8 *>(VirtualAlloc(nullptr, code_size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE));
+#else
+		void *code = mmap(nullptr, code_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		m_code = code == MAP_FAILED ? nullptr : static_cast<u8 *>(code);
+#endif
+#endif
+}
+
+JitCompiler::~JitCompiler()
+{
+		if (!m_code)
+				return;
+
+#if defined(_WIN32)
+		VirtualFree(m_code, 0, MEM_RELEASE);
+#else
+		munmap(m_code, code_size);
+#endif
+}
+
+JitCompiler::Block *JitCompiler::Compile(u16 address)
+{
+		if (code_size - m_code_used < max_block_size)
+		{
+				for (std::unique_ptr<Block> &block : m_blocks)
+				{
+						block.reset();
+				}
+
+				m_code_used = 0;
+				m_compiled_pages = 0;
+		}
+
+		const u8 *base = reinterpret_cast<const u8 *>(&m_cpu);
+		u32 registers_displacement = static_cast<u32>(m_cpu.m_data_registers - base);
+		u32 pc_displacement = static_cast<u32>(reinterpret_cast<const u8 *>(&m_cpu.m_pc) - base);
+		u32 index_displacement = static_cast<u32>(reinterpret_cast<const u8 *>(&m_cpu.m_i) - base);
+		u32 flag_displacement = registers_displacement + static_cast<u8>(Cpu::DataRegisters::vF);
+
+		std::unique_ptr<Block> block(new Block);
+		Emitter emitter(m_code + m_code_used);
+		std::bitset<Cpu::ram_size> traced;
+		u16 pc = address;
+		bool terminated = false;
+
+		block->function = reinterpret_cast<BlockFunction>(m_code + m_code_used);
+		block->pages = 0;
+		block->length = 0;
+		block->instructions.reserve(max_block_length);
+
+		emitter.Prologue();
+
+		u32 loop_start = emitter.GetSize();
+
+		while (!terminated)
+		{
+				if (block->length == max_block_length)
+				{
+						emitter.StoreWord(pc_displacement, pc);
+						emitter.Exit(block->length);
+						break;
+				}
+
+				u16 opcode = m_cpu.m_ram[pc] << 8 | m_cpu.m_ram[(pc + 1) % Cpu::ram_size];
+				Cpu::Instruction instruction = Cpu::Decode(opcode, m_quirks);
+				u16 next = (pc + 2) % Cpu::ram_size;
+				u16 skip = (pc + 4) % Cpu::ram_size;
+				u32 x = registers_displacement + static_cast<u8>(instruction.data_register_x);
+				u32 y = registers_displacement + static_cast<u8>(instruction.data_register_y);
+				bool compiled = true;
+				u32 continue_position;
+
+				// Timers count down from the cycle counter, which only catches up
+				// when a block exits, so timer instructions get a block to themselves.
+				if (block->length && UsesTimers(instruction.handler))
+				{
+						emitter.StoreWord(pc_displacement, pc);
+						emitter.Exit(block->length);
+						break;
+				}
+
+				traced.set(pc);
+				block->pages |= 1ULL << (pc / Cpu::page_size);
+				block->pages |= 1ULL << (((pc + 1) % Cpu::ram_size) / Cpu::page_size);
+				++block->length;
+
+				switch (opcode >> 12)
+				{
+				case 0x1:
+						// Jumps are followed at compile time, so a block is a trace through
+						// the guest code, and a jump back to its start becomes a native loop.
+						if (instruction.address == address)
+						{
+								emitter.Loop(block->length, loop_start);
+								emitter.StoreWord(pc_displacement, address);
+								emitter.Exit(0);
+								terminated = true;
+						}
+						else if (traced.test(instruction.address))
+						{
+								emitter.StoreWord(pc_displacement, instruction.address);
+								emitter.Exit(block->length);
+								terminated = true;
+						}
+						else
+						{
+								next = instruction.address;
+						}
+						break;
+				case 0x3:
+				case 0x4:
+						emitter.CompareByte(x, instruction.byte);
+						continue_position = emitter.JumpIf(opcode >> 12 == 0x4);
+						emitter.StoreWord(pc_displacement, skip);
+						emitter.Exit(block->length);
+						emitter.Patch(continue_position, emitter.GetSize());
+						break;
+				case 0x5:
+				case 0x9:
+						compiled = instruction.nibble == 0x0;
+
+						if (compiled)
+						{
+								emitter.LoadAl(x);
+								emitter.AluAl(alu_compare, y);
+								continue_position = emitter.JumpIf(opcode >> 12 == 0x9);
+								emitter.StoreWord(pc_displacement, skip);
+								emitter.Exit(block->length);
+								emitter.Patch(continue_position, emitter.GetSize());
+						}
+						break;
+				case 0x6:
+						emitter.StoreByte(x, instruction.byte);
+						break;
+				case 0x7:
+						emitter.AddByte(x, instruction.byte);
+						break;
+				case 0x8:
+						switch (instruction.nibble)
+						{
+						case 0x0:
+								emitter.LoadAl(y);
+								emitter.StoreAl(x);
+								break;
+						case 0x1:
+						case 0x2:
+						case 0x3:
+								emitter.LoadAl(x);
+								emitter.AluAl(instruction.nibble == 0x1 ? alu_or : instruction.nibble == 0x2 ? alu_and : alu_xor, y);
+								emitter.StoreAl(x);
+								break;
+						case 0x4:
+								emitter.LoadAl(x);
+								emitter.AluAl(alu_add, y);
+								emitter.SetCarry();
+								emitter.StoreAl(x);
+								emitter.StoreCl(flag_displacement);
+								break;
+						case 0x5:
+								emitter.LoadAl(x);
+								emitter.AluAl(alu_subtract, y);
+								emitter.SetNoCarry();
+								emitter.StoreAl(x);
+								emitter.StoreCl(flag_displacement);
+								break;
+						case 0x6:
+								emitter.LoadAl(m_quirks & Cpu::shift_uses_vy ? y : x);
+								emitter.ShiftRight();
+								emitter.StoreAl(x);
+								emitter.StoreCl(flag_displacement);
+								break;
+						case 0x7:
+								emitter.LoadAl(y);
+								emitter.AluAl(alu_subtract, x);
+								emitter.SetNoCarry();
+								emitter.StoreAl(x);
+								emitter.StoreCl(flag_displacement);
+								break;
+						case 0xE:
+								emitter.LoadAl(m_quirks & Cpu::shift_uses_vy ? y : x);
+								emitter.ShiftLeft();
+								emitter.StoreAl(x);
+								emitter.StoreCl(flag_displacement);
+								break;
+						default:
+								compiled = false;
+								break;
+						}
+						break;
+				case 0xA:
+						emitter.StoreWord(index_displacement, instruction.address);
+						break;
+				default:
+						compiled = false;
+						break;
+				}
+
+				if (!compiled)
+				{
+						block->instructions.push_back(instruction);
+						emitter.StoreWord(pc_displacement, next);
+						emitter.CallHandler(instruction.handler, &block->instructions.back());
+
+						if (EndsBlock(opcode, instruction.handler) || UsesTimers(instruction.handler))
+						{
+								emitter.Exit(block->length);
+								terminated = true;
+						}
+				}
+
+				pc = next;
+		}
+
+#if defined(_WIN32)
+		FlushInstructionCache(GetCurrentProcess(), m_code + m_code_used, emitter.GetSize());
+#endif
+
+		m_code_used += emitter.GetSize();
+		m_compiled_pages |= block->pages;
+		m_blocks[address] = std::move(block);
+
+		return m_blocks[address].get();
+}
+
+bool JitCompiler::EndsBlock(u16 opcode, Cpu::Handler handler)
+{
+		// BNNN and FX55 have a handler per quirks, so they go by opcode.
+		return opcode >> 12 == 0xB
+				|| (opcode & 0xF0FF) == 0xF055
+				|| handler == &Cpu::ExecuteCall
+				|| handler == &Cpu::ExecuteInvalid
+				|| handler == &Cpu::ExecuteReturn
+				|| handler == &Cpu::ExecuteSkipKeyNotPressed
+				|| handler == &Cpu::ExecuteSkipKeyPressed
+				|| handler == &Cpu::ExecuteStoreBinaryCodedDecimal
+				|| handler == &Cpu::ExecuteWaitKey;
+}
+
+void JitCompiler::Invalidate()
+{
+		m_quirks = m_cpu.m_quirks;
+		m_cpu.TakeWrittenPages();
+		InvalidatePages(~0ULL);
+}
+
+void JitCompiler::InvalidatePages(u64 pages)
+{
+		// Most guest writes land in data, so only walk the blocks when a write
+		// touched a page that some block was built from.
+		if (!(pages & m_compiled_pages))
+				return;
+
+		m_compiled_pages = 0;
+
+		for (std::unique_ptr<Block> &block : m_blocks)
+		{
+				if (!block)
+						continue;
+
+				if (block->pages & pages)
+						block.reset();
+				else
+						m_compiled_pages |= block->pages;
+		}
+}
+
+bool JitCompiler::IsSupported()
+{
+#if defined(JIT_X64)
+		return true;
+#else
+		return false;
+#endif
+}
+
+void JitCompiler::Prewarm(const std::vector<u16> &addresses)
+{
+		if (!m_code)
+				return;
+
+		if (m_cpu.m_quirks != m_quirks)
+				Invalidate();
+
+		InvalidatePages(m_cpu.TakeWrittenPages());
+
+		for (u16 address : addresses)
+		{
+				address = m_cpu.ConvertAddress(address);
+
+				if (!m_blocks[address])
+						Compile(address);
+		}
+}
+
+u32 JitCompiler::Run(u32 cycles)
+{
+		if (!m_code)
+				return m_cpu.Run(cycles);
+
+		u32 executed = 0;
+
+		if (m_cpu.m_quirks != m_quirks)
+				Invalidate();
+
+		InvalidatePages(m_cpu.TakeWrittenPages());
+
+		while (executed < cycles && m_cpu.m_fault == Cpu::Fault::none)
+		{
+				u16 pc = m_cpu.ConvertAddress(m_cpu.m_pc);
+				u32 skipped = m_cpu.SkipIdleLoop(cycles - executed);
+
+				if (skipped)
+				{
+						executed += skipped;
+						continue;
+				}
+
+				Block *block = m_blocks[pc].get();
+
+				if (!block)
+						block = Compile(pc);
+
+				// A pass through a block may retire up to its length, so finish the
+				// budget one instruction at a time rather than overshooting it.
+				if (block->length > cycles - executed)
+				{
+						m_cpu.Step();
+						++executed;
+				}
+				else
+				{
+						m_cpu.m_pc = pc;
+
+						u32 block_executed = block->function(&m_cpu, cycles - executed);
+
+						m_cpu.m_cycles += block_executed;
+						executed += block_executed;
+				}
+
+				InvalidatePages(m_cpu.TakeWrittenPages());
+		}
+
+		return executed;
+}
+
+bool JitCompiler::UsesTimers(Cpu::Handler handler)
+{
+		return handler == &Cpu::ExecuteSetDelayTimer
+				|| handler == &Cpu::ExecuteSetSoundTimer
+				|| handler == &Cpu::ExecuteStoreDelayTimer;
+}
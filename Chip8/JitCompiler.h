@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Cpu.h"
+#include <memory>
+#include <vector>
+
+// Translates guest code into native x86-64 code. A block follows jumps and
+// leaves through side exits at skips. It ends at calls, returns, computed
+// jumps and the instructions that write ram, and is thrown away when the
+// guest writes to a page it was built from, or when the Cpu's quirks change.
+// On other hosts Run falls back to the Cpu interpreter.
+class JitCompiler
+{
+public:
+		static const u8 max_block_length = 0x40;
+		static const u32 code_size = 0x100000;
+
+		JitCompiler(Cpu &cpu);
+		~JitCompiler();
+
+		static bool IsSupported();
+
+		void Invalidate();
+
+		// Compiles the blocks starting at addresses ahead of time, such as the
+		// ones a Disassembler found, so they don't stall the first frames.
+		void Prewarm(const std::vector<u16> &addresses);
+		u32 Run(u32 cycles);
+
+private:
+		using BlockFunction = u32 (*)(Cpu *cpu, u32 budget);
+
+		struct Block
+		{
+				BlockFunction function;
+				u64 pages;
+				u8 length;
+				std::vector<Cpu::Instruction> instructions;
+		};
+
+		Cpu &m_cpu;
+		u8 *m_code;
+		u32 m_code_used;
+		u64 m_compiled_pages;
+		Cpu::Quirks m_quirks;
+		std::unique_ptr<Block> m_blocks[Cpu::ram_size];
+
+		Block *Compile(u16 address);
+		void InvalidatePages(u64 pages);
+
+		static bool EndsBlock(u16 opcode, Cpu::Handler handler);
+		static bool UsesTimers(Cpu::Handler handler);
+};
@@ -0,0 +1,549 @@
+#include "LockstepCpu.h"
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+		const u16 max_chunk = 0x7FFF;
+
+		u16 ConvertAddress(u16 address)
+		{
+				return address & 0xFFF;
+		}
+
+		u8 LowestLane(u32 lanes)
+		{
+				u8 lane = 0;
+
+				while (!((lanes >> lane) & 1))
+						++lane;
+
+				return lane;
+		}
+
+		__m128i Select(__m128i mask, __m128i a, __m128i b)
+		{
+				return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+		}
+
+		__m128i Load(const void *lanes)
+		{
+				return _mm_load_si128(static_cast<const __m128i *>(lanes));
+		}
+
+		void Store(void *lanes, __m128i value)
+		{
+				_mm_store_si128(static_cast<__m128i *>(lanes), value);
+		}
+
+		// Turns a byte per lane condition into a 2 per lane program counter step
+		// and adds it to both halves of the program counters.
+		void Skip(u16 *pc, __m128i condition)
+		{
+				__m128i skip = _mm_set1_epi16(2);
+
+				Store(pc, _mm_add_epi16(Load(pc), _mm_and_si128(_mm_unpacklo_epi8(condition, condition), skip)));
+				Store(pc + 8, _mm_add_epi16(Load(pc + 8), _mm_and_si128(_mm_unpackhi_epi8(condition, condition), skip)));
+		}
+}
+
+LockstepCpu::LockstepCpu()
+		: m_written_pages(0)
+{
+		static_assert(lanes == 0x10, "LockstepCpu kernels assume one byte per lane in a 128 bit vector");
+
+		Cpu cpu;
+
+		memset(m_data_registers, NULL, sizeof m_data_registers);
+		memset(m_delay_timer, NULL, sizeof m_delay_timer);
+		memset(m_sound_timer, NULL, sizeof m_sound_timer);
+		memset(m_i, NULL, sizeof m_i);
+		memset(m_keys, NULL, sizeof m_keys);
+		memset(m_stack, NULL, sizeof m_stack);
+		memset(m_stack_pointer, NULL, sizeof m_stack_pointer);
+		memset(m_random, NULL, sizeof m_random);
+		memset(m_cycles, NULL, sizeof m_cycles);
+		memset(m_screen, NULL, sizeof m_screen);
+
+		for (u8 lane = 0; lane < lanes; ++lane)
+		{
+				memcpy(m_ram[lane], cpu.GetRam(), Cpu::ram_size);
+				m_pc[lane] = Cpu::program_start;
+				m_fault[lane] = Fault::none;
+		}
+}
+
+LockstepCpu::~LockstepCpu()
+{
+}
+
+void LockstepCpu::ExecuteLane(u8 lane, u16 opcode)
+{
+		u8 x = (opcode & 0x0F00) >> 8;
+		u8 y = (opcode & 0x00F0) >> 4;
+		u8 byte = opcode & 0x00FF;
+		u8 &vx = m_data_registers[x][lane];
+		u8 *ram = m_ram[lane];
+		u16 &i = m_i[lane];
+
+		switch (opcode >> 12)
+		{
+		case 0x0:
+				if (opcode == 0x00E0)
+				{
+						memset(m_screen[lane], NULL, sizeof m_screen[lane]);
+				}
+				else if (opcode == 0x00EE)
+				{
+						if (!m_stack_pointer[lane])
+						{
+								m_pc[lane] = ConvertAddress(m_pc[lane] - 2);
+								m_fault[lane] = Fault::stack_underflow;
+								break;
+						}
+
+						m_pc[lane] = m_stack[--m_stack_pointer[lane]][lane];
+				}
+				break;
+		case 0x2:
+				if (m_stack_pointer[lane] == Cpu::stack_entries)
+				{
+						m_pc[lane] = ConvertAddress(m_pc[lane] - 2);
+						m_fault[lane] = Fault::stack_overflow;
+						break;
+				}
+
+				m_stack[m_stack_pointer[lane]++][lane] = m_pc[lane];
+				m_pc[lane] = opcode & 0x0FFF;
+				break;
+		case 0xC:
+				vx = Cpu::Pcg(m_random[lane]) & byte;
+				break;
+		case 0xD:
+		{
+				u8 column = vx % Cpu::screen_width;
+				u8 row = m_data_registers[y][lane] % Cpu::screen_height;
+				u64 collisions = 0;
+
+				for (u8 sprite_row_index = 0; sprite_row_index < (opcode & 0x000F); ++sprite_row_index)
+				{
+						u64 sprite = static_cast<u64>(ram[ConvertAddress(i + sprite_row_index)]) << (Cpu::screen_width - 8);
+						u64 sprite_row = (sprite >> column) | (sprite << ((Cpu::screen_width - column) % Cpu::screen_width));
+						u64 &screen_row = m_screen[lane][(row + sprite_row_index) % Cpu::screen_height];
+
+						collisions |= screen_row & sprite_row;
+						screen_row ^= sprite_row;
+				}
+
+				m_data_registers[0xF][lane] = collisions != 0;
+				break;
+		}
+		case 0xE:
+				if (((m_keys[lane] >> (vx % Cpu::keys)) & 1) == (byte == 0x9E))
+						m_pc[lane] += 2;
+				break;
+		case 0xF:
+				switch (byte)
+				{
+				case 0x0A:
+				{
+						u16 keys = m_keys[lane];
+						u8 key = 0;
+
+						if (!keys)
+						{
+								m_pc[lane] = ConvertAddress(m_pc[lane] - 2);
+								break;
+						}
+
+						while (!((keys >> key) & 1))
+						{
+								++key;
+						}
+
+						vx = key;
+						break;
+				}
+				case 0x33:
+						ram[ConvertAddress(i)] = vx / 100;
+						ram[ConvertAddress(i + 1)] = vx / 10 % 10;
+						ram[ConvertAddress(i + 2)] = vx % 10;
+
+						for (u8 offset = 0; offset < 3; ++offset)
+						{
+								m_written_pages |= 1ULL << (ConvertAddress(i + offset) / Cpu::page_size);
+						}
+						break;
+				case 0x55:
+						for (u8 data_register = 0; data_register <= x; ++data_register)
+						{
+								m_written_pages |= 1ULL << (ConvertAddress(i) / Cpu::page_size);
+								ram[ConvertAddress(i++)] = m_data_registers[data_register][lane];
+						}
+						break;
+				case 0x65:
+						for (u8 data_register = 0; data_register <= x; ++data_register)
+						{
+								m_data_registers[data_register][lane] = ram[ConvertAddress(i++)];
+						}
+						break;
+				}
+				break;
+		}
+}
+
+u16 LockstepCpu::Fetch(u8 lane, u16 address)
+{
+		return m_ram[lane][ConvertAddress(address)] << 8 | m_ram[lane][ConvertAddress(address + 1)];
+}
+
+u64 LockstepCpu::GetCycles(u8 lane)
+{
+		return m_cycles[lane];
+}
+
+u8 LockstepCpu::GetDataRegister(u8 lane, DataRegisters data_register)
+{
+		return m_data_registers[static_cast<u8>(data_register)][lane];
+}
+
+u8 LockstepCpu::GetDelayTimer(u8 lane)
+{
+		return m_delay_timer[lane];
+}
+
+LockstepCpu::Fault LockstepCpu::GetFault(u8 lane)
+{
+		return m_fault[lane];
+}
+
+u16 LockstepCpu::GetIndex(u8 lane)
+{
+		return m_i[lane];
+}
+
+u16 LockstepCpu::GetProgramCounter(u8 lane)
+{
+		return m_pc[lane];
+}
+
+const u8 *LockstepCpu::GetRam(u8 lane)
+{
+		return m_ram[lane];
+}
+
+const u64 *LockstepCpu::GetScreen(u8 lane)
+{
+		return m_screen[lane];
+}
+
+u8 LockstepCpu::GetSoundTimer(u8 lane)
+{
+		return m_sound_timer[lane];
+}
+
+bool LockstepCpu::LoadProgram(const u8 *program, u16 size)
+{
+		if (size > Cpu::program_size)
+				return false;
+
+		for (u8 lane = 0; lane < lanes; ++lane)
+		{
+				memcpy(m_ram[lane] + Cpu::program_start, program, size);
+				m_pc[lane] = Cpu::program_start;
+		}
+
+		return true;
+}
+
+u32 LockstepCpu::Run(u32 cycles)
+{
+		u32 executed = 0;
+
+		while (cycles)
+		{
+				u16 chunk = cycles < max_chunk ? static_cast<u16>(cycles) : max_chunk;
+				u32 chunk_executed = RunChunk(chunk);
+
+				if (!chunk_executed)
+						break;
+
+				executed += chunk_executed;
+				cycles -= chunk;
+		}
+
+		return executed;
+}
+
+u32 LockstepCpu::RunChunk(u16 cycles)
+{
+		alignas(16) u16 remaining[lanes];
+		alignas(16) u16 live[lanes];
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi8(1);
+		const __m128i idle = _mm_set1_epi16(0x7FFF);
+
+		for (u8 lane = 0; lane < lanes; ++lane)
+		{
+				remaining[lane] = cycles;
+				live[lane] = m_fault[lane] == Fault::none ? 0xFFFF : 0;
+		}
+
+		for (;;)
+		{
+				__m128i remaining_low = Load(remaining);
+				__m128i remaining_high = Load(remaining + 8);
+				__m128i active_low = _mm_and_si128(_mm_cmpgt_epi16(remaining_low, zero), Load(live));
+				__m128i active_high = _mm_and_si128(_mm_cmpgt_epi16(remaining_high, zero), Load(live + 8));
+
+				if (!_mm_movemask_epi8(_mm_packs_epi16(active_low, active_high)))
+						break;
+
+				__m128i pc_low = Load(m_pc);
+				__m128i pc_high = Load(m_pc + 8);
+				__m128i lowest = _mm_min_epi16(Select(active_low, pc_low, idle), Select(active_high, pc_high, idle));
+
+				lowest = _mm_min_epi16(lowest, _mm_srli_si128(lowest, 8));
+				lowest = _mm_min_epi16(lowest, _mm_srli_si128(lowest, 4));
+				lowest = _mm_min_epi16(lowest, _mm_srli_si128(lowest, 2));
+
+				u16 pc = _mm_cvtsi128_si32(lowest) & 0xFFFF;
+				__m128i leader = _mm_set1_epi16(pc);
+				__m128i group_low = _mm_and_si128(active_low, _mm_cmpeq_epi16(pc_low, leader));
+				__m128i group_high = _mm_and_si128(active_high, _mm_cmpeq_epi16(pc_high, leader));
+				u32 group = _mm_movemask_epi8(_mm_packs_epi16(group_low, group_high));
+				u16 opcode = Fetch(LowestLane(group), pc);
+
+				if ((m_written_pages >> (ConvertAddress(pc) / Cpu::page_size)) & 1 || (m_written_pages >> (ConvertAddress(pc + 1) / Cpu::page_size)) & 1)
+				{
+						alignas(16) u16 group_lanes[lanes];
+
+						for (u8 lane = 0; lane < lanes; ++lane)
+						{
+								if ((group >> lane) & 1 && Fetch(lane, pc) != opcode)
+										group &= ~(1U << lane);
+
+								group_lanes[lane] = (group >> lane) & 1 ? 0xFFFF : 0;
+						}
+
+						group_low = Load(group_lanes);
+						group_high = Load(group_lanes + 8);
+				}
+
+				__m128i group_bytes = _mm_packs_epi16(group_low, group_high);
+				__m128i next = _mm_set1_epi16(ConvertAddress(pc + 2));
+				u8 x = (opcode & 0x0F00) >> 8;
+				u8 y = (opcode & 0x00F0) >> 4;
+				u8 byte = opcode & 0x00FF;
+				u16 address = opcode & 0x0FFF;
+				bool invalid = false;
+
+				Store(remaining, _mm_add_epi16(remaining_low, group_low));
+				Store(remaining + 8, _mm_add_epi16(remaining_high, group_high));
+				Store(m_pc, Select(group_low, next, pc_low));
+				Store(m_pc + 8, Select(group_high, next, pc_high));
+
+				__m128i vx = Load(m_data_registers[x]);
+				__m128i vy = Load(m_data_registers[y]);
+
+				switch (opcode >> 12)
+				{
+				case 0x1:
+						Store(m_pc, Select(group_low, _mm_set1_epi16(address), Load(m_pc)));
+						Store(m_pc + 8, Select(group_high, _mm_set1_epi16(address), Load(m_pc + 8)));
+						break;
+				case 0x3:
+						Skip(m_pc, _mm_and_si128(group_bytes, _mm_cmpeq_epi8(vx, _mm_set1_epi8(byte))));
+						break;
+				case 0x4:
+						Skip(m_pc, _mm_andnot_si128(_mm_cmpeq_epi8(vx, _mm_set1_epi8(byte)), group_bytes));
+						break;
+				case 0x5:
+				case 0x9:
+						if (opcode & 0x000F)
+						{
+								invalid = true;
+								break;
+						}
+
+						if (opcode >> 12 == 0x5)
+								Skip(m_pc, _mm_and_si128(group_bytes, _mm_cmpeq_epi8(vx, vy)));
+						else
+								Skip(m_pc, _mm_andnot_si128(_mm_cmpeq_epi8(vx, vy), group_bytes));
+						break;
+				case 0x6:
+						Store(m_data_registers[x], Select(group_bytes, _mm_set1_epi8(byte), vx));
+						break;
+				case 0x7:
+						Store(m_data_registers[x], Select(group_bytes, _mm_add_epi8(vx, _mm_set1_epi8(byte)), vx));
+						break;
+				case 0x8:
+				{
+						__m128i result;
+						__m128i flag = zero;
+						bool sets_flag = true;
+
+						switch (opcode & 0x000F)
+						{
+						case 0x0: result = vy; sets_flag = false; break;
+						case 0x1: result = _mm_or_si128(vx, vy); sets_flag = false; break;
+						case 0x2: result = _mm_and_si128(vx, vy); sets_flag = false; break;
+						case 0x3: result = _mm_xor_si128(vx, vy); sets_flag = false; break;
+						case 0x4:
+								result = _mm_add_epi8(vx, vy);
+								flag = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_max_epu8(result, vx), result), one);
+								break;
+						case 0x5:
+								result = _mm_sub_epi8(vx, vy);
+								flag = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(vx, vy), vx), one);
+								break;
+						case 0x6:
+								result = _mm_and_si128(_mm_srli_epi16(vy, 1), _mm_set1_epi8(0x7F));
+								flag = _mm_and_si128(vy, one);
+								break;
+						case 0x7:
+								result = _mm_sub_epi8(vy, vx);
+								flag = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(vx, vy), vy), one);
+								break;
+						case 0xE:
+								result = _mm_add_epi8(vy, vy);
+								flag = _mm_and_si128(_mm_srli_epi16(vy, 7), one);
+								break;
+						default:
+								invalid = true;
+								break;
+						}
+
+						if (invalid)
+								break;
+
+						Store(m_data_registers[x], Select(group_bytes, result, vx));
+
+						if (sets_flag)
+								Store(m_data_registers[0xF], Select(group_bytes, flag, Load(m_data_registers[0xF])));
+						break;
+				}
+				case 0xA:
+						Store(m_i, Select(group_low, _mm_set1_epi16(address), Load(m_i)));
+						Store(m_i + 8, Select(group_high, _mm_set1_epi16(address), Load(m_i + 8)));
+						break;
+				case 0xB:
+				{
+						// The VIP quirks wrap the target around the end of ram.
+						__m128i v0 = Load(m_data_registers[0x0]);
+						__m128i address_mask = _mm_set1_epi16(0x0FFF);
+
+						Store(m_pc, Select(group_low, _mm_and_si128(_mm_add_epi16(_mm_unpacklo_epi8(v0, zero), _mm_set1_epi16(address)), address_mask), Load(m_pc)));
+						Store(m_pc + 8, Select(group_high, _mm_and_si128(_mm_add_epi16(_mm_unpackhi_epi8(v0, zero), _mm_set1_epi16(address)), address_mask), Load(m_pc + 8)));
+						break;
+				}
+				case 0xE:
+						if (byte != 0x9E && byte != 0xA1)
+						{
+								invalid = true;
+								break;
+						}
+
+						for (u32 lanes_left = group; lanes_left; lanes_left &= lanes_left - 1)
+						{
+								ExecuteLane(LowestLane(lanes_left), opcode);
+						}
+						break;
+				case 0xF:
+						switch (byte)
+						{
+						case 0x07:
+								Store(m_data_registers[x], Select(group_bytes, Load(m_delay_timer), vx));
+								break;
+						case 0x15:
+								Store(m_delay_timer, Select(group_bytes, vx, Load(m_delay_timer)));
+								break;
+						case 0x18:
+								Store(m_sound_timer, Select(group_bytes, vx, Load(m_sound_timer)));
+								break;
+						case 0x1E:
+								Store(m_i, Select(group_low, _mm_add_epi16(Load(m_i), _mm_unpacklo_epi8(vx, zero)), Load(m_i)));
+								Store(m_i + 8, Select(group_high, _mm_add_epi16(Load(m_i + 8), _mm_unpackhi_epi8(vx, zero)), Load(m_i + 8)));
+								break;
+						case 0x29:
+						{
+								__m128i font_length = _mm_set1_epi16(Cpu::font_length);
+								__m128i mask = _mm_set1_epi16(0x0FFF);
+
+								Store(m_i, Select(group_low, _mm_and_si128(_mm_mullo_epi16(_mm_unpacklo_epi8(vx, zero), font_length), mask), Load(m_i)));
+								Store(m_i + 8, Select(group_high, _mm_and_si128(_mm_mullo_epi16(_mm_unpackhi_epi8(vx, zero), font_length), mask), Load(m_i + 8)));
+								break;
+						}
+						case 0x0A:
+						case 0x33:
+						case 0x55:
+						case 0x65:
+								for (u32 lanes_left = group; lanes_left; lanes_left &= lanes_left - 1)
+								{
+										ExecuteLane(LowestLane(lanes_left), opcode);
+								}
+								break;
+						default:
+								invalid = true;
+								break;
+						}
+						break;
+				default:
+						for (u32 lanes_left = group; lanes_left; lanes_left &= lanes_left - 1)
+						{
+								u8 lane = LowestLane(lanes_left);
+
+								ExecuteLane(lane, opcode);
+
+								if (m_fault[lane] != Fault::none)
+										live[lane] = 0;
+						}
+						break;
+				}
+
+				if (invalid)
+				{
+						// Leave the program counter on the offending opcode like Cpu does.
+						for (u32 lanes_left = group; lanes_left; lanes_left &= lanes_left - 1)
+						{
+								u8 lane = LowestLane(lanes_left);
+
+								m_pc[lane] = ConvertAddress(pc);
+								m_fault[lane] = Fault::invalid_opcode;
+								live[lane] = 0;
+						}
+				}
+		}
+
+		u32 executed = 0;
+
+		for (u8 lane = 0; lane < lanes; ++lane)
+		{
+				u16 lane_executed = cycles - remaining[lane];
+
+				m_cycles[lane] += lane_executed;
+				executed += lane_executed;
+		}
+
+		return executed;
+}
+
+void LockstepCpu::SetDataRegister(u8 lane, DataRegisters data_register, u8 byte)
+{
+		m_data_registers[static_cast<u8>(data_register)][lane] = byte;
+}
+
+void LockstepCpu::SetKey(u8 lane, u8 key, bool pressed)
+{
+		u16 mask = 1 << (key % Cpu::keys);
+
+		if (pressed)
+				m_keys[lane] |= mask;
+		else
+				m_keys[lane] &= ~mask;
+}
+
+void LockstepCpu::SetSeed(u8 lane, u64 seed)
+{
+		m_random[lane] = seed;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Cpu.h"
+
+// Runs lanes Cpu instances of the same program side by side with their state
+// laid out as lane arrays, so one SSE2 instruction updates a register in
+// every lane. Each step executes the live lanes at the lowest program counter
+// together: register, skip and jump opcodes use vector kernels, the rest run
+// lane by lane. Lanes that diverge simply wait until their address is the
+// lowest again. Random numbers come from a per lane Cpu::Pcg generator, so a
+// lane reproduces a Cpu given the same seed.
+class LockstepCpu
+{
+public:
+		static const u8 lanes = 0x10;
+
+		using DataRegisters = Cpu::DataRegisters;
+		using Fault = Cpu::Fault;
+
+		LockstepCpu();
+		~LockstepCpu();
+
+		bool LoadProgram(const u8 *program, u16 size);
+		u32 Run(u32 cycles);
+
+		u8 GetDataRegister(u8 lane, DataRegisters data_register);
+		void SetDataRegister(u8 lane, DataRegisters data_register, u8 byte);
+		const u8 *GetRam(u8 lane);
+		const u64 *GetScreen(u8 lane);
+
+		u8 GetDelayTimer(u8 lane);
+		u8 GetSoundTimer(u8 lane);
+
+		u16 GetProgramCounter(u8 lane);
+		u16 GetIndex(u8 lane);
+
+		void SetKey(u8 lane, u8 key, bool pressed);
+		void SetSeed(u8 lane, u64 seed);
+
+		u64 GetCycles(u8 lane);
+		Fault GetFault(u8 lane);
+
+private:
+		alignas(16) u8 m_data_registers[Cpu::data_registers][lanes];
+		alignas(16) u8 m_delay_timer[lanes];
+		alignas(16) u8 m_sound_timer[lanes];
+		alignas(16) u16 m_pc[lanes];
+		alignas(16) u16 m_i[lanes];
+		u16 m_keys[lanes];
+		u16 m_stack[Cpu::stack_entries][lanes];
+		u8 m_stack_pointer[lanes];
+		u64 m_random[lanes];
+		u64 m_cycles[lanes];
+		Fault m_fault[lanes];
+
+		// Pages any lane has written, so a fetch from them checks that every
+		// lane in the group still holds the same opcode.
+		u64 m_written_pages;
+
+		u64 m_screen[lanes][Cpu::screen_height];
+		u8 m_ram[lanes][Cpu::ram_size];
+
+		void ExecuteLane(u8 lane, u16 opcode);
+		u16 Fetch(u8 lane, u16 address);
+		u32 RunChunk(u16 cycles);
+};
@@ -1,25 +1,218 @@
 #include "MainWindow.h"
+#include <QtCore\qfile.h>
+#include <QtWidgets\qactiongroup.h>
+#include <QtWidgets\qfiledialog.h>
+#include <QtWidgets\qmessagebox.h>
+#include <QtWidgets\qstatusbar.h>
+
+namespace
+{
+		const int frame_interval = 1000 / Scheduler::frames_per_second;
+		const int initial_scale = 10;
+
+		// A little over three frames of samples can wait for the audio output,
+		// which buffers another one and a half on its own.
+		const u32 audio_buffer_samples = 2048;
+		const int audio_output_buffer = 1024;
+
+		// The usual layout of the hexadecimal keypad on the left of a keyboard.
+		const int keypad[Cpu::keys] =
+		{
+				Qt::Key_X, Qt::Key_1, Qt::Key_2, Qt::Key_3,
+				Qt::Key_Q, Qt::Key_W, Qt::Key_E, Qt::Key_A,
+				Qt::Key_S, Qt::Key_D, Qt::Key_Z, Qt::Key_C,
+				Qt::Key_4, Qt::Key_R, Qt::Key_F, Qt::Key_V
+		};
+}
 
 MainWindow::MainWindow(QWidget *parent)
-		: QMainWindow(parent)
+		: QMainWindow(parent),
+		m_status_frame(0),
+		m_input_latency(0.0),
+		m_input_latency_total(0.0),
+		m_input_latency_count(0),
+		m_audio_buffer(audio_buffer_samples)
 {
+		m_display = new DisplayWidget(this);
+		setCentralWidget(m_display);
 		CreateMenus();
 		CreateConnects();
+		CreateAudio();
+
+		resize(Cpu::screen_width * initial_scale, Cpu::screen_height * initial_scale + menuBar()->sizeHint().height() + statusBar()->sizeHint().height());
+		m_emulation_thread.SetAudio(&m_audio_buffer);
+		m_emulation_thread.Start();
+		m_audio_output->start(m_audio_device);
+		m_frame_timer->start(frame_interval);
 }
 
 MainWindow::~MainWindow()
 {
+		m_frame_timer->stop();
+		m_audio_output->stop();
+		m_emulation_thread.Stop();
+}
+
+void MainWindow::CreateAudio()
+{
+		QAudioFormat format;
+
+		format.setSampleRate(m_audio_buffer.GetSampleRate());
+		format.setChannelCount(1);
+		format.setSampleSize(8);
+		format.setSampleType(QAudioFormat::UnSignedInt);
+		format.setCodec("audio/pcm");
+
+		m_audio_device = new AudioDevice(m_audio_buffer, this);
+		m_audio_device->open(QIODevice::ReadOnly);
+		m_audio_output = new QAudioOutput(format, this);
+		m_audio_output->setBufferSize(audio_output_buffer);
 }
 
 void MainWindow::CreateConnects()
 {
+		connect(m_action_open, &QAction::triggered, [=]() { OpenProgram(); });
 		connect(m_action_exit, &QAction::triggered, [=]() { close(); });
+		connect(m_filter_group, &QActionGroup::triggered, [=](QAction *action) { m_display->SetFilter(static_cast<Upscaler::Filter>(action->data().toInt())); });
+		connect(m_quirks_group, &QActionGroup::triggered, [=](QAction *action) { m_emulation_thread.SetQuirks(static_cast<Cpu::Quirks>(action->data().toInt())); });
+
+		m_frame_timer = new QTimer(this);
+		m_frame_timer->setTimerType(Qt::PreciseTimer);
+		connect(m_frame_timer, &QTimer::timeout, [=]()
+		{
+				if (!m_emulation_thread.AcquireFrame())
+						return;
+
+				const TripleBuffer::Frame &frame = m_emulation_thread.GetFrame();
+
+				m_display->SetFrame(frame);
+
+				// The repaint SetFrame asks for happens before the event loop gets
+				// back to this timer, so this is close to when the frame shows.
+				if (frame.input_time)
+				{
+						InputQueue::Clock::duration latency = InputQueue::Clock::now().time_since_epoch() - InputQueue::Clock::duration(frame.input_time);
+
+						m_input_latency_total += std::chrono::duration<double, std::milli>(latency).count();
+						++m_input_latency_count;
+				}
+
+				if (frame.number - m_status_frame < Scheduler::frames_per_second)
+						return;
+
+				if (m_input_latency_count)
+				{
+						m_input_latency = m_input_latency_total / m_input_latency_count;
+						m_input_latency_total = 0.0;
+						m_input_latency_count = 0;
+				}
+
+				// One byte per sample, so the output's buffer size is in samples.
+				double audio_latency = m_audio_buffer.GetLatency() + static_cast<double>(m_audio_output->bufferSize()) / m_audio_buffer.GetSampleRate();
+
+				statusBar()->showMessage(QString("Paint %1 ms, Input %2 ms, Audio %3 ms, %4 underruns")
+						.arg(m_display->GetPaintTime(), 0, 'f', 3)
+						.arg(m_input_latency, 0, 'f', 1)
+						.arg(audio_latency * 1000.0, 0, 'f', 1)
+						.arg(m_audio_buffer.GetUnderruns()));
+				m_status_frame = frame.number;
+		});
 }
 
 void MainWindow::CreateMenus()
 {
 		m_menu_file = new QMenu("&File");
+		m_action_open = m_menu_file->addAction("&Open...");
+		m_menu_file->addSeparator();
 		m_action_exit = m_menu_file->addAction("Exit");
 
 		menuBar()->addMenu(m_menu_file);
-}
\ No newline at end of file
+
+		m_menu_view = new QMenu("&View");
+		m_menu_filter = m_menu_view->addMenu("&Filter");
+
+		m_filter_group = new QActionGroup(this);
+
+		const char *filter_names[] = { "&Nearest", "Scale&2x (EPX)", "Scale&3x" };
+
+		for (u8 filter = 0; filter < sizeof filter_names / sizeof *filter_names; ++filter)
+		{
+				QAction *action = m_filter_group->addAction(filter_names[filter]);
+
+				action->setCheckable(true);
+				action->setChecked(static_cast<Upscaler::Filter>(filter) == Upscaler::Filter::nearest);
+				action->setData(static_cast<int>(filter));
+				m_menu_filter->addAction(action);
+		}
+
+		menuBar()->addMenu(m_menu_view);
+
+		m_menu_emulation = new QMenu("&Emulation");
+		m_menu_quirks = m_menu_emulation->addMenu("&Quirks");
+
+		m_quirks_group = new QActionGroup(this);
+
+		const char *quirks_names[] = { "&COSMAC VIP", "CHIP-&48 / SUPER-CHIP" };
+		const Cpu::Quirks quirks_values[] = { Cpu::cosmac_vip_quirks, Cpu::chip48_quirks };
+
+		for (u8 quirks = 0; quirks < sizeof quirks_names / sizeof *quirks_names; ++quirks)
+		{
+				QAction *action = m_quirks_group->addAction(quirks_names[quirks]);
+
+				action->setCheckable(true);
+				action->setChecked(quirks_values[quirks] == Cpu::cosmac_vip_quirks);
+				action->setData(static_cast<int>(quirks_values[quirks]));
+				m_menu_quirks->addAction(action);
+		}
+
+		menuBar()->addMenu(m_menu_emulation);
+}
+
+void MainWindow::keyPressEvent(QKeyEvent *event)
+{
+		if (!SetKey(event, true))
+				QMainWindow::keyPressEvent(event);
+}
+
+void MainWindow::keyReleaseEvent(QKeyEvent *event)
+{
+		if (!SetKey(event, false))
+				QMainWindow::keyReleaseEvent(event);
+}
+
+void MainWindow::OpenProgram()
+{
+		QString file_name = QFileDialog::getOpenFileName(this, "Open Program", QString(), "CHIP-8 Programs (*.ch8 *.c8);;All Files (*)");
+
+		if (file_name.isEmpty())
+				return;
+
+		QFile file(file_name);
+
+		if (!file.open(QIODevice::ReadOnly))
+		{
+				QMessageBox::warning(this, "Open Program", "The program couldn't be read.");
+				return;
+		}
+
+		QByteArray program = file.readAll();
+
+		if (program.size() > Cpu::program_size || !m_emulation_thread.LoadProgram(reinterpret_cast<const u8 *>(program.constData()), static_cast<u16>(program.size())))
+				QMessageBox::warning(this, "Open Program", "The program doesn't fit in memory.");
+}
+
+bool MainWindow::SetKey(QKeyEvent *event, bool pressed)
+{
+		for (u8 key = 0; key < Cpu::keys; ++key)
+		{
+				if (keypad[key] != event->key())
+						continue;
+
+				if (!event->isAutoRepeat())
+						m_emulation_thread.SetKey(key, pressed);
+
+				return true;
+		}
+
+		return false;
+}
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <QtCore\qtimer.h>
+#include <QtGui\qevent.h>
+#include <QtMultimedia\qaudiooutput.h>
 #include <QtWidgets\qmainwindow.h>
 #include <QtWidgets\qmenu.h>
 #include <QtWidgets\qmenubar.h>
+#include "AudioDevice.h"
+#include "DisplayWidget.h"
+#include "EmulationThread.h"
 
 class MainWindow : public QMainWindow
 {
@@ -12,10 +18,43 @@ public:
 		MainWindow(QWidget *parent = 0);
 		~MainWindow();
 
+protected:
+		void keyPressEvent(QKeyEvent *event) override;
+		void keyReleaseEvent(QKeyEvent *event) override;
+
 private:
+		void CreateAudio();
 		void CreateConnects();
 		void CreateMenus();
+		void OpenProgram();
+		bool SetKey(QKeyEvent *event, bool pressed);
 
 		QMenu *m_menu_file;
+		QAction *m_action_open;
 		QAction *m_action_exit;
-};
\ No newline at end of file
+		QMenu *m_menu_view;
+		QMenu *m_menu_filter;
+		QActionGroup *m_filter_group;
+		QMenu *m_menu_emulation;
+		QMenu *m_menu_quirks;
+		QActionGroup *m_quirks_group;
+		DisplayWidget *m_display;
+		u64 m_status_frame;
+
+		// Time from a key event to the first frame showing it reaching the
+		// display, averaged over every status bar update.
+		double m_input_latency;
+		double m_input_latency_total;
+		u32 m_input_latency_count;
+
+		// The GUI thread picks up the newest frame on its own timer, so slow
+		// paints and menus never hold up the emulation thread.
+		QTimer *m_frame_timer;
+
+		// Sound timer beeps go from the emulation thread to QAudioOutput through
+		// m_audio_buffer, so neither side ever waits on the other.
+		AudioBuffer m_audio_buffer;
+		AudioDevice *m_audio_device;
+		QAudioOutput *m_audio_output;
+		EmulationThread m_emulation_thread;
+};
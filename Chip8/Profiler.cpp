@@ -0,0 +1,164 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+Profiler::Profiler()
+		: m_opcodes(0x10000)
+{
+		Reset();
+}
+
+Profiler::~Profiler()
+{
+}
+
+void Profiler::CountFrame(u32 cycles)
+{
+		m_frame_cycles.push_back(cycles);
+}
+
+void Profiler::CountIdleCycles(u16 address, u32 cycles)
+{
+		m_heatmap[address] += cycles;
+		m_idle_cycles += cycles;
+}
+
+std::string Profiler::ExportCsv()
+{
+		std::string csv = "section,key,value\n";
+		char line[64];
+
+		for (const OperationCount &operation : GetOperationCounts())
+		{
+				snprintf(line, sizeof line, "operation,%s,%llu\n", operation.name, static_cast<unsigned long long>(operation.count));
+				csv += line;
+		}
+
+		for (u16 address = 0; address < Cpu::ram_size; ++address)
+		{
+				if (!m_heatmap[address])
+						continue;
+
+				snprintf(line, sizeof line, "address,0x%03X,%llu\n", address, static_cast<unsigned long long>(m_heatmap[address]));
+				csv += line;
+		}
+
+		for (size_t frame = 0; frame < m_frame_cycles.size(); ++frame)
+		{
+				snprintf(line, sizeof line, "frame,%zu,%u\n", frame, m_frame_cycles[frame]);
+				csv += line;
+		}
+
+		snprintf(line, sizeof line, "idle,cycles,%llu\n", static_cast<unsigned long long>(m_idle_cycles));
+		csv += line;
+
+		return csv;
+}
+
+std::string Profiler::ExportJson()
+{
+		std::string json = "{\n\t\"operations\": {";
+		char entry[64];
+		const char *separator = "";
+
+		for (const OperationCount &operation : GetOperationCounts())
+		{
+				snprintf(entry, sizeof entry, "%s\n\t\t\"%s\": %llu", separator, operation.name, static_cast<unsigned long long>(operation.count));
+				json += entry;
+				separator = ",";
+		}
+
+		// Only addresses that ran are listed, keyed by address.
+		json += "\n\t},\n\t\"heatmap\": {";
+		separator = "";
+
+		for (u16 address = 0; address < Cpu::ram_size; ++address)
+		{
+				if (!m_heatmap[address])
+						continue;
+
+				snprintf(entry, sizeof entry, "%s\n\t\t\"0x%03X\": %llu", separator, address, static_cast<unsigned long long>(m_heatmap[address]));
+				json += entry;
+				separator = ",";
+		}
+
+		json += "\n\t},\n\t\"frame_cycles\": [";
+		separator = "";
+
+		for (u32 cycles : m_frame_cycles)
+		{
+				snprintf(entry, sizeof entry, "%s%u", separator, cycles);
+				json += entry;
+				separator = ", ";
+		}
+
+		snprintf(entry, sizeof entry, "],\n\t\"idle_cycles\": %llu\n}\n", static_cast<unsigned long long>(m_idle_cycles));
+		json += entry;
+
+		return json;
+}
+
+const std::vector<u32> &Profiler::GetFrameCycles()
+{
+		return m_frame_cycles;
+}
+
+const u64 *Profiler::GetHeatmap()
+{
+		return m_heatmap;
+}
+
+u64 Profiler::GetIdleCycles()
+{
+		return m_idle_cycles;
+}
+
+u64 Profiler::GetInstructions()
+{
+		u64 instructions = 0;
+
+		for (u64 count : m_opcodes)
+		{
+				instructions += count;
+		}
+
+		return instructions;
+}
+
+u64 Profiler::GetOpcodeCount(u16 opcode)
+{
+		return m_opcodes[opcode];
+}
+
+std::vector<Profiler::OperationCount> Profiler::GetOperationCounts()
+{
+		// The names are static strings, one per operation, so their addresses
+		// tell the operations apart.
+		std::map<const char *, u64> counts;
+		std::vector<OperationCount> operations;
+
+		for (u32 opcode = 0; opcode < m_opcodes.size(); ++opcode)
+		{
+				if (m_opcodes[opcode])
+						counts[Cpu::GetOperationName(static_cast<u16>(opcode))] += m_opcodes[opcode];
+		}
+
+		for (const auto &count : counts)
+		{
+				operations.push_back({ count.first, count.second });
+		}
+
+		std::sort(operations.begin(), operations.end(), [](const OperationCount &a, const OperationCount &b) { return a.count != b.count ? a.count > b.count : strcmp(a.name, b.name) < 0; });
+
+		return operations;
+}
+
+void Profiler::Reset()
+{
+		std::fill(m_opcodes.begin(), m_opcodes.end(), 0);
+		memset(m_heatmap, NULL, sizeof m_heatmap);
+		m_idle_cycles = 0;
+		m_frame_cycles.clear();
+}
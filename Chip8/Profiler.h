@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Cpu.h"
+#include <string>
+#include <vector>
+
+// Passed to Cpu::Run as its profiling policy when nothing is recorded. Every
+// call is empty and inlined away, so plain runs cost exactly what they did
+// before profiling existed.
+struct NullProfiler
+{
+		void CountInstruction(u16 /*address*/, u16 /*opcode*/) {}
+		void CountIdleCycles(u16 /*address*/, u32 /*cycles*/) {}
+		void Retire(const u8 * /*data_registers*/, u16 /*index*/) {}
+};
+
+// Records what a Cpu spends its cycles on when passed to Cpu::Run: how often
+// every opcode ran, summed up per operation on export, how many cycles were
+// spent at every ram address, and how many cycles every frame took as the
+// host counts them. Exports to CSV and JSON for other tools.
+class Profiler
+{
+public:
+		struct OperationCount
+		{
+				const char *name;
+				u64 count;
+		};
+
+		Profiler();
+		~Profiler();
+
+		// Called for every instruction, so kept inline for the profiled Run.
+		void CountInstruction(u16 address, u16 opcode)
+		{
+				++m_opcodes[opcode];
+				++m_heatmap[address];
+		}
+
+		// Idle loops fast forwarded as a whole count against their address.
+		void CountIdleCycles(u16 address, u32 cycles);
+
+		// The registers left behind are of no interest to a profile.
+		void Retire(const u8 * /*data_registers*/, u16 /*index*/) {}
+
+		void CountFrame(u32 cycles);
+		void Reset();
+
+		u64 GetInstructions();
+		u64 GetIdleCycles();
+		u64 GetOpcodeCount(u16 opcode);
+
+		// Operations that ran at least once, the most frequent first.
+		std::vector<OperationCount> GetOperationCounts();
+
+		// Cycles spent at every ram address, Cpu::ram_size entries.
+		const u64 *GetHeatmap();
+		const std::vector<u32> &GetFrameCycles();
+
+		std::string ExportCsv();
+		std::string ExportJson();
+
+private:
+		std::vector<u64> m_opcodes;
+		u64 m_heatmap[Cpu::ram_size];
+		u64 m_idle_cycles;
+		std::vector<u32> m_frame_cycles;
+};
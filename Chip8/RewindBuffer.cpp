@@ -0,0 +1,222 @@
+#include "RewindBuffer.h"
+#include <cstring>
+
+namespace
+{
+		// Equal bytes that may sit inside one run before it is split, since a
+		// new run costs a four byte header.
+		const u32 max_run_gap = 4;
+
+		void AppendU16(std::vector<u8> &bytes, u16 value)
+		{
+				bytes.push_back(value & 0xFF);
+				bytes.push_back(value >> 8);
+		}
+
+		u16 ReadU16(const u8 *bytes)
+		{
+				return bytes[0] | bytes[1] << 8;
+		}
+}
+
+RewindBuffer::RewindBuffer(u32 capacity, u32 keyframe_interval)
+		: m_capacity(capacity ? capacity : 1),
+		m_keyframe_interval(keyframe_interval ? keyframe_interval : 1),
+		m_length(0)
+{
+}
+
+RewindBuffer::~RewindBuffer()
+{
+}
+
+void RewindBuffer::Clear()
+{
+		m_groups.clear();
+		m_length = 0;
+}
+
+void RewindBuffer::DecodeDelta(const u8 *delta, const u8 *end, Cpu::State &state)
+{
+		u8 *bytes = reinterpret_cast<u8 *>(&state);
+		u32 position = 0;
+
+		while (delta < end)
+		{
+				u16 skip = ReadU16(delta);
+				u16 length = ReadU16(delta + 2);
+
+				position += skip;
+				memcpy(bytes + position, delta + 4, length);
+				position += length;
+				delta += 4 + length;
+		}
+}
+
+// Each run is the number of unchanged bytes since the previous run, the
+// number of bytes that follow and the new bytes themselves.
+void RewindBuffer::EncodeDelta(const Cpu::State &keyframe, const Cpu::State &state, std::vector<u8> &deltas)
+{
+		const u8 *old_bytes = reinterpret_cast<const u8 *>(&keyframe);
+		const u8 *new_bytes = reinterpret_cast<const u8 *>(&state);
+		const u32 size = sizeof(Cpu::State);
+		u32 position = 0;
+		u32 previous_end = 0;
+
+		while (position < size)
+		{
+				u64 old_word;
+				u64 new_word;
+
+				if (position % sizeof(u64) == 0 && position + sizeof(u64) <= size)
+				{
+						memcpy(&old_word, old_bytes + position, sizeof old_word);
+						memcpy(&new_word, new_bytes + position, sizeof new_word);
+
+						if (old_word == new_word)
+						{
+								position += sizeof(u64);
+								continue;
+						}
+				}
+
+				if (old_bytes[position] == new_bytes[position])
+				{
+						++position;
+						continue;
+				}
+
+				u32 start = position;
+				u32 end = position + 1;
+
+				for (position = end; position < size && position - end < max_run_gap; ++position)
+				{
+						if (old_bytes[position] != new_bytes[position])
+								end = position + 1;
+				}
+
+				AppendU16(deltas, static_cast<u16>(start - previous_end));
+				AppendU16(deltas, static_cast<u16>(end - start));
+				deltas.insert(deltas.end(), new_bytes + start, new_bytes + end);
+				previous_end = end;
+				position = end;
+		}
+}
+
+u32 RewindBuffer::GetGroupLength(const Group &group)
+{
+		return 1 + static_cast<u32>(group.delta_offsets.size());
+}
+
+u32 RewindBuffer::GetLength()
+{
+		return m_length;
+}
+
+size_t RewindBuffer::GetMemoryUsage()
+{
+		size_t memory_usage = sizeof *this;
+
+		for (const auto &group : m_groups)
+		{
+				memory_usage += sizeof group + group.deltas.capacity() + group.delta_offsets.capacity() * sizeof(u32);
+		}
+
+		return memory_usage;
+}
+
+bool RewindBuffer::GetState(u32 frames_ago, Cpu::State &state)
+{
+		if (frames_ago >= m_length)
+				return false;
+
+		u32 frame = frames_ago;
+
+		for (auto group = m_groups.rbegin(); group != m_groups.rend(); ++group)
+		{
+				u32 group_length = GetGroupLength(*group);
+
+				if (frame >= group_length)
+				{
+						frame -= group_length;
+						continue;
+				}
+
+				u32 delta = group_length - 1 - frame;
+
+				state = group->keyframe;
+
+				if (delta)
+				{
+						const u8 *deltas = group->deltas.data();
+						u32 begin = group->delta_offsets[delta - 1];
+						u32 end = delta < group->delta_offsets.size() ? group->delta_offsets[delta] : static_cast<u32>(group->deltas.size());
+
+						DecodeDelta(deltas + begin, deltas + end, state);
+				}
+
+				return true;
+		}
+
+		return false;
+}
+
+void RewindBuffer::Push(Cpu &cpu)
+{
+		cpu.SaveState(m_state);
+
+		if (!m_groups.empty() && GetGroupLength(m_groups.back()) < m_keyframe_interval)
+		{
+				Group &group = m_groups.back();
+
+				group.delta_offsets.push_back(static_cast<u32>(group.deltas.size()));
+				EncodeDelta(group.keyframe, m_state, group.deltas);
+				++m_length;
+				return;
+		}
+
+		if (!m_groups.empty() && m_length + 1 - GetGroupLength(m_groups.front()) >= m_capacity)
+		{
+				m_length -= GetGroupLength(m_groups.front());
+				m_groups.push_back(std::move(m_groups.front()));
+				m_groups.pop_front();
+		}
+		else
+		{
+				m_groups.emplace_back();
+		}
+
+		Group &group = m_groups.back();
+
+		group.keyframe = m_state;
+		group.deltas.clear();
+		group.delta_offsets.clear();
+		++m_length;
+}
+
+bool RewindBuffer::Rewind(Cpu &cpu, u32 frames)
+{
+		if (frames >= m_length)
+				return false;
+
+		for (u32 frame = 0; frame < frames; ++frame)
+		{
+				Group &group = m_groups.back();
+
+				if (group.delta_offsets.empty())
+				{
+						m_groups.pop_back();
+				}
+				else
+				{
+						group.deltas.resize(group.delta_offsets.back());
+						group.delta_offsets.pop_back();
+				}
+		}
+
+		m_length -= frames;
+		GetState(0, m_state);
+		cpu.LoadState(m_state);
+
+		return true;
+}
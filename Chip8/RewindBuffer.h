@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Cpu.h"
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Keeps one Cpu snapshot per frame. Every keyframe_interval-th snapshot is
+// stored whole and the ones in between only as the runs of bytes that differ
+// from their keyframe, so reading any frame back costs one keyframe copy and
+// one delta. Once more than capacity frames are held the oldest keyframe and
+// its deltas are recycled for the next keyframe.
+class RewindBuffer
+{
+public:
+		RewindBuffer(u32 capacity, u32 keyframe_interval = 60);
+		~RewindBuffer();
+
+		void Clear();
+		u32 GetLength();
+		size_t GetMemoryUsage();
+		bool GetState(u32 frames_ago, Cpu::State &state);
+		void Push(Cpu &cpu);
+		bool Rewind(Cpu &cpu, u32 frames);
+
+private:
+		struct Group
+		{
+				Cpu::State keyframe;
+				std::vector<u8> deltas;
+				std::vector<u32> delta_offsets;
+		};
+
+		u32 m_capacity;
+		u32 m_keyframe_interval;
+		u32 m_length;
+		std::deque<Group> m_groups;
+		Cpu::State m_state;
+
+		static void DecodeDelta(const u8 *delta, const u8 *end, Cpu::State &state);
+		static void EncodeDelta(const Cpu::State &keyframe, const Cpu::State &state, std::vector<u8> &deltas);
+		static u32 GetGroupLength(const Group &group);
+};
@@ -0,0 +1,192 @@
+#include "Scheduler.h"
+
+namespace
+{
+		// Achieved speed is averaged over at least this long.
+		const double speed_window = 0.5;
+}
+
+Scheduler::Scheduler(Cpu &cpu)
+		: m_cpu(cpu),
+		m_instructions_per_frame(default_instructions_per_frame),
+		m_mode(Mode::real_time),
+		m_multiplier(1.0),
+		m_started(false),
+		m_start_frames(0),
+		m_frames(0),
+		m_speed_start_frames(0),
+		m_speed(0.0)
+{
+		m_runner = [this](u32 cycles) { return m_cpu.Run(cycles); };
+		m_cpu.SetCyclesPerTick(m_instructions_per_frame);
+}
+
+Scheduler::~Scheduler()
+{
+}
+
+Scheduler::Clock::time_point Scheduler::GetFrameEnd()
+{
+		return GetFrameTime(m_frames + 1);
+}
+
+double Scheduler::GetFrameRate()
+{
+		return frames_per_second * (m_mode == Mode::multiplier ? m_multiplier : 1.0);
+}
+
+Scheduler::Clock::time_point Scheduler::GetFrameStart()
+{
+		return GetFrameTime(m_frames);
+}
+
+Scheduler::Clock::time_point Scheduler::GetFrameTime(u64 frame)
+{
+		double seconds = static_cast<double>(frame - m_start_frames) / GetFrameRate();
+
+		return m_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+u64 Scheduler::GetFrames()
+{
+		return m_frames;
+}
+
+u32 Scheduler::GetInstructionsPerFrame()
+{
+		return m_instructions_per_frame;
+}
+
+Scheduler::Mode Scheduler::GetMode()
+{
+		return m_mode;
+}
+
+double Scheduler::GetMultiplier()
+{
+		return m_multiplier;
+}
+
+double Scheduler::GetSpeed()
+{
+		return m_speed;
+}
+
+double Scheduler::GetTargetSpeed()
+{
+		switch (m_mode)
+		{
+		case Mode::real_time: return 1.0;
+		case Mode::multiplier: return m_multiplier;
+		case Mode::uncapped: return 0.0;
+		}
+
+		return 1.0;
+}
+
+Scheduler::Clock::duration Scheduler::GetTimeUntilNextFrame(Clock::time_point now)
+{
+		if (!m_started || m_mode == Mode::uncapped)
+				return Clock::duration::zero();
+
+		Clock::time_point due = GetFrameTime(m_frames + 1);
+
+		return due > now ? due - now : Clock::duration::zero();
+}
+
+void Scheduler::MeasureSpeed(Clock::time_point now)
+{
+		double seconds = std::chrono::duration<double>(now - m_speed_start).count();
+
+		if (seconds < speed_window)
+				return;
+
+		m_speed = (m_frames - m_speed_start_frames) / (seconds * frames_per_second);
+		m_speed_start = now;
+		m_speed_start_frames = m_frames;
+}
+
+void Scheduler::Restart(Clock::time_point now)
+{
+		m_start = now;
+		m_start_frames = m_frames;
+}
+
+void Scheduler::Resume()
+{
+		m_started = false;
+}
+
+u32 Scheduler::RunFrame()
+{
+		u32 executed = m_runner(m_instructions_per_frame);
+
+		++m_frames;
+
+		return executed;
+}
+
+void Scheduler::SetInstructionsPerFrame(u32 instructions_per_frame)
+{
+		m_instructions_per_frame = instructions_per_frame;
+		m_cpu.SetCyclesPerTick(instructions_per_frame);
+}
+
+void Scheduler::SetMode(Mode mode, double multiplier)
+{
+		m_mode = mode;
+		m_multiplier = multiplier > 0.0 ? multiplier : 1.0;
+		m_started = false;
+}
+
+void Scheduler::SetRunner(Runner runner)
+{
+		m_runner = runner;
+}
+
+u32 Scheduler::Update()
+{
+		return Update(Clock::now());
+}
+
+u32 Scheduler::Update(Clock::time_point now)
+{
+		if (!m_started)
+		{
+				Restart(now);
+				m_speed_start = now;
+				m_speed_start_frames = m_frames;
+				m_started = true;
+		}
+
+		u64 frames = uncapped_frames;
+		bool fell_behind = false;
+
+		if (m_mode != Mode::uncapped)
+		{
+				double elapsed = std::chrono::duration<double>(now - m_start).count();
+				u64 due = static_cast<u64>(elapsed * GetFrameRate());
+				u64 done = m_frames - m_start_frames;
+
+				frames = due > done ? due - done : 0;
+				fell_behind = frames > max_frames_behind;
+
+				if (fell_behind)
+						frames = max_frames_behind;
+		}
+
+		u32 frame = 0;
+
+		while (frame < frames && m_cpu.GetFault() == Cpu::Fault::none)
+		{
+				RunFrame();
+				++frame;
+		}
+
+		if (fell_behind)
+				Restart(now);
+
+		MeasureSpeed(now);
+
+		return frame;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Cpu.h"
+#include <chrono>
+#include <functional>
+
+// Paces a Cpu in emulated frames of instructions_per_frame cycles. The Cpu
+// ticks its timers once every instructions_per_frame cycles, so they run at
+// 60 Hz of emulated time however the frames are batched. Real time and
+// multiplier modes run the frames that are due by the host clock, catching
+// up at most max_frames_behind frames before they give up on the lost time.
+// Uncapped runs uncapped_frames per Update and never asks the caller to wait.
+class Scheduler
+{
+public:
+		using Clock = std::chrono::steady_clock;
+		using Runner = std::function<u32(u32 cycles)>;
+
+		static const u32 frames_per_second = 60;
+		static const u32 default_instructions_per_frame = 10;
+		static const u32 max_frames_behind = 6;
+		static const u32 uncapped_frames = 10;
+
+		enum class Mode
+				: u8
+		{
+				real_time,
+				multiplier,
+				uncapped
+		};
+
+		Scheduler(Cpu &cpu);
+		~Scheduler();
+
+		double GetFrameRate();
+		u64 GetFrames();
+		u32 GetInstructionsPerFrame();
+		Mode GetMode();
+		double GetMultiplier();
+		double GetSpeed();
+		double GetTargetSpeed();
+		Clock::duration GetTimeUntilNextFrame(Clock::time_point now);
+
+		// The stretch of host time the frame being run stands for, which a
+		// runner can use to place host events inside the frame. Only
+		// meaningful while Update runs frames in a paced mode.
+		Clock::time_point GetFrameStart();
+		Clock::time_point GetFrameEnd();
+
+		void SetInstructionsPerFrame(u32 instructions_per_frame);
+		void SetMode(Mode mode, double multiplier = 1.0);
+		void SetRunner(Runner runner);
+
+		u32 RunFrame();
+		u32 Update();
+		u32 Update(Clock::time_point now);
+
+		// Lets go of the time since the last Update instead of catching up on
+		// it, for callers that stopped updating on purpose.
+		void Resume();
+
+private:
+		Cpu &m_cpu;
+		Runner m_runner;
+		u32 m_instructions_per_frame;
+		Mode m_mode;
+		double m_multiplier;
+
+		// Frames are due relative to the last time the pace changed.
+		bool m_started;
+		Clock::time_point m_start;
+		u64 m_start_frames;
+		u64 m_frames;
+
+		Clock::time_point m_speed_start;
+		u64 m_speed_start_frames;
+		double m_speed;
+
+		Clock::time_point GetFrameTime(u64 frame);
+		void MeasureSpeed(Clock::time_point now);
+		void Restart(Clock::time_point now);
+};
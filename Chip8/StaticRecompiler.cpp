@@ -0,0 +1,368 @@
+#include "StaticRecompiler.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+		std::string Format(const char *format, ...)
+		{
+				char buffer[256];
+				va_list arguments;
+
+				va_start(arguments, format);
+				vsnprintf(buffer, sizeof buffer, format, arguments);
+				va_end(arguments);
+
+				return buffer;
+		}
+
+		std::string RegisterName(u8 data_register)
+		{
+				return Format("DataRegisters::v%X", data_register);
+		}
+
+		const char *file_header =
+				"#include \"Cpu.h\"\n"
+				"#include <cstring>\n"
+				"\n"
+				"namespace\n"
+				"{\n"
+				"\t\tusing DataRegisters = Cpu::DataRegisters;\n"
+				"\n"
+				"\t\tstruct CodeRange\n"
+				"\t\t{\n"
+				"\t\t\t\tu16 address;\n"
+				"\t\t\t\tu16 size;\n"
+				"\t\t};\n"
+				"\n";
+
+		const char *file_helpers =
+				"\t\tbool IsCodeIntact(Cpu &cpu)\n"
+				"\t\t{\n"
+				"\t\t\t\tfor (const CodeRange &code_range : code_ranges)\n"
+				"\t\t\t\t{\n"
+				"\t\t\t\t\t\tif (memcmp(cpu.GetRam() + code_range.address, program + code_range.address - Cpu::program_start, code_range.size) != 0)\n"
+				"\t\t\t\t\t\t\t\treturn false;\n"
+				"\t\t\t\t}\n"
+				"\n"
+				"\t\t\t\treturn true;\n"
+				"\t\t}\n"
+				"\n"
+				"\t\tbool TouchesCode(u16 address, u16 size)\n"
+				"\t\t{\n"
+				"\t\t\t\tfor (u16 offset = 0; offset < size; ++offset)\n"
+				"\t\t\t\t{\n"
+				"\t\t\t\t\t\tu16 written_address = (address + offset) & 0xFFF;\n"
+				"\n"
+				"\t\t\t\t\t\tfor (const CodeRange &code_range : code_ranges)\n"
+				"\t\t\t\t\t\t{\n"
+				"\t\t\t\t\t\t\t\tif (written_address >= code_range.address && written_address < code_range.address + code_range.size)\n"
+				"\t\t\t\t\t\t\t\t\t\treturn true;\n"
+				"\t\t\t\t\t\t}\n"
+				"\t\t\t\t}\n"
+				"\n"
+				"\t\t\t\treturn false;\n"
+				"\t\t}\n"
+				"}\n"
+				"\n";
+}
+
+StaticRecompiler::StaticRecompiler(const u8 *program, u16 size)
+		: m_program_size(std::min(size, static_cast<u16>(Cpu::program_size))),
+		m_code_bytes(Cpu::ram_size)
+{
+		memset(m_ram, NULL, sizeof m_ram);
+		memcpy(m_ram + Cpu::program_start, program, m_program_size);
+		RecoverControlFlow();
+}
+
+StaticRecompiler::~StaticRecompiler()
+{
+}
+
+const std::vector<u16> &StaticRecompiler::GetComputedJumps()
+{
+		return m_computed_jumps;
+}
+
+const std::vector<u16> &StaticRecompiler::GetInstructionAddresses()
+{
+		return m_instruction_addresses;
+}
+
+u16 StaticRecompiler::GetOpcode(u16 address)
+{
+		return m_ram[address] << 8 | m_ram[(address + 1) % Cpu::ram_size];
+}
+
+void StaticRecompiler::RecoverControlFlow()
+{
+		std::vector<bool> visited(Cpu::ram_size);
+		u16 program_start = Cpu::program_start;
+		std::vector<u16> pending(1, program_start);
+		u16 program_end = program_start + m_program_size;
+
+		while (!pending.empty())
+		{
+				u16 address = pending.back();
+
+				pending.pop_back();
+
+				if (address < program_start || address + 1 >= program_end || visited[address])
+						continue;
+
+				u16 opcode = GetOpcode(address);
+				u16 next = address + 2;
+				u16 skip = address + 4;
+
+				visited[address] = true;
+				m_code_bytes[address] = true;
+				m_code_bytes[address + 1] = true;
+				m_instruction_addresses.push_back(address);
+
+				switch (opcode >> 12)
+				{
+				case 0x0:
+						if (opcode != 0x00EE)
+								pending.push_back(next);
+						break;
+				case 0x1:
+						pending.push_back(opcode & 0x0FFF);
+						break;
+				case 0x2:
+						pending.push_back(next);
+						pending.push_back(opcode & 0x0FFF);
+						break;
+				case 0x3:
+				case 0x4:
+				case 0x5:
+				case 0x9:
+				case 0xE:
+						pending.push_back(next);
+						pending.push_back(skip);
+						break;
+				case 0xB:
+						m_computed_jumps.push_back(address);
+						break;
+				default:
+						pending.push_back(next);
+						break;
+				}
+		}
+
+		std::sort(m_instruction_addresses.begin(), m_instruction_addresses.end());
+		std::sort(m_computed_jumps.begin(), m_computed_jumps.end());
+}
+
+std::string StaticRecompiler::Translate(const std::string &function_name)
+{
+		std::string code = Format("// Generated by StaticRecompiler. Declare as:\n// u32 %s(Cpu &cpu, u32 cycles);\n\n", function_name.c_str());
+
+		code += file_header;
+		code += "\t\tconst u8 program[] =\n\t\t{";
+
+		for (u16 offset = 0; offset < m_program_size; ++offset)
+		{
+				code += offset % 12 ? " " : "\n\t\t\t\t";
+				code += Format("0x%02X,", m_ram[Cpu::program_start + offset]);
+		}
+
+		code += "\n\t\t};\n\n\t\tconst CodeRange code_ranges[] =\n\t\t{\n";
+
+		for (u16 address = 0; address < Cpu::ram_size; ++address)
+		{
+				if (!m_code_bytes[address] || (address > 0 && m_code_bytes[address - 1]))
+						continue;
+
+				u16 end = address;
+
+				while (end < Cpu::ram_size && m_code_bytes[end])
+				{
+						++end;
+				}
+
+				code += Format("\t\t\t\t{ 0x%03X, 0x%03X },\n", address, end - address);
+		}
+
+		if (m_instruction_addresses.empty())
+				code += "\t\t\t\t{ Cpu::program_start, 0 },\n";
+
+		code += "\t\t};\n\n";
+		code += file_helpers;
+		code += Format("u32 %s(Cpu &cpu, u32 cycles)\n{\n", function_name.c_str());
+		code += "\t\tu32 executed = 0;\n\t\tu32 native = 0;\n\n";
+		code += "\t\tif (!IsCodeIntact(cpu))\n\t\t\t\treturn cpu.Run(cycles);\n\n";
+		code += "dispatch:\n";
+		code += "\t\tif (executed == cycles || cpu.GetFault() != Cpu::Fault::none)\n\t\t\t\tgoto finish;\n\n";
+		code += "\t\tswitch (cpu.GetProgramCounter())\n\t\t{\n";
+
+		for (u16 address : m_instruction_addresses)
+		{
+				code += Format("\t\tcase 0x%03X: goto pc_%03X;\n", address, address);
+		}
+
+		code += "\t\t}\n\n";
+		code += "\t\texecuted += cpu.Run(1);\n\t\tgoto dispatch;\n";
+
+		for (size_t instruction = 0; instruction < m_instruction_addresses.size(); ++instruction)
+		{
+				u16 address = m_instruction_addresses[instruction];
+				std::string instruction_code;
+				bool falls_through = true;
+
+				code += Format("\npc_%03X:\n", address);
+
+				if (!TranslateInstruction(address, instruction_code, falls_through))
+				{
+						code += Format("\t\tcpu.Jump(0x%03X);\n\t\texecuted += cpu.Run(1);\n\t\tgoto dispatch;\n", address);
+						continue;
+				}
+
+				code += Format("\t\tif (executed == cycles)\n\t\t{\n\t\t\t\tcpu.Jump(0x%03X);\n\t\t\t\tgoto finish;\n\t\t}\n\n", address);
+				code += "\t\t++executed;\n\t\t++native;\n";
+				code += instruction_code;
+
+				bool next_is_adjacent = instruction + 1 < m_instruction_addresses.size() && m_instruction_addresses[instruction + 1] == address + 2;
+
+				if (falls_through && !next_is_adjacent)
+						code += "\t\t" + TranslateGoto(address + 2) + "\n";
+		}
+
+		code += "\nfinish:\n\t\tcpu.AddCycles(native);\n\t\treturn executed;\n";
+		code += "\ninterpret:\n\t\tcpu.AddCycles(native);\n\t\treturn executed + cpu.Run(cycles - executed);\n}\n";
+
+		return code;
+}
+
+std::string StaticRecompiler::TranslateGoto(u16 address)
+{
+		if (std::binary_search(m_instruction_addresses.begin(), m_instruction_addresses.end(), address))
+				return Format("goto pc_%03X;", address);
+
+		return Format("cpu.Jump(0x%03X);\n\t\tgoto dispatch;", address & 0xFFF);
+}
+
+bool StaticRecompiler::TranslateInstruction(u16 address, std::string &code, bool &falls_through)
+{
+		u16 opcode = GetOpcode(address);
+		u16 next = address + 2;
+		u16 nnn = opcode & 0x0FFF;
+		u8 kk = opcode & 0x00FF;
+		u8 n = opcode & 0x000F;
+		std::string x = RegisterName((opcode & 0x0F00) >> 8);
+		std::string y = RegisterName((opcode & 0x00F0) >> 4);
+		const char *method = nullptr;
+
+		switch (opcode >> 12)
+		{
+		case 0x0:
+				if (opcode == 0x00E0)
+				{
+						code = "\t\tcpu.ClearScreen();\n";
+				}
+				else if (opcode == 0x00EE)
+				{
+						code = "\t\tcpu.Return();\n\t\tgoto dispatch;\n";
+						falls_through = false;
+				}
+				return true;
+		case 0x1:
+				code = "\t\t" + TranslateGoto(nnn) + "\n";
+				falls_through = false;
+				return true;
+		case 0x2:
+				code = Format("\t\tcpu.Jump(0x%03X);\n\t\tcpu.Call(0x%03X);\n\n", next, nnn);
+				code += "\t\tif (cpu.GetFault() != Cpu::Fault::none)\n\t\t\t\tgoto finish;\n\n\t\t" + TranslateGoto(nnn) + "\n";
+				falls_through = false;
+				return true;
+		case 0x3:
+		case 0x4:
+				code = Format("\t\tif (cpu.GetDataRegister(%s) %s 0x%02X)\n\t\t{\n\t\t\t\t", x.c_str(), opcode >> 12 == 0x3 ? "==" : "!=", kk);
+				code += TranslateGoto(address + 4) + "\n\t\t}\n";
+				return true;
+		case 0x5:
+		case 0x9:
+				if (n != 0x0)
+						return false;
+
+				code = Format("\t\tif (cpu.GetDataRegister(%s) %s cpu.GetDataRegister(%s))\n\t\t{\n\t\t\t\t", x.c_str(), opcode >> 12 == 0x5 ? "==" : "!=", y.c_str());
+				code += TranslateGoto(address + 4) + "\n\t\t}\n";
+				return true;
+		case 0x6:
+				code = Format("\t\tcpu.SetDataRegister(%s, 0x%02X);\n", x.c_str(), kk);
+				return true;
+		case 0x7:
+				code = Format("\t\tcpu.AddByte(%s, 0x%02X);\n", x.c_str(), kk);
+				return true;
+		case 0x8:
+				switch (n)
+				{
+				case 0x0: method = "StoreDataRegister"; break;
+				case 0x1: method = "OrRegisters"; break;
+				case 0x2: method = "AndRegisters"; break;
+				case 0x3: method = "XorRegisters"; break;
+				case 0x4: method = "AddRegisters"; break;
+				case 0x5: method = "SubtractRegister"; break;
+				case 0x6: method = "ShiftRegisterRight"; break;
+				case 0x7: method = "SubtractRegisters"; break;
+				case 0xE: method = "ShiftRegisterLeft"; break;
+				default: return false;
+				}
+
+				code = Format("\t\tcpu.%s(%s, %s);\n", method, x.c_str(), y.c_str());
+				return true;
+		case 0xA:
+				code = Format("\t\tcpu.StoreAddress(0x%03X);\n", nnn);
+				return true;
+		case 0xB:
+				code = Format("\t\tcpu.JumpPlus(0x%03X);\n\t\tgoto dispatch;\n", nnn);
+				falls_through = false;
+				return true;
+		case 0xC:
+				code = Format("\t\tcpu.StoreRandomNumber(%s, 0x%02X);\n", x.c_str(), kk);
+				return true;
+		case 0xD:
+				code = Format("\t\tcpu.DrawSprite(%s, %s, %u);\n", x.c_str(), y.c_str(), n);
+				return true;
+		case 0xE:
+				if (kk != 0x9E && kk != 0xA1)
+						return false;
+
+				code = Format("\t\tif (%scpu.IsKeyPressed(cpu.GetDataRegister(%s)))\n\t\t{\n\t\t\t\t", kk == 0x9E ? "" : "!", x.c_str());
+				code += TranslateGoto(address + 4) + "\n\t\t}\n";
+				return true;
+		case 0xF:
+				switch (kk)
+				{
+				case 0x07:
+				case 0x15:
+				case 0x18:
+						// Timers count down from the cycle counter, so bring it up to date
+						// before touching them.
+						code = "\t\tcpu.AddCycles(native - 1);\n\t\tnative = 1;\n";
+						code += Format("\t\tcpu.%s(%s);\n", kk == 0x07 ? "StoreDelayTimer" : kk == 0x15 ? "SetDelayTimer" : "SetSoundTimer", x.c_str());
+						return true;
+				case 0x1E: method = "AddIndex"; break;
+				case 0x29: method = "SetTextCharacter"; break;
+				case 0x65: method = "SetDataRegisters"; break;
+				case 0x33:
+				case 0x55:
+						// Writes that land in translated code hand the rest of the run to
+						// the interpreter, which sees the modified instructions.
+						code = "\t\t{\n\t\t\t\tu16 index = cpu.GetIndex();\n\n";
+						code += Format("\t\t\t\tcpu.%s(%s);\n\n", kk == 0x33 ? "StoreBinaryCodedDecimal" : "StoreDataRegisters", x.c_str());
+						code += Format("\t\t\t\tif (TouchesCode(index, %u))\n\t\t\t\t{\n", kk == 0x33 ? 3 : ((opcode & 0x0F00) >> 8) + 1);
+						code += Format("\t\t\t\t\t\tcpu.Jump(0x%03X);\n\t\t\t\t\t\tgoto interpret;\n\t\t\t\t}\n\t\t}\n", next & 0xFFF);
+						return true;
+				default:
+						return false;
+				}
+
+				code = Format("\t\tcpu.%s(%s);\n", method, x.c_str());
+				return true;
+		}
+
+		return false;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Cpu.h"
+#include <string>
+#include <vector>
+
+// Translates a program into a C++ function that runs it against a Cpu
+// without fetching or decoding. Control flow is recovered by following
+// jumps, calls and skips from the entry point. Computed jumps, targets that
+// were not recovered and code the program overwrites fall back to the Cpu
+// interpreter.
+class StaticRecompiler
+{
+public:
+		StaticRecompiler(const u8 *program, u16 size);
+		~StaticRecompiler();
+
+		const std::vector<u16> &GetInstructionAddresses();
+		const std::vector<u16> &GetComputedJumps();
+		std::string Translate(const std::string &function_name);
+
+private:
+		u8 m_ram[Cpu::ram_size];
+		u16 m_program_size;
+		std::vector<bool> m_code_bytes;
+		std::vector<u16> m_instruction_addresses;
+		std::vector<u16> m_computed_jumps;
+
+		void RecoverControlFlow();
+		u16 GetOpcode(u16 address);
+		std::string TranslateGoto(u16 address);
+		bool TranslateInstruction(u16 address, std::string &code, bool &falls_through);
+};
@@ -0,0 +1,235 @@
+#include "TraceReader.h"
+#include <cstring>
+
+namespace
+{
+		const u8 min_match = 4;
+
+		u16 ReadU16(const u8 *bytes)
+		{
+				return bytes[0] | bytes[1] << 8;
+		}
+
+		u32 ReadU32(const u8 *bytes)
+		{
+				return ReadU16(bytes) | static_cast<u32>(ReadU16(bytes + 2)) << 16;
+		}
+}
+
+TraceReader::TraceReader()
+		: m_block_size(0),
+		m_position(0),
+		m_damaged(false)
+{
+}
+
+TraceReader::~TraceReader()
+{
+}
+
+void TraceReader::Close()
+{
+		m_file.close();
+		m_block_size = 0;
+		m_position = 0;
+}
+
+bool TraceReader::Decompress(const u8 *input, u32 input_size, u8 *output, u32 size)
+{
+		u32 in = 0;
+		u32 out = 0;
+
+		while (in < input_size)
+		{
+				u8 control = input[in++];
+
+				if (control < 0x80)
+				{
+						u32 run = control + 1;
+
+						if (run > input_size - in || run > size - out)
+								return false;
+
+						memcpy(output + out, input + in, run);
+						in += run;
+						out += run;
+				}
+				else
+				{
+						u32 length = (control & 0x7F) + min_match;
+
+						if (input_size - in < 2)
+								return false;
+
+						u32 offset = ReadU16(input + in);
+
+						in += 2;
+
+						if (!offset || offset > out || length > size - out)
+								return false;
+
+						// References may overlap what they write, so they are copied a
+						// byte at a time.
+						for (u32 byte = 0; byte < length; ++byte, ++out)
+						{
+								output[out] = output[out - offset];
+						}
+				}
+		}
+
+		return out == size;
+}
+
+bool TraceReader::IsDamaged()
+{
+		return m_damaged;
+}
+
+bool TraceReader::IsOpen()
+{
+		return m_file.is_open();
+}
+
+bool TraceReader::Next(Record &record)
+{
+		if (m_position == m_block_size && !ReadBlock())
+				return false;
+
+		// Records never span blocks, so one that runs off the end is damaged.
+		const u8 *bytes = m_block.data() + m_position;
+		const u8 *end = m_block.data() + m_block_size;
+		u8 flags = *bytes++;
+		u32 size = (flags & TraceRecorder::jumped ? 2 : 0) + (flags & TraceRecorder::idle ? 4 : 2) + (flags & TraceRecorder::index_changed ? 2 : 0) + (flags & TraceRecorder::one_register_changed ? 2 : 0) + (flags & TraceRecorder::registers_changed ? 2 : 0);
+
+		if (size > static_cast<u32>(end - bytes))
+		{
+				m_damaged = true;
+				return false;
+		}
+
+		m_record.address = m_next_address;
+		m_record.opcode = 0;
+		m_record.idle_cycles = 0;
+		m_record.changed_registers = 0;
+		m_record.index_changed = false;
+
+		if (flags & TraceRecorder::jumped)
+		{
+				m_record.address = ReadU16(bytes);
+				bytes += 2;
+		}
+
+		if (flags & TraceRecorder::idle)
+		{
+				m_record.idle_cycles = ReadU32(bytes);
+				bytes += 4;
+				m_next_address = m_record.address;
+		}
+		else
+		{
+				m_record.opcode = ReadU16(bytes);
+				bytes += 2;
+				m_next_address = (m_record.address + 2) % Cpu::ram_size;
+		}
+
+		if (flags & TraceRecorder::index_changed)
+		{
+				m_record.index = ReadU16(bytes);
+				m_record.index_changed = true;
+				bytes += 2;
+		}
+
+		if (flags & TraceRecorder::one_register_changed)
+		{
+				u8 data_register = bytes[0] % Cpu::data_registers;
+
+				m_record.data_registers[data_register] = bytes[1];
+				m_record.changed_registers = static_cast<u16>(1 << data_register);
+				bytes += 2;
+		}
+
+		if (flags & TraceRecorder::registers_changed)
+		{
+				m_record.changed_registers = ReadU16(bytes);
+				bytes += 2;
+
+				for (u8 data_register = 0; data_register < Cpu::data_registers; ++data_register)
+				{
+						if (!(m_record.changed_registers & 1 << data_register))
+								continue;
+
+						if (bytes == end)
+						{
+								m_damaged = true;
+								return false;
+						}
+
+						m_record.data_registers[data_register] = *bytes++;
+				}
+		}
+
+		m_position = static_cast<u32>(bytes - m_block.data());
+		record = m_record;
+
+		return true;
+}
+
+bool TraceReader::Open(const std::string &file_name)
+{
+		Close();
+		m_file.clear();
+		m_file.open(file_name, std::ios::binary);
+		m_damaged = false;
+		m_next_address = 0;
+		memset(&m_record, NULL, sizeof m_record);
+
+		u8 header[sizeof TraceRecorder::magic + 4];
+
+		if (!m_file.read(reinterpret_cast<char *>(header), sizeof header) || memcmp(header, TraceRecorder::magic, sizeof TraceRecorder::magic) || ReadU32(header + sizeof TraceRecorder::magic) != TraceRecorder::version)
+		{
+				m_file.close();
+				return false;
+		}
+
+		return true;
+}
+
+bool TraceReader::ReadBlock()
+{
+		u8 header[8];
+
+		if (!m_file.is_open() || !m_file.read(reinterpret_cast<char *>(header), sizeof header))
+				return false;
+
+		u32 size = ReadU32(header);
+		u32 stored_size = ReadU32(header + 4);
+
+		if (!size || size > TraceRecorder::block_size || stored_size > size)
+		{
+				m_damaged = true;
+				return false;
+		}
+
+		m_block.resize(size);
+
+		if (stored_size == size)
+		{
+				m_file.read(reinterpret_cast<char *>(m_block.data()), size);
+		}
+		else
+		{
+				m_stored.resize(stored_size);
+				m_file.read(reinterpret_cast<char *>(m_stored.data()), stored_size);
+
+				if (m_file && !Decompress(m_stored.data(), stored_size, m_block.data(), size))
+						m_damaged = true;
+		}
+
+		if (!m_file)
+				m_damaged = true;
+
+		m_block_size = m_damaged ? 0 : size;
+		m_position = 0;
+
+		return !m_damaged;
+}
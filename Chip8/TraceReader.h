@@ -0,0 +1,55 @@
+#pragma once
+
+#include "TraceRecorder.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Iterates the records of a trace written by TraceRecorder one block at a
+// time, putting the registers and I back together from the changes, so every
+// record carries the whole state the instruction left behind.
+class TraceReader
+{
+public:
+		// Idle records have no opcode and count the cycles of the idle loop at
+		// address that were fast forwarded; instructions have no idle cycles.
+		struct Record
+		{
+				u16 address;
+				u16 opcode;
+				u32 idle_cycles;
+				u8 data_registers[Cpu::data_registers];
+				u16 index;
+				u16 changed_registers;
+				bool index_changed;
+		};
+
+		TraceReader();
+		~TraceReader();
+
+		// False unless the file starts with a trace header this reader knows.
+		bool Open(const std::string &file_name);
+		bool IsOpen();
+		void Close();
+
+		// Reads the next record, or returns false at the end of the trace or at
+		// the first one that does not make sense.
+		bool Next(Record &record);
+		bool IsDamaged();
+
+		// Reverses TraceRecorder::Compress, returning false unless input holds
+		// exactly size bytes.
+		static bool Decompress(const u8 *input, u32 input_size, u8 *output, u32 size);
+
+private:
+		std::ifstream m_file;
+		std::vector<u8> m_block;
+		std::vector<u8> m_stored;
+		u32 m_block_size;
+		u32 m_position;
+		bool m_damaged;
+		Record m_record;
+		u16 m_next_address;
+
+		bool ReadBlock();
+};
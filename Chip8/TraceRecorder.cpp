@@ -0,0 +1,292 @@
+#include "TraceRecorder.h"
+#include <cstring>
+
+namespace
+{
+		const u8 hash_bits = 12;
+		const u8 min_match = 4;
+		const u8 max_literals = 0x80;
+		const u8 max_match = min_match + 0x7F;
+		const u32 max_offset = 0xFFFF;
+
+		void WriteU16(u8 *bytes, u16 value)
+		{
+				bytes[0] = value & 0xFF;
+				bytes[1] = value >> 8;
+		}
+
+		void WriteU32(u8 *bytes, u32 value)
+		{
+				WriteU16(bytes, value & 0xFFFF);
+				WriteU16(bytes + 2, value >> 16);
+		}
+
+		u8 *WriteLiterals(const u8 *literals, u32 count, u8 *output)
+		{
+				while (count)
+				{
+						u32 run = count < max_literals ? count : max_literals;
+
+						*output++ = static_cast<u8>(run - 1);
+						memcpy(output, literals, run);
+						output += run;
+						literals += run;
+						count -= run;
+				}
+
+				return output;
+		}
+}
+
+const char TraceRecorder::magic[4] = { 'C', '8', 'T', 'R' };
+const u32 TraceRecorder::block_size;
+
+TraceRecorder::TraceRecorder()
+		: m_compress(false),
+		m_failed(false),
+		m_block_used(0),
+		m_records(0),
+		m_bytes_written(0),
+		m_has_state(false)
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+		Close();
+}
+
+bool TraceRecorder::Close()
+{
+		if (!m_file.is_open())
+				return false;
+
+		WriteBlock();
+		m_file.close();
+
+		return !m_failed && !m_file.fail();
+}
+
+u32 TraceRecorder::Compress(const u8 *input, u32 size, u8 *output)
+{
+		// Positions of the last four bytes seen with every hash, which only
+		// hint at a match and are checked before one is taken.
+		std::vector<u32> positions(1 << hash_bits, 0);
+		u8 *start = output;
+		u32 literals = 0;
+		u32 position = 0;
+
+		while (position + min_match <= size)
+		{
+				u32 sequence;
+
+				memcpy(&sequence, input + position, sizeof sequence);
+
+				u32 hash = (sequence * 2654435761U) >> (32 - hash_bits);
+				u32 candidate = positions[hash];
+
+				positions[hash] = position;
+
+				if (candidate >= position || position - candidate > max_offset || memcmp(input + candidate, input + position, min_match))
+				{
+						++position;
+						continue;
+				}
+
+				u32 length = min_match;
+
+				while (length < max_match && position + length < size && input[candidate + length] == input[position + length])
+				{
+						++length;
+				}
+
+				output = WriteLiterals(input + literals, position - literals, output);
+				*output++ = static_cast<u8>(0x80 | (length - min_match));
+				WriteU16(output, static_cast<u16>(position - candidate));
+				output += 2;
+				position += length;
+				literals = position;
+		}
+
+		output = WriteLiterals(input + literals, size - literals, output);
+
+		return static_cast<u32>(output - start);
+}
+
+u32 TraceRecorder::GetCompressBound(u32 size)
+{
+		return size + size / max_literals + 1;
+}
+
+u64 TraceRecorder::GetBytesWritten()
+{
+		return m_bytes_written;
+}
+
+u64 TraceRecorder::GetRecords()
+{
+		return m_records;
+}
+
+bool TraceRecorder::IsOpen()
+{
+		return m_file.is_open();
+}
+
+bool TraceRecorder::Open(const std::string &file_name, bool compress)
+{
+		Close();
+
+		// Blocks are written whole, so the stream has no use for a buffer of
+		// its own.
+		m_file.clear();
+		m_file.rdbuf()->pubsetbuf(nullptr, 0);
+		m_file.open(file_name, std::ios::binary | std::ios::trunc);
+		m_compress = compress;
+		m_failed = false;
+		m_block_used = 0;
+		m_records = 0;
+		m_bytes_written = 0;
+		m_next_address = 0xFFFF;
+		m_has_state = false;
+
+		if (!m_file)
+				return false;
+
+		u8 header[sizeof magic + 4];
+
+		memcpy(header, magic, sizeof magic);
+		WriteU32(header + sizeof magic, version);
+		m_file.write(reinterpret_cast<const char *>(header), sizeof header);
+		m_bytes_written = sizeof header;
+
+		m_block.resize(block_size);
+
+		if (m_compress)
+				m_compressed.resize(GetCompressBound(block_size));
+
+		return !m_file.fail();
+}
+
+void TraceRecorder::Retire(const u8 *data_registers, u16 index)
+{
+		if (!m_file.is_open())
+				return;
+
+		if (m_block_used + max_record_size > block_size)
+				WriteBlock();
+
+		u8 *record = &m_block[m_block_used];
+		u8 *next = record + 1;
+		u8 flags = 0;
+
+		if (m_address != m_next_address)
+		{
+				flags |= jumped;
+				WriteU16(next, m_address);
+				next += 2;
+		}
+
+		if (m_idle_cycles)
+		{
+				flags |= idle;
+				WriteU32(next, m_idle_cycles);
+				next += 4;
+				m_next_address = m_address;
+		}
+		else
+		{
+				WriteU16(next, m_opcode);
+				next += 2;
+				m_next_address = (m_address + 2) % Cpu::ram_size;
+		}
+
+		// The first record holds everything, so a reader starts from a known
+		// state wherever the trace began.
+		if (!m_has_state || index != m_index)
+		{
+				flags |= index_changed;
+				WriteU16(next, index);
+				next += 2;
+				m_index = index;
+		}
+
+		if (!m_has_state || memcmp(data_registers, m_data_registers, Cpu::data_registers))
+		{
+				u16 changed = 0;
+				u8 changes = 0;
+
+				for (u8 data_register = 0; data_register < Cpu::data_registers; ++data_register)
+				{
+						if (!m_has_state || data_registers[data_register] != m_data_registers[data_register])
+						{
+								changed |= static_cast<u16>(1 << data_register);
+								++changes;
+						}
+				}
+
+				if (changes == 1)
+				{
+						u8 data_register = 0;
+
+						while (!(changed & 1 << data_register))
+						{
+								++data_register;
+						}
+
+						flags |= one_register_changed;
+						*next++ = data_register;
+						*next++ = data_registers[data_register];
+				}
+				else
+				{
+						flags |= registers_changed;
+						WriteU16(next, changed);
+						next += 2;
+
+						for (u8 data_register = 0; data_register < Cpu::data_registers; ++data_register)
+						{
+								if (changed & 1 << data_register)
+										*next++ = data_registers[data_register];
+						}
+				}
+
+				memcpy(m_data_registers, data_registers, Cpu::data_registers);
+		}
+
+		*record = flags;
+		m_block_used += static_cast<u32>(next - record);
+		m_has_state = true;
+		++m_records;
+}
+
+void TraceRecorder::WriteBlock()
+{
+		if (!m_block_used)
+				return;
+
+		const u8 *stored = m_block.data();
+		u32 stored_size = m_block_used;
+
+		if (m_compress)
+		{
+				u32 compressed_size = Compress(m_block.data(), m_block_used, m_compressed.data());
+
+				// Blocks that would not get any smaller are stored as they are.
+				if (compressed_size < m_block_used)
+				{
+						stored = m_compressed.data();
+						stored_size = compressed_size;
+				}
+		}
+
+		u8 header[8];
+
+		WriteU32(header, m_block_used);
+		WriteU32(header + 4, stored_size);
+		m_file.write(reinterpret_cast<const char *>(header), sizeof header);
+		m_file.write(reinterpret_cast<const char *>(stored), stored_size);
+		m_failed |= m_file.fail();
+		m_bytes_written += sizeof header + stored_size;
+		m_block_used = 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Cpu.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Streams a record of every instruction a Cpu retires to a file when passed
+// to Cpu::Run as its profiling policy. A record holds the opcode, the address
+// only when it does not follow on from the last one, and only the registers
+// and I that changed, so most instructions take three to five bytes. Records
+// are collected in a block owned by the recorder and written a whole block at
+// a time, optionally LZ compressed. A recorder is only ever used by the
+// thread running its Cpu, so it takes no locks; TraceReader reads it back.
+class TraceRecorder
+{
+public:
+		// The first byte of every record tells what follows it, in this order.
+		// Numbers are little endian.
+		enum RecordFlags : u8
+		{
+				// A u16 address; otherwise the record is two bytes on from the
+				// last instruction, or at the idle loop it fast forwarded.
+				jumped = 0x01,
+
+				// A u32 of fast forwarded idle cycles instead of the u16 opcode.
+				idle = 0x02,
+
+				// A u16 with the new I.
+				index_changed = 0x04,
+
+				// A u8 register and its new u8 value.
+				one_register_changed = 0x08,
+
+				// A u16 mask of the registers that changed and a new u8 value
+				// for each of them, the lowest first.
+				registers_changed = 0x10,
+		};
+
+		// Every block starts with its u32 size and the u32 size it is stored
+		// in, which is smaller only when it is compressed.
+		static const char magic[4];
+		static const u32 version = 1;
+		static const u32 block_size = 0x100000;
+		static const u32 max_record_size = 1 + 2 + 4 + 2 + 2 + Cpu::data_registers;
+
+		TraceRecorder();
+		~TraceRecorder();
+
+		bool Open(const std::string &file_name, bool compress = false);
+		bool IsOpen();
+
+		// Writes out the last block. False if anything failed to be written.
+		bool Close();
+
+		// Called for every instruction, so kept inline for the traced Run.
+		void CountInstruction(u16 address, u16 opcode)
+		{
+				m_address = address;
+				m_opcode = opcode;
+				m_idle_cycles = 0;
+		}
+
+		void CountIdleCycles(u16 address, u32 cycles)
+		{
+				m_address = address;
+				m_idle_cycles = cycles;
+		}
+
+		// Writes the record of the instruction or idle loop counted last.
+		void Retire(const u8 *data_registers, u16 index);
+
+		u64 GetRecords();
+
+		// Bytes in the file, which falls behind until a block is written.
+		u64 GetBytesWritten();
+
+		// Packs size bytes into output, which has room for at least
+		// GetCompressBound(size) bytes, and returns how many it took. Runs of
+		// literals and back references of up to 64 KiB, see TraceReader.
+		static u32 Compress(const u8 *input, u32 size, u8 *output);
+		static u32 GetCompressBound(u32 size);
+
+private:
+		std::ofstream m_file;
+		bool m_compress;
+		bool m_failed;
+		std::vector<u8> m_block;
+		std::vector<u8> m_compressed;
+		u32 m_block_used;
+		u64 m_records;
+		u64 m_bytes_written;
+
+		u16 m_address;
+		u16 m_opcode;
+		u32 m_idle_cycles;
+		u16 m_next_address;
+		u8 m_data_registers[Cpu::data_registers];
+		u16 m_index;
+		bool m_has_state;
+
+		void WriteBlock();
+};
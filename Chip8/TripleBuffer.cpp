@@ -0,0 +1,39 @@
+#include "TripleBuffer.h"
+#include <cstring>
+
+TripleBuffer::TripleBuffer()
+		: m_back(0),
+		m_front(1),
+		m_middle(2)
+{
+		memset(m_frames, NULL, sizeof m_frames);
+}
+
+TripleBuffer::~TripleBuffer()
+{
+}
+
+bool TripleBuffer::Acquire()
+{
+		if (!(m_middle.load(std::memory_order_relaxed) & fresh))
+				return false;
+
+		m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index_mask;
+
+		return true;
+}
+
+TripleBuffer::Frame &TripleBuffer::GetBack()
+{
+		return m_frames[m_back];
+}
+
+const TripleBuffer::Frame &TripleBuffer::GetFront()
+{
+		return m_frames[m_front];
+}
+
+void TripleBuffer::Publish()
+{
+		m_back = m_middle.exchange(m_back | fresh, std::memory_order_acq_rel) & index_mask;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Cpu.h"
+#include <atomic>
+
+// Hands finished frames from one producer thread to one consumer thread
+// without either of them ever waiting. The producer draws into the back
+// frame and publishes it by swapping it with the middle one, the consumer
+// takes the newest published frame by swapping the middle one with its front
+// frame, so frames the consumer is too slow for are simply dropped.
+class TripleBuffer
+{
+public:
+		// One bit per pixel with the leftmost pixel in the most significant bit
+		// of the first byte of its row, which is how QImage::Format_Mono lays
+		// out a 64x32 image, so a display can wrap a frame without converting it.
+		struct alignas(64) Frame
+		{
+				u8 pixels[Cpu::screen_height][Cpu::screen_width / 8];
+				u64 number;
+
+				// Host steady_clock ticks of the earliest key event first shown in
+				// this frame, zero when there is none, for measuring input latency.
+				u64 input_time;
+		};
+
+		TripleBuffer();
+		~TripleBuffer();
+
+		Frame &GetBack();
+		void Publish();
+
+		bool Acquire();
+		const Frame &GetFront();
+
+private:
+		// Set in m_middle while it holds a frame the consumer hasn't taken.
+		static const u8 fresh = 0x04;
+		static const u8 index_mask = 0x03;
+
+		Frame m_frames[3];
+		u8 m_back;
+		u8 m_front;
+		alignas(64) std::atomic<u8> m_middle;
+};
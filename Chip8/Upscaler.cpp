@@ -0,0 +1,216 @@
+#include "Upscaler.h"
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+		const u64 leftmost = 1ULL << 63;
+		const u8 row_bytes = Cpu::screen_width / 8;
+
+		// Every pixel's left and right neighbour, the edges repeating themselves.
+		u64 Left(u64 row)
+		{
+				return row >> 1 | (row & leftmost);
+		}
+
+		u64 Right(u64 row)
+		{
+				return row << 1 | (row & 1);
+		}
+
+		u64 Equal(u64 a, u64 b)
+		{
+				return ~(a ^ b);
+		}
+
+		u64 Select(u64 condition, u64 a, u64 b)
+		{
+				return (condition & a) | (~condition & b);
+		}
+
+		u64 LoadRow(const u8 *bytes)
+		{
+				u64 row = 0;
+
+				for (u8 byte = 0; byte < row_bytes; ++byte)
+				{
+						row = row << 8 | bytes[byte];
+				}
+
+				return row;
+		}
+}
+
+Upscaler::Upscaler()
+		: m_off(0xFF000000),
+		m_on(0xFFFFFFFF),
+		m_filter(Filter::nearest),
+		m_scale(0)
+{
+		memset(m_spread, NULL, sizeof m_spread);
+}
+
+Upscaler::~Upscaler()
+{
+}
+
+void Upscaler::BuildSpread(Filter filter, u8 scale)
+{
+		u8 filter_scale = GetFilterScale(filter);
+		u8 copies = scale / filter_scale;
+
+		for (u8 column = 0; column < filter_scale; ++column)
+		{
+				for (u32 byte = 0; byte < 256; ++byte)
+				{
+						u64 bits = 0;
+
+						for (u8 pixel = 0; pixel < 8; ++pixel)
+						{
+								if (!((byte >> (7 - pixel)) & 1))
+										continue;
+
+								for (u8 copy = 0; copy < copies; ++copy)
+								{
+										bits |= leftmost >> (pixel * scale + column * copies + copy);
+								}
+						}
+
+						m_spread[column][byte] = bits;
+				}
+		}
+
+		m_filter = filter;
+		m_scale = scale;
+}
+
+void Upscaler::ExpandRow(const u8 *bits, u32 bytes, u32 *pixels)
+{
+		const __m128i high_masks = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+		const __m128i low_masks = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+		__m128i off = _mm_set1_epi32(static_cast<int>(m_off));
+		__m128i on = _mm_set1_epi32(static_cast<int>(m_on));
+
+		for (u32 byte = 0; byte < bytes; ++byte)
+		{
+				__m128i value = _mm_set1_epi32(bits[byte]);
+				__m128i high = _mm_cmpeq_epi32(_mm_and_si128(value, high_masks), high_masks);
+				__m128i low = _mm_cmpeq_epi32(_mm_and_si128(value, low_masks), low_masks);
+
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + byte * 8), _mm_or_si128(_mm_and_si128(high, on), _mm_andnot_si128(high, off)));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + byte * 8 + 4), _mm_or_si128(_mm_and_si128(low, on), _mm_andnot_si128(low, off)));
+		}
+}
+
+u8 Upscaler::GetFilterScale(Filter filter)
+{
+		switch (filter)
+		{
+		case Filter::nearest: return 1;
+		case Filter::scale2x: return 2;
+		case Filter::scale3x: return 3;
+		}
+
+		return 1;
+}
+
+bool Upscaler::Scale(const TripleBuffer::Frame &frame, Filter filter, u8 scale, u32 *pixels, u32 stride)
+{
+		u8 filter_scale = GetFilterScale(filter);
+
+		if (!scale || scale > max_scale || scale % filter_scale)
+				return false;
+
+		if (filter != m_filter || scale != m_scale)
+				BuildSpread(filter, scale);
+
+		u8 copies = scale / filter_scale;
+		u32 width = Cpu::screen_width * scale;
+		u8 bits[row_bytes * max_scale];
+		u64 columns[3][3];
+
+		for (u8 y = 0; y < Cpu::screen_height; ++y)
+		{
+				u64 e = LoadRow(frame.pixels[y]);
+				u64 b = LoadRow(frame.pixels[y ? y - 1 : y]);
+				u64 h = LoadRow(frame.pixels[y + 1 < Cpu::screen_height ? y + 1 : y]);
+				u64 d = Left(e);
+				u64 f = Right(e);
+
+				// Filtered rows for the 2x2 or 3x3 block of every pixel, named after
+				// the usual A B C / D E F / G H I neighbourhood.
+				if (filter == Filter::nearest)
+				{
+						columns[0][0] = e;
+				}
+				else
+				{
+						u64 guard = (b ^ h) & (d ^ f);
+						u64 db = guard & Equal(d, b);
+						u64 bf = guard & Equal(b, f);
+						u64 dh = guard & Equal(d, h);
+						u64 hf = guard & Equal(h, f);
+
+						if (filter == Filter::scale2x)
+						{
+								columns[0][0] = Select(db, d, e);
+								columns[0][1] = Select(bf, f, e);
+								columns[1][0] = Select(dh, d, e);
+								columns[1][1] = Select(hf, f, e);
+						}
+						else
+						{
+								u64 a = Left(b);
+								u64 c = Right(b);
+								u64 g = Left(h);
+								u64 i = Right(h);
+
+								columns[0][0] = Select(db, d, e);
+								columns[0][1] = Select((db & (e ^ c)) | (bf & (e ^ a)), b, e);
+								columns[0][2] = Select(bf, f, e);
+								columns[1][0] = Select((db & (e ^ g)) | (dh & (e ^ a)), d, e);
+								columns[1][1] = e;
+								columns[1][2] = Select((bf & (e ^ i)) | (hf & (e ^ c)), f, e);
+								columns[2][0] = Select(dh, d, e);
+								columns[2][1] = Select((dh & (e ^ i)) | (hf & (e ^ g)), h, e);
+								columns[2][2] = Select(hf, f, e);
+						}
+				}
+
+				for (u8 row = 0; row < filter_scale; ++row)
+				{
+						// Each source byte spreads to exactly scale output bytes.
+						for (u8 byte = 0; byte < row_bytes; ++byte)
+						{
+								u64 spread = 0;
+
+								for (u8 column = 0; column < filter_scale; ++column)
+								{
+										spread |= m_spread[column][(columns[row][column] >> (56 - byte * 8)) & 0xFF];
+								}
+
+								for (u8 output_byte = 0; output_byte < scale; ++output_byte)
+								{
+										bits[byte * scale + output_byte] = static_cast<u8>(spread >> (56 - output_byte * 8));
+								}
+						}
+
+						u32 *output_row = pixels + (y * scale + row * copies) * stride;
+
+						ExpandRow(bits, row_bytes * scale, output_row);
+
+						for (u8 copy = 1; copy < copies; ++copy)
+						{
+								memcpy(output_row + copy * stride, output_row, width * sizeof *output_row);
+						}
+				}
+		}
+
+		return true;
+}
+
+void Upscaler::SetColors(u32 off, u32 on)
+{
+		m_off = off;
+		m_on = on;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "TripleBuffer.h"
+
+// Scales TripleBuffer frames into 32-bit pixels in one pass. Scale2x (the
+// same rule as EPX) and Scale3x compare whole 64 pixel rows with bitwise
+// operations, the filtered bits are spread to the output width through
+// per byte tables and an SSE2 kernel turns every bit into a pixel. Any
+// multiple of a filter's own factor up to max_scale works, the extra factor
+// repeating the filtered pixels.
+class Upscaler
+{
+public:
+		static const u8 max_scale = 8;
+
+		enum class Filter
+				: u8
+		{
+				nearest,
+				scale2x,
+				scale3x
+		};
+
+		Upscaler();
+		~Upscaler();
+
+		static u8 GetFilterScale(Filter filter);
+
+		void SetColors(u32 off, u32 on);
+
+		// Writes Cpu::screen_width * scale by Cpu::screen_height * scale pixels,
+		// stride pixels apart from row to row. Fails when scale isn't a multiple
+		// of the filter's own factor or exceeds max_scale.
+		bool Scale(const TripleBuffer::Frame &frame, Filter filter, u8 scale, u32 *pixels, u32 stride);
+
+private:
+		u32 m_off;
+		u32 m_on;
+
+		// Output bits for every source byte of every filtered column, built for
+		// the filter and scale of the last call.
+		Filter m_filter;
+		u8 m_scale;
+		u64 m_spread[3][256];
+
+		void BuildSpread(Filter filter, u8 scale);
+		void ExpandRow(const u8 *bits, u32 bytes, u32 *pixels);
+};
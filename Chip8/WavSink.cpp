@@ -0,0 +1,96 @@
+#include "WavSink.h"
+
+namespace
+{
+		const u32 header_size = 44;
+
+		void WriteU16(std::ofstream &file, u16 value)
+		{
+				char bytes[] = { static_cast<char>(value & 0xFF), static_cast<char>(value >> 8) };
+
+				file.write(bytes, sizeof bytes);
+		}
+
+		void WriteU32(std::ofstream &file, u32 value)
+		{
+				WriteU16(file, value & 0xFFFF);
+				WriteU16(file, value >> 16);
+		}
+}
+
+WavSink::WavSink()
+		: m_samples(0)
+{
+}
+
+WavSink::~WavSink()
+{
+		Close();
+}
+
+bool WavSink::Close()
+{
+		if (!m_file.is_open())
+				return false;
+
+		// WAV sizes are 32 bits, so very long recordings keep playing back but
+		// report the largest length they can.
+		u32 data_size = m_samples < 0xFFFFFFFF - header_size ? static_cast<u32>(m_samples) : 0xFFFFFFFF - header_size;
+
+		m_file.seekp(4);
+		WriteU32(m_file, data_size + header_size - 8);
+		m_file.seekp(header_size - 4);
+		WriteU32(m_file, data_size);
+		m_file.close();
+
+		return !m_file.fail();
+}
+
+u64 WavSink::GetSamples()
+{
+		return m_samples;
+}
+
+bool WavSink::IsOpen()
+{
+		return m_file.is_open();
+}
+
+bool WavSink::Open(const std::string &file_name, u32 sample_rate)
+{
+		Close();
+		m_file.clear();
+		m_file.open(file_name, std::ios::binary | std::ios::trunc);
+		m_samples = 0;
+
+		if (!m_file)
+				return false;
+
+		m_file.write("RIFF", 4);
+		WriteU32(m_file, header_size - 8);
+		m_file.write("WAVE", 4);
+
+		// PCM, one channel, one byte per sample.
+		m_file.write("fmt ", 4);
+		WriteU32(m_file, 16);
+		WriteU16(m_file, 1);
+		WriteU16(m_file, 1);
+		WriteU32(m_file, sample_rate);
+		WriteU32(m_file, sample_rate);
+		WriteU16(m_file, 1);
+		WriteU16(m_file, 8);
+
+		m_file.write("data", 4);
+		WriteU32(m_file, 0);
+
+		return !m_file.fail();
+}
+
+void WavSink::Write(const u8 *samples, u32 count)
+{
+		if (!m_file.is_open())
+				return;
+
+		m_file.write(reinterpret_cast<const char *>(samples), count);
+		m_samples += count;
+}
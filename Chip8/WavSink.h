@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Cpu.h"
+#include <fstream>
+#include <string>
+
+// Writes unsigned 8-bit mono samples to a WAV file. The header goes out with
+// empty sizes when the file is opened and is patched when it is closed, so a
+// recording can run for as long as it likes without being held in memory.
+class WavSink
+{
+public:
+		WavSink();
+		~WavSink();
+
+		bool Open(const std::string &file_name, u32 sample_rate);
+		bool IsOpen();
+		void Write(const u8 *samples, u32 count);
+		bool Close();
+
+		u64 GetSamples();
+
+private:
+		std::ofstream m_file;
+		u64 m_samples;
+};
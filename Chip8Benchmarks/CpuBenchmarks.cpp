@@ -0,0 +1,321 @@
+#include <benchmark\benchmark.h>
+#include "../Chip8/BatchRunner.h"
+#include "../Chip8/CachedInterpreter.h"
+#include "../Chip8/JitCompiler.h"
+#include "../Chip8/LockstepCpu.h"
+#include "../Chip8/Profiler.h"
+#include "../Chip8/RewindBuffer.h"
+#include "../Chip8/TraceRecorder.h"
+#include "../Chip8/Upscaler.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+using DataRegisters = Cpu::DataRegisters;
+
+namespace
+{
+		// A tight counter loop that mixes arithmetic, a skip and a jump, which
+		// is representative of the inner loops most ROMs spend their time in.
+		const u8 counter_loop[] =
+		{
+				0x60, 0x00,		// 0x200 LD V0, 0x00
+				0x61, 0x01,		// 0x202 LD V1, 0x01
+				0x80, 0x14,		// 0x204 ADD V0, V1
+				0x72, 0x01,		// 0x206 ADD V2, 0x01
+				0x83, 0x03,		// 0x208 XOR V3, V0
+				0x32, 0x00,		// 0x20A SE V2, 0x00
+				0x12, 0x04,		// 0x20C JP 0x204
+				0xA3, 0x00,		// 0x20E LD I, 0x300
+				0xF3, 0x33,		// 0x210 LD B, V3
+				0x12, 0x04,		// 0x212 JP 0x204
+		};
+
+		// Waits for the delay timer and reloads it, the way most ROMs pace
+		// themselves, so nearly all of its cycles are spent polling.
+		const u8 delay_loop[] =
+		{
+				0x60, 0x02,		// 0x200 LD V0, 0x02
+				0xF0, 0x15,		// 0x202 LD DT, V0
+				0xF1, 0x07,		// 0x204 LD V1, DT
+				0x31, 0x00,		// 0x206 SE V1, 0x00
+				0x12, 0x04,		// 0x208 JP 0x204
+				0x72, 0x01,		// 0x20A ADD V2, 0x01
+				0x12, 0x00,		// 0x20C JP 0x200
+		};
+
+		// Walks a sprite across the screen, made of the runs CachedInterpreter
+		// fuses: two loads, LD I with DRW and a counter loop.
+		const u8 sprite_loop[] =
+		{
+				0x60, 0x00,		// 0x200 LD V0, 0x00
+				0x61, 0x00,		// 0x202 LD V1, 0x00
+				0xA3, 0x00,		// 0x204 LD I, 0x300
+				0xD0, 0x15,		// 0x206 DRW V0, V1, 5
+				0x70, 0x01,		// 0x208 ADD V0, 0x01
+				0x30, 0x40,		// 0x20A SE V0, 0x40
+				0x12, 0x04,		// 0x20C JP 0x204
+				0x71, 0x01,		// 0x20E ADD V1, 0x01
+				0x12, 0x00,		// 0x210 JP 0x200
+		};
+
+		const u32 cycles = 100000;
+		const u32 cycles_per_tick = 500;
+		const u32 batch_jobs = 0x40;
+}
+
+static void Cpu_Decode(benchmark::State &state)
+{
+		u16 opcode = 0;
+
+		for (auto _ : state)
+		{
+				benchmark::DoNotOptimize(Cpu::Decode(opcode++));
+		}
+
+		state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Cpu_Decode);
+
+static void Cpu_Run(benchmark::State &state)
+{
+		Cpu cpu;
+
+		cpu.SetQuirks(static_cast<Cpu::Quirks>(state.range(0)));
+		cpu.LoadProgram(counter_loop, sizeof counter_loop);
+
+		for (auto _ : state)
+		{
+				benchmark::DoNotOptimize(cpu.Run(cycles));
+		}
+
+		state.SetItemsProcessed(state.iterations() * cycles);
+}
+BENCHMARK(Cpu_Run)->Arg(Cpu::cosmac_vip_quirks)->Arg(Cpu::chip48_quirks);
+
+static void Cpu_Run_Profiler(benchmark::State &state)
+{
+		Cpu cpu;
+		Profiler profiler;
+
+		cpu.LoadProgram(counter_loop, sizeof counter_loop);
+
+		for (auto _ : state)
+		{
+				benchmark::DoNotOptimize(cpu.Run(cycles, profiler));
+		}
+
+		state.SetItemsProcessed(state.iterations() * cycles);
+}
+BENCHMARK(Cpu_Run_Profiler);
+
+// Traces to a file in the working directory, which is removed afterwards.
+static void Cpu_Run_Trace(benchmark::State &state)
+{
+		Cpu cpu;
+		TraceRecorder recorder;
+		const char *file_name = "Chip8Benchmarks.trace";
+
+		cpu.LoadProgram(counter_loop, sizeof counter_loop);
+		recorder.Open(file_name, state.range(0) != 0);
+
+		for (auto _ : state)
+		{
+				benchmark::DoNotOptimize(cpu.Run(cycles, recorder));
+		}
+
+		recorder.Close();
+		state.counters["bytes_per_instruction"] = static_cast<double>(recorder.GetBytesWritten()) / recorder.GetRecords();
+		std::remove(file_name);
+		state.SetItemsProcessed(state.iterations() * cycles);
+}
+BENCHMARK(Cpu_Run_Trace)->Arg(0)->Arg(1);
+
+static void Cpu_Run_DelayLoop(benchmark::State &state)
+{
+		Cpu cpu;
+
+		cpu.LoadProgram(delay_loop, sizeof delay_loop);
+		cpu.SetCyclesPerTick(cycles_per_tick);
+
+		for (auto _ : state)
+		{
+				benchmark::DoNotOptimize(cpu.Run(cycles));
+		}
+
+		state.SetItemsProcessed(state.iterations() * cycles);
+}
+BENCHMARK(Cpu_Run_DelayLoop);
+
+static void CachedInterpreter_Run(benchmark::State &state)
+{
+		Cpu cpu;
+		CachedInterpreter cached_interpreter(cpu);
+
+		cpu.LoadProgram(counter_loop, sizeof counter_loop);
+
+		for (auto _ : state)
+		{
+				benchmark::DoNotOptimize(cached_interpreter.Run(cycles));
+		}
+
+		state.SetItemsProcessed(state.iterations() * cycles);
+}
+BENCHMARK(CachedInterpreter_Run);
+
+static void CachedInterpreter_Run_Fusion(benchmark::State &state)
+{
+		Cpu cpu;
+		CachedInterpreter cached_interpreter(cpu);
+
+		cpu.LoadProgram(sprite_loop, sizeof sprite_loop);
+		cached_interpreter.SetFusion(state.range(0) != 0);
+
+		for (auto _ : state)
+		{
+				benchmark::DoNotOptimize(cached_interpreter.Run(cycles));
+		}
+
+		state.SetItemsProcessed(state.iterations() * cycles);
+}
+BENCHMARK(CachedInterpreter_Run_Fusion)->Arg(0)->Arg(1);
+
+static void JitCompiler_Run(benchmark::State &state)
+{
+		Cpu cpu;
+		JitCompiler jit_compiler(cpu);
+
+		cpu.LoadProgram(counter_loop, sizeof counter_loop);
+
+		for (auto _ : state)
+		{
+				benchmark::DoNotOptimize(jit_compiler.Run(cycles));
+		}
+
+		state.SetItemsProcessed(state.iterations() * cycles);
+}
+BENCHMARK(JitCompiler_Run);
+
+static void LockstepCpu_Run(benchmark::State &state)
+{
+		std::unique_ptr<LockstepCpu> lockstep_cpu(new LockstepCpu);
+
+		lockstep_cpu->LoadProgram(counter_loop, sizeof counter_loop);
+
+		for (auto _ : state)
+		{
+				benchmark::DoNotOptimize(lockstep_cpu->Run(cycles));
+		}
+
+		state.SetItemsProcessed(state.iterations() * LockstepCpu::lanes * cycles);
+}
+BENCHMARK(LockstepCpu_Run);
+
+static void Cpu_SaveState(benchmark::State &state)
+{
+		Cpu cpu;
+		Cpu::State cpu_state;
+
+		cpu.LoadProgram(counter_loop, sizeof counter_loop);
+
+		for (auto _ : state)
+		{
+				cpu.SaveState(cpu_state);
+				cpu.LoadState(cpu_state);
+				benchmark::DoNotOptimize(cpu_state);
+		}
+
+		state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Cpu_SaveState);
+
+static void RewindBuffer_Push(benchmark::State &state)
+{
+		Cpu cpu;
+		RewindBuffer rewind_buffer(60 * 60 * 5);
+
+		cpu.LoadProgram(counter_loop, sizeof counter_loop);
+
+		for (auto _ : state)
+		{
+				cpu.Run(1000);
+				rewind_buffer.Push(cpu);
+		}
+
+		state.counters["bytes"] = static_cast<double>(rewind_buffer.GetMemoryUsage());
+		state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(RewindBuffer_Push);
+
+static void RewindBuffer_GetState(benchmark::State &state)
+{
+		Cpu cpu;
+		RewindBuffer rewind_buffer(60 * 60);
+		Cpu::State cpu_state;
+		u32 frames_ago = 0;
+
+		cpu.LoadProgram(counter_loop, sizeof counter_loop);
+
+		for (u32 frame = 0; frame < 60 * 60; ++frame)
+		{
+				cpu.Run(1000);
+				rewind_buffer.Push(cpu);
+		}
+
+		for (auto _ : state)
+		{
+				rewind_buffer.GetState(frames_ago, cpu_state);
+				cpu.LoadState(cpu_state);
+				frames_ago = (frames_ago + 59) % rewind_buffer.GetLength();
+		}
+
+		state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(RewindBuffer_GetState);
+
+// Reports aggregate instructions per second while the batch is spread over
+// one to hardware_concurrency threads, so the scaling is visible directly.
+static void BatchRunner_Run(benchmark::State &state)
+{
+		BatchRunner batch_runner(static_cast<u32>(state.range(0)));
+		std::vector<BatchRunner::Job> jobs(batch_jobs, { counter_loop, sizeof counter_loop, {}, cycles });
+
+		for (auto _ : state)
+		{
+				benchmark::DoNotOptimize(batch_runner.Run(jobs));
+		}
+
+		state.SetItemsProcessed(state.iterations() * batch_jobs * cycles);
+}
+BENCHMARK(BatchRunner_Run)->RangeMultiplier(2)->Range(1, std::max(1U, std::thread::hardware_concurrency()))->UseRealTime();
+
+// Reports the time per frame for every filter at its own factor and at the
+// largest multiple of it, as (filter, scale) pairs.
+static void Upscaler_Scale(benchmark::State &state)
+{
+		Upscaler upscaler;
+		TripleBuffer::Frame frame;
+		Upscaler::Filter filter = static_cast<Upscaler::Filter>(state.range(0));
+		u8 scale = static_cast<u8>(state.range(1));
+		u32 stride = Cpu::screen_width * scale;
+		std::vector<u32> pixels(stride * Cpu::screen_height * scale);
+		u64 random = 0;
+
+		for (auto &row : frame.pixels)
+		{
+				for (auto &byte : row)
+				{
+						byte = Cpu::Pcg(random);
+				}
+		}
+
+		for (auto _ : state)
+		{
+				upscaler.Scale(frame, filter, scale, pixels.data(), stride);
+				benchmark::DoNotOptimize(pixels.data());
+		}
+
+		state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Upscaler_Scale)->Args({ 0, 1 })->Args({ 0, 2 })->Args({ 0, 4 })->Args({ 0, 8 })->Args({ 1, 2 })->Args({ 1, 8 })->Args({ 2, 3 })->Args({ 2, 6 });
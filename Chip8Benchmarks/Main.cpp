@@ -0,0 +1,32 @@
+#include <benchmark\benchmark.h>
+#include <cstring>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+		// Results are always written as JSON too, so runs can be kept and
+		// compared for regressions, unless another output file is asked for.
+		char out[] = "--benchmark_out=Chip8Benchmarks.json";
+		char out_format[] = "--benchmark_out_format=json";
+		std::vector<char *> arguments(argv, argv + argc);
+		bool has_out = false;
+
+		for (int argument = 1; argument < argc; ++argument)
+		{
+				has_out |= !strncmp(argv[argument], "--benchmark_out=", strlen("--benchmark_out="));
+		}
+
+		if (!has_out)
+		{
+				arguments.push_back(out);
+				arguments.push_back(out_format);
+		}
+
+		int argument_count = static_cast<int>(arguments.size());
+
+		arguments.push_back(nullptr);
+		benchmark::Initialize(&argument_count, arguments.data());
+		benchmark::RunSpecifiedBenchmarks();
+
+		return 0;
+}
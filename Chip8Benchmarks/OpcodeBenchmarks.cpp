@@ -0,0 +1,86 @@
+#include <benchmark\benchmark.h>
+#include "../Chip8/Cpu.h"
+
+using DataRegisters = Cpu::DataRegisters;
+
+namespace
+{
+		const auto no_setup = [](Cpu & /*cpu*/) {};
+}
+
+// Times a single Cpu opcode method called directly, without fetching or
+// dispatching, so a regression shows up against the instruction it is in.
+// The Cpu escapes once and memory is clobbered after every call, which keeps
+// the compiler from folding repeated calls together.
+template <typename Setup, typename Operation>
+static void Cpu_Opcode(benchmark::State &state, Setup setup, Operation operation)
+{
+		Cpu cpu;
+
+		setup(cpu);
+		benchmark::DoNotOptimize(&cpu);
+
+		for (auto _ : state)
+		{
+				operation(cpu);
+				benchmark::ClobberMemory();
+		}
+
+		state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_CAPTURE(Cpu_Opcode, ClearScreen, no_setup, [](Cpu &cpu) { cpu.ClearScreen(); });
+
+// Call and Return only make sense in pairs, or the stack runs over.
+BENCHMARK_CAPTURE(Cpu_Opcode, CallReturn, no_setup, [](Cpu &cpu) { cpu.Call(0x300); cpu.Return(); });
+BENCHMARK_CAPTURE(Cpu_Opcode, Jump, no_setup, [](Cpu &cpu) { cpu.Jump(0x300); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SkipEqualByte, no_setup, [](Cpu &cpu) { cpu.SkipEqualByte(DataRegisters::v0, 0x00); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SkipNotEqualByte, no_setup, [](Cpu &cpu) { cpu.SkipNotEqualByte(DataRegisters::v0, 0x01); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SkipEqualRegister, no_setup, [](Cpu &cpu) { cpu.SkipEqualRegister(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, StoreByte, no_setup, [](Cpu &cpu) { cpu.SetDataRegister(DataRegisters::v0, 0x12); });
+BENCHMARK_CAPTURE(Cpu_Opcode, AddByte, no_setup, [](Cpu &cpu) { cpu.AddByte(DataRegisters::v0, 0x01); });
+BENCHMARK_CAPTURE(Cpu_Opcode, StoreDataRegister, no_setup, [](Cpu &cpu) { cpu.StoreDataRegister(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, OrRegisters, no_setup, [](Cpu &cpu) { cpu.OrRegisters(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, AndRegisters, no_setup, [](Cpu &cpu) { cpu.AndRegisters(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, XorRegisters, no_setup, [](Cpu &cpu) { cpu.XorRegisters(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, AddRegisters, no_setup, [](Cpu &cpu) { cpu.AddRegisters(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SubtractRegister, no_setup, [](Cpu &cpu) { cpu.SubtractRegister(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, ShiftRegisterRight, no_setup, [](Cpu &cpu) { cpu.ShiftRegisterRight(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SubtractRegisters, no_setup, [](Cpu &cpu) { cpu.SubtractRegisters(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, ShiftRegisterLeft, no_setup, [](Cpu &cpu) { cpu.ShiftRegisterLeft(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SkipNotEqualRegister, no_setup, [](Cpu &cpu) { cpu.SkipNotEqualRegister(DataRegisters::v0, DataRegisters::v1); });
+BENCHMARK_CAPTURE(Cpu_Opcode, StoreAddress, no_setup, [](Cpu &cpu) { cpu.StoreAddress(0x300); });
+BENCHMARK_CAPTURE(Cpu_Opcode, JumpPlus, no_setup, [](Cpu &cpu) { cpu.JumpPlus(0x300); });
+BENCHMARK_CAPTURE(Cpu_Opcode, StoreRandomNumber, no_setup, [](Cpu &cpu) { cpu.StoreRandomNumber(DataRegisters::v0, 0xFF); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SkipKeyPressed, [](Cpu &cpu) { cpu.SetKey(0x0, true); }, [](Cpu &cpu) { cpu.SkipKeyPressed(DataRegisters::v0); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SkipKeyNotPressed, no_setup, [](Cpu &cpu) { cpu.SkipKeyNotPressed(DataRegisters::v0); });
+BENCHMARK_CAPTURE(Cpu_Opcode, StoreDelayTimer, [](Cpu &cpu) { cpu.SetCyclesPerTick(500); }, [](Cpu &cpu) { cpu.StoreDelayTimer(DataRegisters::v0); });
+BENCHMARK_CAPTURE(Cpu_Opcode, WaitKey, [](Cpu &cpu) { cpu.SetKey(0x5, true); }, [](Cpu &cpu) { cpu.WaitKey(DataRegisters::v0); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SetDelayTimer, no_setup, [](Cpu &cpu) { cpu.SetDelayTimer(DataRegisters::v0); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SetSoundTimer, no_setup, [](Cpu &cpu) { cpu.SetSoundTimer(DataRegisters::v0); });
+BENCHMARK_CAPTURE(Cpu_Opcode, AddIndex, no_setup, [](Cpu &cpu) { cpu.AddIndex(DataRegisters::v0); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SetTextCharacter, no_setup, [](Cpu &cpu) { cpu.SetTextCharacter(DataRegisters::v0); });
+
+// Instructions that write ram or move I along start from the same I every
+// time, so they stay on the same page.
+BENCHMARK_CAPTURE(Cpu_Opcode, StoreBinaryCodedDecimal, [](Cpu &cpu) { cpu.StoreAddress(0x300); }, [](Cpu &cpu) { cpu.StoreBinaryCodedDecimal(DataRegisters::v0); });
+BENCHMARK_CAPTURE(Cpu_Opcode, StoreDataRegisters, no_setup, [](Cpu &cpu) { cpu.StoreAddress(0x300); cpu.StoreDataRegisters(DataRegisters::vF); });
+BENCHMARK_CAPTURE(Cpu_Opcode, SetDataRegisters, no_setup, [](Cpu &cpu) { cpu.StoreAddress(0x300); cpu.SetDataRegisters(DataRegisters::vF); });
+
+// Sprites move along the diagonal, so every horizontal rotation is timed.
+static void Cpu_DrawSprite(benchmark::State &state)
+{
+		Cpu cpu;
+		u8 x = 0;
+
+		cpu.StoreAddress(0x000);
+
+		for (auto _ : state)
+		{
+				cpu.SetDataRegister(DataRegisters::v0, x++);
+				cpu.DrawSprite(DataRegisters::v0, DataRegisters::v0, Cpu::font_length);
+		}
+
+		state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Cpu_DrawSprite);
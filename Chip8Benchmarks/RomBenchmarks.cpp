@@ -0,0 +1,82 @@
+#include <benchmark\benchmark.h>
+#include "../Chip8/CachedInterpreter.h"
+#include "../Chip8/Disassembler.h"
+#include "../Chip8/JitCompiler.h"
+#include "Roms.h"
+
+namespace
+{
+		enum class Core
+				: u8
+		{
+				interpreter,
+				cached_interpreter,
+				jit_compiler
+		};
+
+		const char *const core_names[] = { "interpreter", "cached_interpreter", "jit_compiler" };
+		const u8 core_count = sizeof core_names / sizeof *core_names;
+
+		const u32 rom_cycles = 1000000;
+		const u32 rom_cycles_per_tick = 500;
+}
+
+// Runs every bundled ROM on every core for a fixed number of guest cycles
+// per iteration and reports guest MIPS, which is what regressions are
+// tracked by in the JSON output.
+static void Rom_Run(benchmark::State &state)
+{
+		const Roms::Rom &rom = Roms::roms[state.range(0)];
+		Core core = static_cast<Core>(state.range(1));
+		Cpu cpu;
+		CachedInterpreter cached_interpreter(cpu);
+		JitCompiler jit_compiler(cpu);
+
+		cpu.SetSeed(1);
+		cpu.SetCyclesPerTick(rom_cycles_per_tick);
+		cpu.LoadProgram(rom.program, rom.size);
+
+		for (auto _ : state)
+		{
+				switch (core)
+				{
+				case Core::interpreter: benchmark::DoNotOptimize(cpu.Run(rom_cycles)); break;
+				case Core::cached_interpreter: benchmark::DoNotOptimize(cached_interpreter.Run(rom_cycles)); break;
+				case Core::jit_compiler: benchmark::DoNotOptimize(jit_compiler.Run(rom_cycles)); break;
+				}
+		}
+
+		state.SetLabel(std::string(rom.name) + "/" + core_names[state.range(1)]);
+		state.SetItemsProcessed(state.iterations() * rom_cycles);
+		state.counters["MIPS"] = benchmark::Counter(static_cast<double>(state.iterations()) * rom_cycles / 1000000, benchmark::Counter::kIsRate);
+}
+
+static void RomArguments(benchmark::internal::Benchmark *benchmark)
+{
+		for (u8 rom = 0; rom < Roms::rom_count; ++rom)
+		{
+				for (u8 core = 0; core < core_count; ++core)
+				{
+						benchmark->Args({ rom, core });
+				}
+		}
+}
+BENCHMARK(Rom_Run)->Apply(RomArguments);
+
+// Recovers the control flow graph of every bundled ROM, which is what loading
+// a ROM with a prewarmed cache costs on top of reading it.
+static void Rom_Disassemble(benchmark::State &state)
+{
+		const Roms::Rom &rom = Roms::roms[state.range(0)];
+
+		for (auto _ : state)
+		{
+				Disassembler disassembler(rom.program, rom.size);
+
+				benchmark::DoNotOptimize(disassembler.GetBlocks().data());
+		}
+
+		state.SetLabel(rom.name);
+		state.SetBytesProcessed(state.iterations() * rom.size);
+}
+BENCHMARK(Rom_Disassemble)->DenseRange(0, Roms::rom_count - 1);
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "../Chip8/Cpu.h"
+
+// Small programs written for these benchmarks and free to use for anything,
+// each standing for a kind of work real ROMs spend their time on. They all
+// loop forever, so any cycle count can be run.
+namespace Roms
+{
+		struct Rom
+		{
+				const char *name;
+				const u8 *program;
+				u16 size;
+		};
+
+		// Draws a random maze of diagonals all over the screen, then starts over.
+		const u8 maze[] =
+		{
+				0xA2, 0x22,		// 0x200 LD I, 0x222
+				0xC2, 0x01,		// 0x202 RND V2, 0x01
+				0x32, 0x01,		// 0x204 SE V2, 0x01
+				0xA2, 0x1E,		// 0x206 LD I, 0x21E
+				0xD0, 0x14,		// 0x208 DRW V0, V1, 4
+				0x70, 0x04,		// 0x20A ADD V0, 0x04
+				0x30, 0x40,		// 0x20C SE V0, 0x40
+				0x12, 0x00,		// 0x20E JP 0x200
+				0x60, 0x00,		// 0x210 LD V0, 0x00
+				0x71, 0x04,		// 0x212 ADD V1, 0x04
+				0x31, 0x20,		// 0x214 SE V1, 0x20
+				0x12, 0x00,		// 0x216 JP 0x200
+				0x00, 0xE0,		// 0x218 CLS
+				0x61, 0x00,		// 0x21A LD V1, 0x00
+				0x12, 0x00,		// 0x21C JP 0x200
+				0x10, 0x20,		// 0x21E rising diagonal
+				0x40, 0x80,
+				0x80, 0x40,		// 0x222 falling diagonal
+				0x20, 0x10,
+		};
+
+		// Counts up and redraws the count in decimal every time, like a score.
+		const u8 score[] =
+		{
+				0x00, 0xE0,		// 0x200 CLS
+				0x73, 0x01,		// 0x202 ADD V3, 0x01
+				0xA3, 0x00,		// 0x204 LD I, 0x300
+				0xF3, 0x33,		// 0x206 LD B, V3
+				0xF2, 0x65,		// 0x208 LD V2, [I]
+				0x64, 0x00,		// 0x20A LD V4, 0x00
+				0x65, 0x00,		// 0x20C LD V5, 0x00
+				0xF0, 0x29,		// 0x20E LD F, V0
+				0xD4, 0x55,		// 0x210 DRW V4, V5, 5
+				0x74, 0x05,		// 0x212 ADD V4, 0x05
+				0xF1, 0x29,		// 0x214 LD F, V1
+				0xD4, 0x55,		// 0x216 DRW V4, V5, 5
+				0x74, 0x05,		// 0x218 ADD V4, 0x05
+				0xF2, 0x29,		// 0x21A LD F, V2
+				0xD4, 0x55,		// 0x21C DRW V4, V5, 5
+				0x12, 0x00,		// 0x21E JP 0x200
+		};
+
+		// Copies a page of data to another one block by block through the
+		// registers, the way levels and tables get unpacked.
+		const u8 copy[] =
+		{
+				0x66, 0x00,		// 0x200 LD V6, 0x00
+				0xA3, 0x00,		// 0x202 LD I, 0x300
+				0xF6, 0x1E,		// 0x204 ADD I, V6
+				0xFE, 0x65,		// 0x206 LD VE, [I]
+				0xA4, 0x00,		// 0x208 LD I, 0x400
+				0xF6, 0x1E,		// 0x20A ADD I, V6
+				0xFE, 0x55,		// 0x20C LD [I], VE
+				0x76, 0x10,		// 0x20E ADD V6, 0x10
+				0x36, 0x00,		// 0x210 SE V6, 0x00
+				0x12, 0x02,		// 0x212 JP 0x202
+				0x12, 0x00,		// 0x214 JP 0x200
+		};
+
+		// Moves a box one pixel a frame and waits for the delay timer in
+		// between, so most of its cycles are spent waiting.
+		const u8 paced[] =
+		{
+				0x60, 0x00,		// 0x200 LD V0, 0x00
+				0x61, 0x00,		// 0x202 LD V1, 0x00
+				0xA2, 0x1C,		// 0x204 LD I, 0x21C
+				0xD0, 0x18,		// 0x206 DRW V0, V1, 8
+				0x70, 0x01,		// 0x208 ADD V0, 0x01
+				0x71, 0x01,		// 0x20A ADD V1, 0x01
+				0xD0, 0x18,		// 0x20C DRW V0, V1, 8
+				0x62, 0x01,		// 0x20E LD V2, 0x01
+				0xF2, 0x15,		// 0x210 LD DT, V2
+				0xF3, 0x07,		// 0x212 LD V3, DT
+				0x33, 0x00,		// 0x214 SE V3, 0x00
+				0x12, 0x12,		// 0x216 JP 0x212
+				0x12, 0x06,		// 0x218 JP 0x206
+				0x00, 0x00,		// 0x21A
+				0xFF, 0x81,		// 0x21C box
+				0x81, 0x81,
+				0x81, 0x81,
+				0x81, 0xFF,
+		};
+
+		const Rom roms[] =
+		{
+				{ "maze", maze, sizeof maze },
+				{ "score", score, sizeof score },
+				{ "copy", copy, sizeof copy },
+				{ "paced", paced, sizeof paced },
+		};
+
+		const u8 rom_count = sizeof roms / sizeof *roms;
+}
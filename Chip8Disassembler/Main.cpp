@@ -0,0 +1,109 @@
+#include "../Chip8/Disassembler.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+namespace
+{
+		struct Summary
+		{
+				bool disassembled;
+				std::string message;
+		};
+
+		Summary DisassembleRom(const std::string &rom_name, Cpu::Quirks quirks)
+		{
+				std::ifstream rom_file(rom_name, std::ios::binary);
+
+				if (!rom_file)
+						return { false, "Unable to open " + rom_name };
+
+				std::vector<u8> rom((std::istreambuf_iterator<char>(rom_file)), std::istreambuf_iterator<char>());
+
+				if (rom.size() > Cpu::program_size)
+						return { false, rom_name + " is too large to be a Chip-8 program" };
+
+				Disassembler disassembler(rom.data(), static_cast<u16>(rom.size()), quirks);
+				std::string listing_name = rom_name + ".asm";
+				std::ofstream listing_file(listing_name);
+
+				if (!listing_file)
+						return { false, "Unable to create " + listing_name };
+
+				listing_file << disassembler.GetListing();
+
+				u32 data_bytes = 0;
+
+				for (const Disassembler::DataRegion &data_region : disassembler.GetDataRegions())
+				{
+						data_bytes += data_region.size;
+				}
+
+				return { true, rom_name + ": " + std::to_string(disassembler.GetBlocks().size()) + " blocks, " + std::to_string(disassembler.GetComputedJumps().size()) + " computed jumps, " + std::to_string(data_bytes) + " data bytes" };
+		}
+}
+
+int main(int argc, char *argv[])
+{
+		std::vector<std::string> rom_names;
+		Cpu::Quirks quirks = Cpu::cosmac_vip_quirks;
+
+		for (int argument = 1; argument < argc; ++argument)
+		{
+				std::string name = argv[argument];
+
+				if (name == "--chip48")
+						quirks = Cpu::chip48_quirks;
+				else
+						rom_names.push_back(name);
+		}
+
+		if (rom_names.empty())
+		{
+				std::cerr << "Usage: Chip8Disassembler [--chip48] <rom>..." << std::endl;
+				std::cerr << "Writes the listing of every rom next to it as <rom>.asm" << std::endl;
+				return 1;
+		}
+
+		// Every rom is independent, so workers take the next one until none
+		// are left, and the summaries are printed in order once all are done.
+		std::vector<Summary> summaries(rom_names.size());
+		std::atomic<size_t> next_rom(0);
+		u32 thread_count = static_cast<u32>(std::min<size_t>(std::max(1U, std::thread::hardware_concurrency()), rom_names.size()));
+		std::vector<std::thread> threads;
+		auto work = [&]()
+		{
+				for (size_t rom = next_rom++; rom < rom_names.size(); rom = next_rom++)
+				{
+						summaries[rom] = DisassembleRom(rom_names[rom], quirks);
+				}
+		};
+
+		for (u32 thread = 1; thread < thread_count; ++thread)
+		{
+				threads.emplace_back(work);
+		}
+
+		work();
+
+		for (auto &thread : threads)
+		{
+				thread.join();
+		}
+
+		int result = 0;
+
+		for (const Summary &summary : summaries)
+		{
+				(summary.disassembled ? std::cout : std::cerr) << summary.message << std::endl;
+
+				if (!summary.disassembled)
+						result = 1;
+		}
+
+		return result;
+}
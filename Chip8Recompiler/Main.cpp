@@ -0,0 +1,50 @@
+#include "../Chip8/StaticRecompiler.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+int main(int argc, char *argv[])
+{
+		if (argc < 3)
+		{
+				std::cerr << "Usage: Chip8Recompiler <rom> <output.cpp> [function name]" << std::endl;
+				return 1;
+		}
+
+		std::ifstream rom_file(argv[1], std::ios::binary);
+
+		if (!rom_file)
+		{
+				std::cerr << "Unable to open " << argv[1] << std::endl;
+				return 1;
+		}
+
+		std::vector<u8> rom((std::istreambuf_iterator<char>(rom_file)), std::istreambuf_iterator<char>());
+
+		if (rom.size() > Cpu::program_size)
+		{
+				std::cerr << argv[1] << " is too large to be a Chip-8 program" << std::endl;
+				return 1;
+		}
+
+		StaticRecompiler static_recompiler(rom.data(), static_cast<u16>(rom.size()));
+		std::string function_name = argc > 3 ? argv[3] : "RunProgram";
+		std::ofstream output_file(argv[2]);
+
+		if (!output_file)
+		{
+				std::cerr << "Unable to create " << argv[2] << std::endl;
+				return 1;
+		}
+
+		output_file << static_recompiler.Translate(function_name);
+
+		for (u16 address : static_recompiler.GetComputedJumps())
+		{
+				std::cerr << "Computed jump at 0x" << std::hex << address << " runs through the interpreter" << std::endl;
+		}
+
+		std::cout << "Translated " << static_recompiler.GetInstructionAddresses().size() << " instructions" << std::endl;
+
+		return 0;
+}
@@ -0,0 +1,111 @@
+#include <gtest\gtest.h>
+#include "../Chip8/AudioBuffer.h"
+#include <thread>
+
+TEST(AudioBuffer, Capacity)
+{
+		AudioBuffer audio_buffer(1000, 8000);
+
+		EXPECT_EQ(1024, audio_buffer.GetCapacity());
+		EXPECT_EQ(8000, audio_buffer.GetSampleRate());
+}
+
+TEST(AudioBuffer, Write_Full)
+{
+		AudioBuffer audio_buffer(4);
+		u8 samples[] = { 1, 2, 3, 4, 5, 6 };
+		u8 read[2];
+
+		EXPECT_EQ(4, audio_buffer.Write(samples, sizeof samples));
+		EXPECT_EQ(2, audio_buffer.GetDroppedSamples());
+		EXPECT_EQ(2, audio_buffer.Read(read, sizeof read));
+		EXPECT_EQ(2, audio_buffer.Write(samples + 4, 2));
+		EXPECT_EQ(4, audio_buffer.GetBuffered());
+}
+
+TEST(AudioBuffer, Read_Wraps)
+{
+		AudioBuffer audio_buffer(4);
+		u8 samples[] = { 1, 2, 3 };
+		u8 read[3];
+
+		audio_buffer.Write(samples, sizeof samples);
+		audio_buffer.Read(read, sizeof read);
+		audio_buffer.Write(samples, sizeof samples);
+		EXPECT_EQ(3, audio_buffer.Read(read, sizeof read));
+		EXPECT_EQ(1, read[0]);
+		EXPECT_EQ(2, read[1]);
+		EXPECT_EQ(3, read[2]);
+}
+
+TEST(AudioBuffer, Read_Underrun)
+{
+		AudioBuffer audio_buffer(16, 1000);
+		u8 samples[] = { 1, 2 };
+		u8 read[4];
+		u8 silence = AudioBuffer::silence;
+
+		audio_buffer.Write(samples, sizeof samples);
+		EXPECT_EQ(2, audio_buffer.Read(read, sizeof read));
+		EXPECT_EQ(2, read[1]);
+		EXPECT_EQ(silence, read[2]);
+		EXPECT_EQ(silence, read[3]);
+		EXPECT_DOUBLE_EQ(0.002, audio_buffer.GetLatency());
+		EXPECT_EQ(1, audio_buffer.GetUnderruns());
+
+		// Staying dry is the same underrun, running dry again is another.
+		EXPECT_EQ(0, audio_buffer.Read(read, sizeof read));
+		EXPECT_EQ(1, audio_buffer.GetUnderruns());
+		audio_buffer.Write(read, sizeof read);
+		audio_buffer.Read(read, sizeof read);
+		audio_buffer.Read(read, sizeof read);
+		EXPECT_EQ(2, audio_buffer.GetUnderruns());
+}
+
+TEST(AudioBuffer, Write_Threads)
+{
+		AudioBuffer audio_buffer(64);
+		const u32 samples = 100000;
+
+		std::thread producer([&]()
+		{
+				u32 written = 0;
+
+				while (written < samples)
+				{
+						u8 chunk[7];
+						u32 count = std::min<u32>(sizeof chunk, samples - written);
+
+						for (u32 sample = 0; sample < count; ++sample)
+						{
+								chunk[sample] = static_cast<u8>(written + sample);
+						}
+
+						u32 taken = audio_buffer.Write(chunk, count);
+
+						written += taken;
+
+						if (taken < count)
+								std::this_thread::yield();
+				}
+		});
+
+		u32 read = 0;
+
+		while (read < samples)
+		{
+				u8 sample;
+
+				if (!audio_buffer.GetBuffered())
+				{
+						std::this_thread::yield();
+						continue;
+				}
+
+				audio_buffer.Read(&sample, 1);
+				ASSERT_EQ(static_cast<u8>(read), sample);
+				++read;
+		}
+
+		producer.join();
+}
@@ -0,0 +1,41 @@
+#include <gtest\gtest.h>
+#include "../Chip8/AudioOutput.h"
+#include <thread>
+
+TEST(AudioOutput, Pull)
+{
+		AudioBuffer audio_buffer(64, 1000);
+		AudioOutput audio_output(audio_buffer, 8);
+		u8 samples[] = { 1, 2, 3 };
+		std::vector<u8> sunk;
+		u8 silence = AudioBuffer::silence;
+
+		audio_output.SetSink([&](const u8 *samples, u32 count) { sunk.insert(sunk.end(), samples, samples + count); });
+		audio_buffer.Write(samples, sizeof samples);
+		EXPECT_EQ(3, audio_output.Pull());
+		ASSERT_EQ(8, sunk.size());
+		EXPECT_EQ(3, sunk[2]);
+		EXPECT_EQ(silence, sunk[3]);
+		EXPECT_DOUBLE_EQ(0.011, audio_output.GetLatency());
+		EXPECT_EQ(1, audio_buffer.GetUnderruns());
+}
+
+TEST(AudioOutput, Start)
+{
+		AudioBuffer audio_buffer(64, 8000);
+		AudioOutput audio_output(audio_buffer, 80);
+
+		audio_output.Start();
+		EXPECT_TRUE(audio_output.IsRunning());
+
+		AudioOutput::Clock::time_point timeout = AudioOutput::Clock::now() + std::chrono::seconds(5);
+
+		while (!audio_buffer.GetUnderruns() && AudioOutput::Clock::now() < timeout)
+		{
+				std::this_thread::yield();
+		}
+
+		audio_output.Stop();
+		EXPECT_FALSE(audio_output.IsRunning());
+		EXPECT_EQ(1, audio_buffer.GetUnderruns());
+}
@@ -0,0 +1,108 @@
+#include <gtest\gtest.h>
+#include "../Chip8/BatchRunner.h"
+#include "../Chip8/TraceReader.h"
+#include <cstdio>
+
+using DataRegisters = Cpu::DataRegisters;
+
+namespace
+{
+		const u8 wait_for_key[] =
+		{
+				0x60, 0x05,		// 0x200 LD V0, 0x05
+				0xE0, 0x9E,		// 0x202 SKP V0
+				0x12, 0x02,		// 0x204 JP 0x202
+				0x61, 0x01,		// 0x206 LD V1, 0x01
+				0xD0, 0x05,		// 0x208 DRW V0, V0, 0x5
+				0x12, 0x0A,		// 0x20A JP 0x20A
+		};
+}
+
+TEST(BatchRunner, RunJob_MatchesCpu)
+{
+		Cpu cpu;
+		u8 program[] = { 0x60, 0x05, 0x71, 0x03, 0x81, 0x04, 0x30, 0x00, 0x12, 0x02, 0x12, 0x0A };
+		BatchRunner::Job job = { program, sizeof program, {}, 50 };
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Run(job.cycles);
+
+		BatchRunner::Result result = BatchRunner::RunJob(job);
+
+		EXPECT_EQ(true, result.loaded);
+		EXPECT_EQ(cpu.GetCycles(), result.cycles);
+		EXPECT_EQ(0, memcmp(cpu.GetDataRegisters(), result.data_registers, Cpu::data_registers));
+		EXPECT_EQ(cpu.GetProgramCounter(), result.program_counter);
+		EXPECT_EQ(Cpu::Fault::none, result.fault);
+}
+
+TEST(BatchRunner, RunJob_Input)
+{
+		BatchRunner::Job idle_job = { wait_for_key, sizeof wait_for_key, {}, 40 };
+		BatchRunner::Job pressed_job = { wait_for_key, sizeof wait_for_key, { { 10, 0x5, true } }, 40 };
+
+		BatchRunner::Result idle_result = BatchRunner::RunJob(idle_job);
+		BatchRunner::Result pressed_result = BatchRunner::RunJob(pressed_job);
+
+		EXPECT_EQ(0, idle_result.data_registers[0x1]);
+		EXPECT_EQ(1, pressed_result.data_registers[0x1]);
+		EXPECT_EQ(40, pressed_result.cycles);
+		EXPECT_NE(0, pressed_result.screen[0x05]);
+		EXPECT_NE(idle_result.hash, pressed_result.hash);
+}
+
+TEST(BatchRunner, RunJob_Trace)
+{
+		BatchRunner::Job job = { wait_for_key, sizeof wait_for_key, { { 10, 0x5, true } }, 40 };
+		TraceReader reader;
+		TraceReader::Record record;
+		u64 cycles = 0;
+
+		job.trace_file = "BatchRunnerTests.trace";
+
+		BatchRunner::Result result = BatchRunner::RunJob(job);
+
+		ASSERT_TRUE(reader.Open(job.trace_file));
+
+		while (reader.Next(record))
+		{
+				cycles += record.idle_cycles ? record.idle_cycles : 1;
+		}
+
+		reader.Close();
+		std::remove(job.trace_file.c_str());
+		EXPECT_EQ(result.cycles, cycles);
+		EXPECT_EQ(result.program_counter, record.address);
+		EXPECT_EQ(0, memcmp(result.data_registers, record.data_registers, Cpu::data_registers));
+}
+
+TEST(BatchRunner, Run_MatchesRunJob)
+{
+		BatchRunner batch_runner(4);
+		std::vector<BatchRunner::Job> jobs;
+
+		for (u32 job = 0; job < 100; ++job)
+		{
+				jobs.push_back({ wait_for_key, sizeof wait_for_key, { { job, 0x5, true } }, 20 + job });
+		}
+
+		std::vector<BatchRunner::Result> results = batch_runner.Run(jobs);
+
+		ASSERT_EQ(jobs.size(), results.size());
+
+		for (u32 job = 0; job < jobs.size(); ++job)
+		{
+				BatchRunner::Result expected_result = BatchRunner::RunJob(jobs[job]);
+
+				ASSERT_EQ(expected_result.hash, results[job].hash);
+				ASSERT_EQ(expected_result.cycles, results[job].cycles);
+		}
+}
+
+TEST(BatchRunner, Run_NoJobs)
+{
+		BatchRunner batch_runner;
+
+		EXPECT_LE(1, batch_runner.GetThreadCount());
+		EXPECT_EQ(true, batch_runner.Run({}).empty());
+}
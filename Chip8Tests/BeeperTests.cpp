@@ -0,0 +1,51 @@
+#include <gtest\gtest.h>
+#include "../Chip8/Beeper.h"
+#include <vector>
+
+TEST(Beeper, RunFrame_Silent)
+{
+		AudioBuffer audio_buffer(4096, 44100);
+		Beeper beeper;
+		std::vector<u8> samples(735);
+		u8 silence = AudioBuffer::silence;
+
+		EXPECT_EQ(735, beeper.RunFrame(false, audio_buffer));
+		audio_buffer.Read(samples.data(), static_cast<u32>(samples.size()));
+
+		for (u8 sample : samples)
+		{
+				ASSERT_EQ(silence, sample);
+		}
+}
+
+TEST(Beeper, RunFrame_Square)
+{
+		AudioBuffer audio_buffer(4096, 8000);
+		Beeper beeper(1000, 0x10);
+		u8 samples[8];
+
+		beeper.RunFrame(true, audio_buffer);
+		audio_buffer.Read(samples, sizeof samples);
+
+		for (u8 sample = 0; sample < sizeof samples; ++sample)
+		{
+				EXPECT_EQ(sample < 4 ? 0x90 : 0x70, samples[sample]);
+		}
+}
+
+TEST(Beeper, RunFrame_Fractions)
+{
+		AudioBuffer audio_buffer(4096, 1000);
+		Beeper beeper;
+		u32 samples = 0;
+
+		beeper.SetFrameRate(120.0);
+
+		for (u32 frame = 0; frame < 120; ++frame)
+		{
+				samples += beeper.RunFrame(true, audio_buffer);
+		}
+
+		EXPECT_EQ(1000, samples);
+		EXPECT_EQ(120.0, beeper.GetFrameRate());
+}
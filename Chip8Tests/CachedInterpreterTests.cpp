@@ -0,0 +1,223 @@
+#include <gtest\gtest.h>
+#include "../Chip8/CachedInterpreter.h"
+#include <algorithm>
+
+using DataRegisters = Cpu::DataRegisters;
+
+TEST(CachedInterpreter, Run_MatchesCpu)
+{
+		Cpu cpu;
+		Cpu cached_cpu;
+		CachedInterpreter cached_interpreter(cached_cpu);
+		u8 program[] = { 0x60, 0x05, 0x71, 0x03, 0x81, 0x04, 0x30, 0x00, 0x12, 0x02, 0x12, 0x0A };
+		u32 cycles = 50;
+
+		cpu.LoadProgram(program, sizeof program);
+		cached_cpu.LoadProgram(program, sizeof program);
+		EXPECT_EQ(cpu.Run(cycles), cached_interpreter.Run(cycles));
+		EXPECT_EQ(0, memcmp(cpu.GetDataRegisters(), cached_cpu.GetDataRegisters(), Cpu::data_registers));
+		EXPECT_EQ(cpu.GetProgramCounter(), cached_cpu.GetProgramCounter());
+}
+
+TEST(CachedInterpreter, Run_SelfModifyingCode)
+{
+		Cpu cpu;
+		CachedInterpreter cached_interpreter(cpu);
+		u8 program[] =
+		{
+				0x60, 0x64,		// LD V0, 100
+				0xA2, 0x06,		// LD I, 0x206
+				0xF0, 0x33,		// LD B, V0 - overwrites the next two instructions with 01 00 00
+				0x71, 0x05,		// ADD V1, 0x05
+				0x72, 0x07,		// ADD V2, 0x07
+				0x12, 0x0A,		// JP 0x20A
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		cached_interpreter.Run(11);
+		EXPECT_EQ(0, cpu.GetDataRegister(DataRegisters::v1));
+		EXPECT_EQ(0, cpu.GetDataRegister(DataRegisters::v2));
+		EXPECT_EQ(0x20A, cpu.GetProgramCounter());
+}
+
+TEST(CachedInterpreter, Run_ProgramLoadedAfterConstruction)
+{
+		Cpu cpu;
+		CachedInterpreter cached_interpreter(cpu);
+		u8 program[] = { 0x60, 0x12, 0x12, 0x02 };
+
+		cpu.LoadProgram(program, sizeof program);
+		cached_interpreter.Run(1);
+		EXPECT_EQ(0x12, cpu.GetDataRegister(DataRegisters::v0));
+}
+
+TEST(CachedInterpreter, Run_Quirks)
+{
+		Cpu cpu;
+		Cpu cached_cpu;
+		CachedInterpreter cached_interpreter(cached_cpu);
+		u8 program[] = { 0x60, 0x04, 0x61, 0x10, 0x80, 0x16, 0x12, 0x06 };
+		u32 cycles = 10;
+
+		cpu.SetQuirks(Cpu::chip48_quirks);
+		cpu.LoadProgram(program, sizeof program);
+		cached_cpu.LoadProgram(program, sizeof program);
+		cached_cpu.SetQuirks(Cpu::chip48_quirks);
+		EXPECT_EQ(cpu.Run(cycles), cached_interpreter.Run(cycles));
+		EXPECT_EQ(0x02, cached_cpu.GetDataRegister(DataRegisters::v0));
+		EXPECT_EQ(0, memcmp(cpu.GetDataRegisters(), cached_cpu.GetDataRegisters(), Cpu::data_registers));
+}
+
+TEST(CachedInterpreter, Run_FusionMatchesCpu)
+{
+		u8 program[] =
+		{
+				0x60, 0x00,		// 0x200 LD V0, 0x00
+				0x61, 0x00,		// 0x202 LD V1, 0x00
+				0x62, 0x03,		// 0x204 LD V2, 0x03
+				0xF2, 0x15,		// 0x206 LD DT, V2
+				0xA3, 0x00,		// 0x208 LD I, 0x300
+				0xD0, 0x15,		// 0x20A DRW V0, V1, 5
+				0x70, 0x01,		// 0x20C ADD V0, 0x01
+				0x30, 0x08,		// 0x20E SE V0, 0x08
+				0x12, 0x08,		// 0x210 JP 0x208
+				0x71, 0x01,		// 0x212 ADD V1, 0x01
+				0x31, 0x04,		// 0x214 SE V1, 0x04
+				0xF3, 0x07,		// 0x216 LD V3, DT
+				0x33, 0x00,		// 0x218 SE V3, 0x00
+				0x12, 0x16,		// 0x21A JP 0x216
+				0x12, 0x00,		// 0x21C JP 0x200
+		};
+
+		// Budgets that end in the middle of fused runs have to split them.
+		for (u32 cycles = 1; cycles < 60; ++cycles)
+		{
+				Cpu cpu;
+				Cpu cached_cpu;
+				CachedInterpreter cached_interpreter(cached_cpu);
+
+				cpu.SetCyclesPerTick(7);
+				cached_cpu.SetCyclesPerTick(7);
+				cpu.LoadProgram(program, sizeof program);
+				cached_cpu.LoadProgram(program, sizeof program);
+
+				for (u32 run = 0; run < 20; ++run)
+				{
+						ASSERT_EQ(cpu.Run(cycles), cached_interpreter.Run(cycles));
+						ASSERT_EQ(0, memcmp(cpu.GetDataRegisters(), cached_cpu.GetDataRegisters(), Cpu::data_registers));
+						ASSERT_EQ(0, memcmp(cpu.GetScreen(), cached_cpu.GetScreen(), sizeof(u64) * Cpu::screen_height));
+						ASSERT_EQ(cpu.GetProgramCounter(), cached_cpu.GetProgramCounter());
+						ASSERT_EQ(cpu.GetIndex(), cached_cpu.GetIndex());
+						ASSERT_EQ(cpu.GetCycles(), cached_cpu.GetCycles());
+				}
+		}
+}
+
+TEST(CachedInterpreter, GetFusionStats)
+{
+		Cpu cpu;
+		CachedInterpreter cached_interpreter(cpu);
+		u8 program[] =
+		{
+				0x60, 0x00,		// 0x200 LD V0, 0x00
+				0x61, 0x00,		// 0x202 LD V1, 0x00
+				0x70, 0x01,		// 0x204 ADD V0, 0x01
+				0x30, 0x03,		// 0x206 SE V0, 0x03
+				0x12, 0x04,		// 0x208 JP 0x204
+				0x12, 0x0A,		// 0x20A JP 0x20A
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		cached_interpreter.Run(11);
+
+		std::vector<CachedInterpreter::FusionStats> stats = cached_interpreter.GetFusionStats();
+		auto find = [&](CachedInterpreter::Fusion fusion) { return *std::find_if(stats.begin(), stats.end(), [&](const CachedInterpreter::FusionStats &entry) { return entry.fusion == fusion; }); };
+
+		// Two turns jump back and the third skips the jump.
+		EXPECT_EQ(1, find(CachedInterpreter::Fusion::store_byte_store_byte).fired);
+		EXPECT_EQ(1, find(CachedInterpreter::Fusion::store_byte_store_byte).saved);
+		EXPECT_EQ(3, find(CachedInterpreter::Fusion::add_byte_skip_equal_byte_jump).fired);
+		EXPECT_EQ(5, find(CachedInterpreter::Fusion::add_byte_skip_equal_byte_jump).saved);
+		EXPECT_EQ(0x20A, cpu.GetProgramCounter());
+		EXPECT_NE(std::string::npos, cached_interpreter.GetFusionReport().find("ADD Vx, kk; SE Vy, kk; JP nnn"));
+
+		cached_interpreter.ResetFusionStats();
+		EXPECT_EQ(0, cached_interpreter.GetFusionStats()[0].fired);
+}
+
+TEST(CachedInterpreter, SetFusion_Off)
+{
+		Cpu cpu;
+		CachedInterpreter cached_interpreter(cpu);
+		u8 program[] = { 0x60, 0x05, 0x61, 0x03, 0x12, 0x04 };
+
+		cpu.LoadProgram(program, sizeof program);
+		cached_interpreter.SetFusion(false);
+		cached_interpreter.Run(3);
+
+		for (const CachedInterpreter::FusionStats &stats : cached_interpreter.GetFusionStats())
+		{
+				EXPECT_EQ(0, stats.fired);
+		}
+
+		EXPECT_EQ(0x05, cpu.GetDataRegister(DataRegisters::v0));
+		EXPECT_EQ(0x03, cpu.GetDataRegister(DataRegisters::v1));
+}
+
+TEST(CachedInterpreter, Run_SelfModifyingFusion)
+{
+		Cpu cpu;
+		CachedInterpreter cached_interpreter(cpu);
+		u8 program[] =
+		{
+				0x60, 0x12,		// 0x200 LD V0, 0x12
+				0x61, 0x0A,		// 0x202 LD V1, 0x0A
+				0xA2, 0x0A,		// 0x204 LD I, 0x20A
+				0xF1, 0x55,		// 0x206 LD [I], V1 - turns the SE below into JP 0x20A
+				0x72, 0x01,		// 0x208 ADD V2, 0x01
+				0x32, 0x05,		// 0x20A SE V2, 0x05
+				0x12, 0x08,		// 0x20C JP 0x208
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		cached_interpreter.Run(20);
+		EXPECT_EQ(1, cpu.GetDataRegister(DataRegisters::v2));
+		EXPECT_EQ(0x20A, cpu.GetProgramCounter());
+}
+
+TEST(CachedInterpreter, Run_CodeWrittenBeforeItRuns)
+{
+		u8 program[] =
+		{
+				0x60, 0x64,		// 0x200 LD V0, 0x64
+				0x61, 0x2A,		// 0x202 LD V1, 0x2A
+				0x62, 0x12,		// 0x204 LD V2, 0x12
+				0x63, 0x0E,		// 0x206 LD V3, 0x0E
+				0xA2, 0x80,		// 0x208 LD I, 0x280
+				0xF3, 0x55,		// 0x20A LD [I], V3 - writes LD V4, 0x2A; JP 0x20E
+				0x12, 0x80,		// 0x20C JP 0x280
+				0x70, 0x01,		// 0x20E ADD V0, 0x01
+				0xF3, 0x55,		// 0x210 LD [I], V3 - moves the LD on to the next register
+				0x12, 0x80,		// 0x212 JP 0x280
+		};
+
+		// The page at 0x280 is written before anything runs from it, and again
+		// once it has.
+		for (u32 cycles = 1; cycles < 40; ++cycles)
+		{
+				Cpu cpu;
+				Cpu cached_cpu;
+				CachedInterpreter cached_interpreter(cached_cpu);
+
+				cpu.LoadProgram(program, sizeof program);
+				cached_cpu.LoadProgram(program, sizeof program);
+
+				for (u32 run = 0; run < 5; ++run)
+				{
+						ASSERT_EQ(cpu.Run(cycles), cached_interpreter.Run(cycles));
+						ASSERT_EQ(0, memcmp(cpu.GetDataRegisters(), cached_cpu.GetDataRegisters(), Cpu::data_registers));
+						ASSERT_EQ(cpu.GetProgramCounter(), cached_cpu.GetProgramCounter());
+						ASSERT_EQ(cpu.GetCycles(), cached_cpu.GetCycles());
+				}
+		}
+}
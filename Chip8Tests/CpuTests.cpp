@@ -8,11 +8,11 @@ using DataRegisters = Cpu::DataRegisters;
 TEST(Cpu, ClearScreen)
 {
 		Cpu cpu;
-		u8 expected_value[Cpu::screen_size] = { 0 };
+		u64 expected_value[Cpu::screen_height] = { 0 };
 		
 		cpu.ClearScreen();
 
-		EXPECT_EQ(0, memcmp(cpu.GetScreen(), expected_value, Cpu::screen_size));
+		EXPECT_EQ(0, memcmp(cpu.GetScreen(), expected_value, sizeof expected_value));
 }
 
 // Opcode 00EE
@@ -41,6 +41,19 @@ TEST(Cpu, Jump)
 		EXPECT_EQ(expected_value, cpu.GetProgramCounter());
 }
 
+// Opcode 00EE - Empty stack
+TEST(Cpu, Return_StackUnderflow)
+{
+		Cpu cpu;
+		u8 program[] = { 0x60, 0x01, 0x00, 0xEE };
+
+		cpu.LoadProgram(program, sizeof program);
+		EXPECT_EQ(2, cpu.Run(10));
+		EXPECT_EQ(Cpu::Fault::stack_underflow, cpu.GetFault());
+		EXPECT_EQ(0x202, cpu.GetProgramCounter());
+		EXPECT_EQ(0, cpu.GetStackPointer());
+}
+
 // Opcode 2NNN
 TEST(Cpu, Call)
 {
@@ -54,6 +67,22 @@ TEST(Cpu, Call)
 		EXPECT_EQ(program_counter, cpu.GetStack());
 }
 
+// Opcode 2NNN - Full stack
+TEST(Cpu, Call_StackOverflow)
+{
+		Cpu cpu;
+		u8 program[] = { 0x22, 0x00 };
+		u8 stack_entries = Cpu::stack_entries;
+		u32 cycles = stack_entries + 1;
+
+		cpu.LoadProgram(program, sizeof program);
+		EXPECT_EQ(cycles, cpu.Run(100));
+		EXPECT_EQ(Cpu::Fault::stack_overflow, cpu.GetFault());
+		EXPECT_EQ(0x200, cpu.GetProgramCounter());
+		EXPECT_EQ(stack_entries, cpu.GetStackPointer());
+		EXPECT_EQ(0x202, cpu.GetStack());
+}
+
 // Opcode 3XNN - Values Match
 TEST(Cpu, SkipEqualByte_ValuesMatch)
 {
@@ -310,6 +339,21 @@ TEST(Cpu, ShiftRegisterRight_LSB_Zero)
 		EXPECT_EQ(0, cpu.GetDataRegister(DataRegisters::vF));
 }
 
+// Opcode 8XY6 - CHIP-48 shifts VX in place
+TEST(Cpu, ShiftRegisterRight_Chip48)
+{
+		Cpu cpu;
+		DataRegisters data_register_x = DataRegisters::v0;
+		DataRegisters data_register_y = DataRegisters::v1;
+
+		cpu.SetQuirks(Cpu::chip48_quirks);
+		cpu.SetDataRegister(data_register_x, 0x05);
+		cpu.SetDataRegister(data_register_y, 0x40);
+		cpu.ShiftRegisterRight(data_register_x, data_register_y);
+		EXPECT_EQ(0x02, cpu.GetDataRegister(data_register_x));
+		EXPECT_EQ(1, cpu.GetDataRegister(DataRegisters::vF));
+}
+
 // Opcode 8XY6 - Least significant bit is one
 TEST(Cpu, ShiftRegisterRight_LSB_One)
 {
@@ -395,6 +439,21 @@ TEST(Cpu, ShiftRegisterLeft_MSB_0)
 		EXPECT_EQ(0, cpu.GetDataRegister(DataRegisters::vF));
 }
 
+// Opcode 8XYE - CHIP-48 shifts VX in place
+TEST(Cpu, ShiftRegisterLeft_Chip48)
+{
+		Cpu cpu;
+		DataRegisters data_register_x = DataRegisters::v0;
+		DataRegisters data_register_y = DataRegisters::v1;
+
+		cpu.SetQuirks(Cpu::chip48_quirks);
+		cpu.SetDataRegister(data_register_x, 0x81);
+		cpu.SetDataRegister(data_register_y, 0x01);
+		cpu.ShiftRegisterLeft(data_register_x, data_register_y);
+		EXPECT_EQ(0x02, cpu.GetDataRegister(data_register_x));
+		EXPECT_EQ(1, cpu.GetDataRegister(DataRegisters::vF));
+}
+
 // Opcode 9XY0 - Values match
 TEST(Cpu, SkipNotEqualRegister_ValuesMatch)
 {
@@ -452,6 +511,139 @@ TEST(Cpu, JumpPlus)
 		EXPECT_EQ(expected_value, cpu.GetProgramCounter());
 }
 
+// Opcode BXNN - CHIP-48 adds VX and wraps the target
+TEST(Cpu, JumpPlus_Chip48)
+{
+		Cpu cpu;
+
+		cpu.SetQuirks(Cpu::chip48_quirks);
+		cpu.SetDataRegister(DataRegisters::v0, 0x01);
+		cpu.SetDataRegister(DataRegisters::vF, 0x10);
+		cpu.JumpPlus(0xFF8);
+		EXPECT_EQ(0x008, cpu.GetProgramCounter());
+}
+
+// Opcode CXNN - Same seed, same numbers
+TEST(Cpu, StoreRandomNumber_Seed)
+{
+		Cpu cpu;
+		Cpu seeded_cpu;
+		DataRegisters data_register = DataRegisters::v0;
+
+		cpu.SetSeed(0x1234);
+		seeded_cpu.SetSeed(0x1234);
+
+		for (u8 number = 0; number < 0x10; ++number)
+		{
+				cpu.StoreRandomNumber(data_register, 0xFF);
+				seeded_cpu.StoreRandomNumber(data_register, 0xFF);
+				ASSERT_EQ(cpu.GetDataRegister(data_register), seeded_cpu.GetDataRegister(data_register));
+		}
+}
+
+// Opcode CXNN - Mask
+TEST(Cpu, StoreRandomNumber_Mask)
+{
+		Cpu cpu;
+		DataRegisters data_register = DataRegisters::v0;
+		u8 mask = 0x0A;
+
+		for (u8 number = 0; number < 0x40; ++number)
+		{
+				cpu.StoreRandomNumber(data_register, mask);
+				ASSERT_EQ(0, cpu.GetDataRegister(data_register) & ~mask);
+		}
+}
+
+// Opcode CXNN - Generator
+TEST(Cpu, StoreRandomNumber_Generator)
+{
+		Cpu cpu;
+		DataRegisters data_register = DataRegisters::v0;
+		u64 state = 0x1234;
+		u8 expected_value = Cpu::Xorshift(state);
+
+		cpu.SetRandomGenerator(&Cpu::Xorshift);
+		cpu.SetSeed(0x1234);
+		cpu.StoreRandomNumber(data_register, 0xFF);
+		EXPECT_EQ(expected_value, cpu.GetDataRegister(data_register));
+}
+
+// Opcode DXYN - Pixels don't collide
+TEST(Cpu, DrawSprite_NoCollision)
+{
+		Cpu cpu;
+		DataRegisters data_register_x = DataRegisters::v0;
+		DataRegisters data_register_y = DataRegisters::v1;
+		u8 x = 0x3E;
+		u8 y = 0x01;
+
+		cpu.SetDataRegister(data_register_x, x);
+		cpu.SetDataRegister(data_register_y, y);
+		cpu.StoreAddress(0x000);
+		cpu.DrawSprite(data_register_x, data_register_y, Cpu::font_length);
+		EXPECT_EQ(0xC000000000000003, cpu.GetScreen()[y]);
+		EXPECT_EQ(0x4000000000000002, cpu.GetScreen()[y + 1]);
+		EXPECT_EQ(true, cpu.GetPixel(x, y));
+		EXPECT_EQ(true, cpu.GetPixel(x + 1, y));
+		EXPECT_EQ(true, cpu.GetPixel(0, y));
+		EXPECT_EQ(true, cpu.GetPixel(1, y));
+		EXPECT_EQ(false, cpu.GetPixel(2, y));
+		EXPECT_EQ(0, cpu.GetDataRegister(DataRegisters::vF));
+}
+
+// Opcode DXYN - Pixels collide
+TEST(Cpu, DrawSprite_Collision)
+{
+		Cpu cpu;
+		DataRegisters data_register_x = DataRegisters::v0;
+		DataRegisters data_register_y = DataRegisters::v1;
+		u64 expected_value[Cpu::screen_height] = { 0 };
+
+		cpu.SetDataRegister(data_register_x, 0x10);
+		cpu.SetDataRegister(data_register_y, 0x1E);
+		cpu.StoreAddress(0x000);
+		cpu.DrawSprite(data_register_x, data_register_y, Cpu::font_length);
+		cpu.DrawSprite(data_register_x, data_register_y, Cpu::font_length);
+		EXPECT_EQ(0, memcmp(cpu.GetScreen(), expected_value, sizeof expected_value));
+		EXPECT_EQ(1, cpu.GetDataRegister(DataRegisters::vF));
+}
+
+// Opcode EX9E
+TEST(Cpu, SkipKeyPressed)
+{
+		Cpu cpu;
+		DataRegisters data_register = DataRegisters::v0;
+		u8 key = 0x0A;
+		u16 program_start = Cpu::program_start;
+		u16 expected_value = program_start + 2;
+
+		cpu.SetDataRegister(data_register, key);
+		cpu.SkipKeyPressed(data_register);
+		EXPECT_EQ(program_start, cpu.GetProgramCounter());
+		cpu.SetKey(key, true);
+		cpu.SkipKeyPressed(data_register);
+		EXPECT_EQ(expected_value, cpu.GetProgramCounter());
+}
+
+// Opcode EXA1
+TEST(Cpu, SkipKeyNotPressed)
+{
+		Cpu cpu;
+		DataRegisters data_register = DataRegisters::v0;
+		u8 key = 0x0A;
+		u16 program_start = Cpu::program_start;
+		u16 expected_value = program_start + 2;
+
+		cpu.SetDataRegister(data_register, key);
+		cpu.SetKey(key, true);
+		cpu.SkipKeyNotPressed(data_register);
+		EXPECT_EQ(program_start, cpu.GetProgramCounter());
+		cpu.SetKey(key, false);
+		cpu.SkipKeyNotPressed(data_register);
+		EXPECT_EQ(expected_value, cpu.GetProgramCounter());
+}
+
 // Opcode FX07
 TEST(Cpu, StoreDelayTimer)
 {
@@ -466,6 +658,24 @@ TEST(Cpu, StoreDelayTimer)
 		EXPECT_EQ(delay_timer, cpu.GetDataRegister(data_register_y));
 }
 
+// Opcode FX0A
+TEST(Cpu, WaitKey)
+{
+		Cpu cpu;
+		DataRegisters data_register = DataRegisters::v0;
+		u16 program_start = Cpu::program_start;
+
+		cpu.Jump(program_start + 2);
+		cpu.WaitKey(data_register);
+		EXPECT_EQ(program_start, cpu.GetProgramCounter());
+		cpu.SetKey(0x0B, true);
+		cpu.SetKey(0x05, true);
+		cpu.Jump(program_start + 2);
+		cpu.WaitKey(data_register);
+		EXPECT_EQ(program_start + 2, cpu.GetProgramCounter());
+		EXPECT_EQ(0x05, cpu.GetDataRegister(data_register));
+}
+
 // Opcode FX15
 TEST(Cpu, SetDelayTimer)
 {
@@ -566,6 +776,30 @@ TEST(Cpu, StoreDataRegisters)
 		}
 }
 
+// Opcode FX55 - CHIP-48 leaves I alone
+TEST(Cpu, StoreDataRegisters_Chip48)
+{
+		Cpu cpu;
+		const u8 *ram = cpu.GetRam();
+		u16 address = 0x300;
+
+		cpu.SetQuirks(Cpu::chip48_quirks);
+		cpu.SetDataRegister(DataRegisters::v0, 0x12);
+		cpu.SetDataRegister(DataRegisters::v1, 0x34);
+		cpu.StoreAddress(address);
+		cpu.StoreDataRegisters(DataRegisters::v1);
+		EXPECT_EQ(address, cpu.GetIndex());
+		EXPECT_EQ(0x12, ram[address]);
+		EXPECT_EQ(0x34, ram[address + 1]);
+
+		cpu.SetDataRegister(DataRegisters::v0, 0x00);
+		cpu.SetDataRegister(DataRegisters::v1, 0x00);
+		cpu.SetDataRegisters(DataRegisters::v1);
+		EXPECT_EQ(address, cpu.GetIndex());
+		EXPECT_EQ(0x12, cpu.GetDataRegister(DataRegisters::v0));
+		EXPECT_EQ(0x34, cpu.GetDataRegister(DataRegisters::v1));
+}
+
 // Opcode FX65
 TEST(Cpu, SetRegisters)
 {
@@ -609,4 +843,354 @@ TEST(Cpu, SetRegisters)
 				ASSERT_EQ(expected_address, cpu.GetIndex());
 				ASSERT_EQ(true, std::equal(expected_data_register_values.begin(), expected_data_register_values.end(), data_register_values.begin()));
 		}
-}
\ No newline at end of file
+}
+
+// Every quirks combination decodes to its own specialised handler
+TEST(Cpu, Decode_Quirks)
+{
+		u16 opcode = 0x8126;
+		Cpu::Instruction vip = Cpu::Decode(opcode, Cpu::cosmac_vip_quirks);
+		Cpu::Instruction chip48 = Cpu::Decode(opcode, Cpu::chip48_quirks);
+		Cpu::Instruction add = Cpu::Decode(0x8124, Cpu::chip48_quirks);
+
+		EXPECT_NE(vip.handler, chip48.handler);
+		EXPECT_EQ(add.handler, Cpu::Decode(0x8124).handler);
+		EXPECT_EQ(vip.handler, Cpu::Decode(opcode).handler);
+}
+
+TEST(Cpu, GetOperation)
+{
+		EXPECT_EQ(Cpu::Operation::clear_screen, Cpu::GetOperation(0x00E0));
+		EXPECT_EQ(Cpu::Operation::machine_routine, Cpu::GetOperation(0x0123));
+		EXPECT_EQ(Cpu::Operation::shift_register_left, Cpu::GetOperation(0x812E));
+		EXPECT_EQ(Cpu::Operation::invalid, Cpu::GetOperation(0x5121));
+		EXPECT_EQ(Cpu::Operation::set_data_registers, Cpu::GetOperation(0xF365));
+		EXPECT_STREQ("SetDataRegisters", Cpu::GetOperationName(0xF365));
+}
+
+// The quirks of a Cpu pick the handlers Step runs
+TEST(Cpu, Step_Quirks)
+{
+		Cpu cpu;
+		u8 program[] =
+		{
+				0x60, 0x04,		// 0x200 LD V0, 0x04
+				0x61, 0x10,		// 0x202 LD V1, 0x10
+				0x80, 0x16,		// 0x204 SHR V0, V1
+		};
+
+		Cpu::Quirks quirks = Cpu::chip48_quirks;
+
+		cpu.SetQuirks(quirks);
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Run(3);
+		EXPECT_EQ(0x02, cpu.GetDataRegister(DataRegisters::v0));
+		EXPECT_EQ(quirks, cpu.GetQuirks());
+}
+
+TEST(Cpu, SetCyclesPerTick)
+{
+		Cpu cpu;
+		DataRegisters data_register = DataRegisters::v0;
+
+		cpu.SetDataRegister(data_register, 0x01);
+		cpu.SetDelayTimer(data_register);
+		cpu.SetDataRegister(data_register, 0x03);
+		cpu.SetSoundTimer(data_register);
+		cpu.AddCycles(100);
+		EXPECT_EQ(1, cpu.GetDelayTimer());
+		EXPECT_EQ(3, cpu.GetSoundTimer());
+		cpu.SetCyclesPerTick(10);
+		cpu.AddCycles(15);
+		EXPECT_EQ(0, cpu.GetDelayTimer());
+		EXPECT_EQ(2, cpu.GetSoundTimer());
+		cpu.SetCyclesPerTick(5);
+		cpu.AddCycles(5);
+		EXPECT_EQ(1, cpu.GetSoundTimer());
+		cpu.AddCycles(1000);
+		EXPECT_EQ(0, cpu.GetDelayTimer());
+		EXPECT_EQ(0, cpu.GetSoundTimer());
+}
+
+TEST(Cpu, StoreDelayTimer_CountsDown)
+{
+		Cpu cpu;
+		u8 program[] =
+		{
+				0x60, 0x05,		// 0x200 LD V0, 0x05
+				0xF0, 0x15,		// 0x202 LD DT, V0
+				0xF1, 0x07,		// 0x204 LD V1, DT
+				0x31, 0x00,		// 0x206 SE V1, 0x00
+				0x12, 0x04,		// 0x208 JP 0x204
+				0x12, 0x0A,		// 0x20A JP 0x20A
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.SetCyclesPerTick(10);
+		cpu.Run(1000);
+		EXPECT_EQ(0x20A, cpu.GetProgramCounter());
+		EXPECT_EQ(0, cpu.GetDelayTimer());
+}
+
+TEST(Cpu, SkipIdleLoop_DelayTimer)
+{
+		Cpu cpu;
+		Cpu stepped_cpu;
+		u8 program[] =
+		{
+				0x60, 0x05,		// 0x200 LD V0, 0x05
+				0xF0, 0x15,		// 0x202 LD DT, V0
+				0xF1, 0x07,		// 0x204 LD V1, DT
+				0x31, 0x00,		// 0x206 SE V1, 0x00
+				0x12, 0x04,		// 0x208 JP 0x204
+				0x72, 0x01,		// 0x20A ADD V2, 0x01
+				0x12, 0x00,		// 0x20C JP 0x200
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.SetCyclesPerTick(7);
+		stepped_cpu.LoadProgram(program, sizeof program);
+		stepped_cpu.SetCyclesPerTick(7);
+		cpu.Run(5);
+		EXPECT_LT(0, cpu.SkipIdleLoop(1000));
+
+		for (u32 cycles = 1; cycles < 500; cycles += 13)
+		{
+				cpu.Run(cycles);
+
+				for (u64 cycle = stepped_cpu.GetCycles(); cycle < cpu.GetCycles(); ++cycle)
+				{
+						stepped_cpu.Step();
+				}
+
+				ASSERT_EQ(0, memcmp(stepped_cpu.GetDataRegisters(), cpu.GetDataRegisters(), Cpu::data_registers));
+				ASSERT_EQ(stepped_cpu.GetProgramCounter(), cpu.GetProgramCounter());
+				ASSERT_EQ(stepped_cpu.GetDelayTimer(), cpu.GetDelayTimer());
+		}
+}
+
+TEST(Cpu, SkipIdleLoop_Key)
+{
+		Cpu cpu;
+		u8 key = 0x0A;
+		u8 program[] =
+		{
+				0x60, 0x0A,		// 0x200 LD V0, 0x0A
+				0xE0, 0x9E,		// 0x202 SKP V0
+				0x12, 0x02,		// 0x204 JP 0x202
+				0x71, 0x01,		// 0x206 ADD V1, 0x01
+				0x12, 0x06,		// 0x208 JP 0x206
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Run(1);
+		EXPECT_EQ(998, cpu.SkipIdleLoop(999));
+		EXPECT_EQ(999, cpu.GetCycles());
+		EXPECT_EQ(0x202, cpu.GetProgramCounter());
+		cpu.SetKey(key, true);
+		EXPECT_EQ(0, cpu.SkipIdleLoop(1000));
+		cpu.Run(3);
+		EXPECT_EQ(1, cpu.GetDataRegister(DataRegisters::v1));
+}
+
+TEST(Cpu, SkipIdleLoop_WaitKey)
+{
+		Cpu cpu;
+		u8 program[] =
+		{
+				0x70, 0x01,		// 0x200 ADD V0, 0x01
+				0xF1, 0x0A,		// 0x202 LD V1, K
+				0x72, 0x01,		// 0x204 ADD V2, 0x01
+				0x12, 0x04,		// 0x206 JP 0x204
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		EXPECT_FALSE(cpu.IsWaitingForKey());
+		EXPECT_EQ(1000, cpu.Run(1000));
+		EXPECT_TRUE(cpu.IsWaitingForKey());
+		EXPECT_EQ(0x202, cpu.GetProgramCounter());
+		EXPECT_EQ(1, cpu.GetDataRegister(DataRegisters::v0));
+		cpu.SetKey(0x07, true);
+		EXPECT_FALSE(cpu.IsWaitingForKey());
+		EXPECT_EQ(0, cpu.SkipIdleLoop(1000));
+		cpu.Run(2);
+		EXPECT_EQ(0x07, cpu.GetDataRegister(DataRegisters::v1));
+		EXPECT_EQ(1, cpu.GetDataRegister(DataRegisters::v2));
+}
+
+TEST(Cpu, SkipIdleLoop_Jump)
+{
+		Cpu cpu;
+		u8 program[] =
+		{
+				0x70, 0x01,		// 0x200 ADD V0, 0x01
+				0x12, 0x02,		// 0x202 JP 0x202
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		EXPECT_EQ(0, cpu.SkipIdleLoop(1000));
+		EXPECT_EQ(1000000, cpu.Run(1000000));
+		EXPECT_EQ(1000000, cpu.GetCycles());
+		EXPECT_EQ(1, cpu.GetDataRegister(DataRegisters::v0));
+}
+
+TEST(Cpu, UnpackScreen)
+{
+		Cpu cpu;
+		DataRegisters data_register = DataRegisters::v0;
+		u8 pixels[Cpu::screen_size];
+
+		cpu.SetDataRegister(data_register, 0x3F);
+		cpu.StoreAddress(0x000);
+		cpu.DrawSprite(data_register, data_register, 1);
+		cpu.UnpackScreen(pixels);
+
+		for (u8 y = 0; y < Cpu::screen_height; ++y)
+		{
+				for (u8 x = 0; x < Cpu::screen_width; ++x)
+				{
+						ASSERT_EQ(cpu.GetPixel(x, y), pixels[y * Cpu::screen_width + x]);
+				}
+		}
+
+		EXPECT_EQ(1, pixels[0x1F * Cpu::screen_width + 0x3F]);
+		EXPECT_EQ(1, pixels[0x1F * Cpu::screen_width + 0x02]);
+		EXPECT_EQ(0, pixels[0x1F * Cpu::screen_width + 0x03]);
+}
+
+TEST(Cpu, PublishFrame)
+{
+		Cpu cpu;
+		DataRegisters data_register_x = DataRegisters::v0;
+		DataRegisters data_register_y = DataRegisters::v1;
+		u64 screen[Cpu::screen_height] = { 0 };
+
+		EXPECT_EQ(0xFFFFFFFF, cpu.PublishFrame(screen));
+		EXPECT_EQ(0, cpu.PublishFrame(screen));
+
+		cpu.SetDataRegister(data_register_x, 0x00);
+		cpu.SetDataRegister(data_register_y, 0x1E);
+		cpu.StoreAddress(0x000);
+		cpu.DrawSprite(data_register_x, data_register_y, Cpu::font_length);
+		EXPECT_EQ(0xC0000007, cpu.GetDirtyRows());
+		EXPECT_EQ(0xC0000007, cpu.PublishFrame(screen));
+		EXPECT_EQ(0, memcmp(cpu.GetScreen(), screen, sizeof screen));
+		EXPECT_EQ(0, cpu.GetDirtyRows());
+
+		screen[0x05] = 0xFF;
+		cpu.ClearScreen();
+		EXPECT_EQ(0xC0000007, cpu.PublishFrame(screen));
+		EXPECT_EQ(0xFF, screen[0x05]);
+		EXPECT_EQ(0, screen[0x1E]);
+		EXPECT_EQ(0, screen[0x00]);
+}
+
+TEST(Cpu, Copy)
+{
+		Cpu cpu;
+		Cpu copy;
+		u8 program[] = { 0x70, 0x01, 0x22, 0x06, 0x12, 0x00, 0xD0, 0x15, 0x00, 0xEE };
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Run(3);
+		memcpy(&copy, &cpu, sizeof cpu);
+		cpu.Run(50);
+		copy.Run(50);
+		EXPECT_EQ(0, memcmp(&cpu, &copy, sizeof cpu));
+		EXPECT_EQ(0, reinterpret_cast<uintptr_t>(&cpu) % 64);
+}
+
+TEST(Cpu, SaveState)
+{
+		Cpu cpu;
+		Cpu restored_cpu;
+		Cpu::State state;
+		Cpu::State restored_state;
+		u8 program[] = { 0x70, 0x01, 0x22, 0x06, 0x12, 0x00, 0xD0, 0x15, 0xF0, 0x15, 0x00, 0xEE };
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.SetKey(0x3, true);
+		cpu.Run(4);
+		cpu.SaveState(state);
+		restored_cpu.LoadState(state);
+		restored_cpu.SaveState(restored_state);
+		EXPECT_EQ(0, memcmp(&state, &restored_state, sizeof state));
+		EXPECT_EQ(~0ULL, restored_cpu.TakeWrittenPages());
+		EXPECT_EQ(0xFFFFFFFF, restored_cpu.GetDirtyRows());
+
+		cpu.Run(50);
+		restored_cpu.Run(50);
+		cpu.SaveState(state);
+		restored_cpu.SaveState(restored_state);
+		EXPECT_EQ(0, memcmp(&state, &restored_state, sizeof state));
+}
+
+TEST(Cpu, LoadProgram)
+{
+		Cpu cpu;
+		const u8 *ram = cpu.GetRam();
+		u8 program[] = { 0x12, 0x34, 0x56 };
+		u16 address = Cpu::program_start;
+
+		EXPECT_EQ(true, cpu.LoadProgram(program, sizeof program));
+		EXPECT_EQ(address, cpu.GetProgramCounter());
+		EXPECT_EQ(0, memcmp(ram + address, program, sizeof program));
+}
+
+TEST(Cpu, LoadProgram_TooLarge)
+{
+		Cpu cpu;
+		std::vector<u8> program(Cpu::program_size + 1);
+
+		EXPECT_EQ(false, cpu.LoadProgram(program.data(), static_cast<u16>(program.size())));
+}
+
+TEST(Cpu, Step)
+{
+		Cpu cpu;
+		u8 program[] = { 0x60, 0x12, 0x70, 0x34, 0x22, 0x08, 0x00, 0x00, 0x81, 0x00, 0x00, 0xEE };
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Step();
+		EXPECT_EQ(0x12, cpu.GetDataRegister(DataRegisters::v0));
+		EXPECT_EQ(Cpu::program_start + 2, cpu.GetProgramCounter());
+
+		cpu.Step();
+		EXPECT_EQ(0x12 + 0x34, cpu.GetDataRegister(DataRegisters::v0));
+
+		cpu.Step();
+		EXPECT_EQ(0x208, cpu.GetProgramCounter());
+		EXPECT_EQ(Cpu::program_start + 6, cpu.GetStack());
+
+		cpu.Step();
+		EXPECT_EQ(0x12 + 0x34, cpu.GetDataRegister(DataRegisters::v1));
+
+		cpu.Step();
+		EXPECT_EQ(Cpu::program_start + 6, cpu.GetProgramCounter());
+		EXPECT_EQ(5, cpu.GetCycles());
+}
+
+TEST(Cpu, Run)
+{
+		Cpu cpu;
+		u8 program[] = { 0x70, 0x01, 0x12, 0x00 };
+		u32 cycles = 100;
+
+		cpu.LoadProgram(program, sizeof program);
+		EXPECT_EQ(cycles, cpu.Run(cycles));
+		EXPECT_EQ(cycles / 2, cpu.GetDataRegister(DataRegisters::v0));
+		EXPECT_EQ(cycles, cpu.GetCycles());
+		EXPECT_EQ(Cpu::Fault::none, cpu.GetFault());
+}
+
+TEST(Cpu, Run_InvalidOpcode)
+{
+		Cpu cpu;
+		u8 program[] = { 0x70, 0x01, 0x80, 0x0F, 0x70, 0x01 };
+
+		cpu.LoadProgram(program, sizeof program);
+		EXPECT_EQ(2, cpu.Run(100));
+		EXPECT_EQ(Cpu::Fault::invalid_opcode, cpu.GetFault());
+		EXPECT_EQ(Cpu::program_start + 2, cpu.GetProgramCounter());
+		EXPECT_EQ(1, cpu.GetDataRegister(DataRegisters::v0));
+}
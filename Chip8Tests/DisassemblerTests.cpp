@@ -0,0 +1,139 @@
+#include <gtest\gtest.h>
+#include "../Chip8/Disassembler.h"
+
+using Exit = Disassembler::Exit;
+
+namespace
+{
+		const u8 program[] =
+		{
+				0x60, 0x05,		// 0x200 LD V0, 0x05
+				0x22, 0x0E,		// 0x202 CALL 0x20E
+				0x30, 0x00,		// 0x204 SE V0, 0x00
+				0x12, 0x02,		// 0x206 JP 0x202
+				0xA2, 0x14,		// 0x208 LD I, 0x214
+				0xB2, 0x14,		// 0x20A JP V0, 0x214
+				0x12, 0x0C,		// 0x20C JP 0x20C
+				0x70, 0xFF,		// 0x20E ADD V0, 0xFF
+				0x00, 0xEE,		// 0x210 RET
+				0x00, 0xEE,		// 0x212 RET
+				0xF0, 0x90,		// 0x214 sprite
+				0x90,
+		};
+}
+
+TEST(Disassembler, Disassemble)
+{
+		EXPECT_EQ("CLS", Disassembler::Disassemble(0x00E0));
+		EXPECT_EQ("RET", Disassembler::Disassemble(0x00EE));
+		EXPECT_EQ("SYS 0x123", Disassembler::Disassemble(0x0123));
+		EXPECT_EQ("JP 0x208", Disassembler::Disassemble(0x1208));
+		EXPECT_EQ("SE V3, 0x1F", Disassembler::Disassemble(0x331F));
+		EXPECT_EQ("SUBN VA, VB", Disassembler::Disassemble(0x8AB7));
+		EXPECT_EQ("DRW V0, V1, 0x5", Disassembler::Disassemble(0xD015));
+		EXPECT_EQ("LD B, V3", Disassembler::Disassemble(0xF333));
+		EXPECT_EQ("LD V2, [I]", Disassembler::Disassemble(0xF265));
+		EXPECT_EQ("DW 0x5121", Disassembler::Disassemble(0x5121));
+		EXPECT_EQ("DW 0xF0FF", Disassembler::Disassemble(0xF0FF));
+}
+
+TEST(Disassembler, Disassemble_Quirks)
+{
+		Cpu::Quirks quirks = Cpu::chip48_quirks;
+
+		EXPECT_EQ("SHR V1, V2", Disassembler::Disassemble(0x8126));
+		EXPECT_EQ("SHR V1", Disassembler::Disassemble(0x8126, quirks));
+		EXPECT_EQ("SHL V1", Disassembler::Disassemble(0x812E, quirks));
+		EXPECT_EQ("JP V0, 0x314", Disassembler::Disassemble(0xB314));
+		EXPECT_EQ("JP V3, 0x314", Disassembler::Disassemble(0xB314, quirks));
+}
+
+TEST(Disassembler, GetBlocks)
+{
+		Disassembler disassembler(program, sizeof program);
+		const std::vector<Disassembler::BasicBlock> &blocks = disassembler.GetBlocks();
+
+		ASSERT_EQ(6, blocks.size());
+
+		// The call is jumped back to, so it starts a block of its own.
+		EXPECT_EQ(0x200, blocks[0].address);
+		EXPECT_EQ(1, blocks[0].instructions);
+		EXPECT_EQ(Exit::falls_through, blocks[0].exit);
+		EXPECT_EQ(std::vector<u16>({ 0x202 }), blocks[0].successors);
+
+		EXPECT_EQ(0x202, blocks[1].address);
+		EXPECT_EQ(Exit::call, blocks[1].exit);
+		EXPECT_EQ(std::vector<u16>({ 0x20E, 0x204 }), blocks[1].successors);
+
+		EXPECT_EQ(0x204, blocks[2].address);
+		EXPECT_EQ(Exit::skip, blocks[2].exit);
+		EXPECT_EQ(std::vector<u16>({ 0x206, 0x208 }), blocks[2].successors);
+
+		EXPECT_EQ(0x206, blocks[3].address);
+		EXPECT_EQ(Exit::jump, blocks[3].exit);
+		EXPECT_EQ(std::vector<u16>({ 0x202 }), blocks[3].successors);
+
+		EXPECT_EQ(0x208, blocks[4].address);
+		EXPECT_EQ(4, blocks[4].size);
+		EXPECT_EQ(2, blocks[4].instructions);
+		EXPECT_EQ(Exit::computed_jump, blocks[4].exit);
+		EXPECT_TRUE(blocks[4].successors.empty());
+
+		EXPECT_EQ(0x20E, blocks[5].address);
+		EXPECT_EQ(Exit::return_, blocks[5].exit);
+		EXPECT_TRUE(blocks[5].successors.empty());
+
+		EXPECT_EQ(std::vector<u16>({ 0x200, 0x202, 0x204, 0x206, 0x208, 0x20E }), disassembler.GetBlockAddresses());
+}
+
+TEST(Disassembler, GetComputedJumps)
+{
+		Disassembler disassembler(program, sizeof program);
+
+		EXPECT_EQ(std::vector<u16>({ 0x20A }), disassembler.GetComputedJumps());
+}
+
+TEST(Disassembler, GetDataRegions)
+{
+		Disassembler disassembler(program, sizeof program);
+		const std::vector<Disassembler::DataRegion> &data_regions = disassembler.GetDataRegions();
+
+		ASSERT_EQ(2, data_regions.size());
+		EXPECT_EQ(0x20C, data_regions[0].address);
+		EXPECT_EQ(2, data_regions[0].size);
+		EXPECT_EQ(0x212, data_regions[1].address);
+		EXPECT_EQ(5, data_regions[1].size);
+		EXPECT_TRUE(disassembler.IsCode(0x20B));
+		EXPECT_FALSE(disassembler.IsCode(0x20C));
+}
+
+TEST(Disassembler, GetListing)
+{
+		u8 short_program[] =
+		{
+				0x60, 0x05,		// 0x200 LD V0, 0x05
+				0x12, 0x00,		// 0x202 JP 0x200
+				0xF0, 0x90,		// 0x204 sprite
+		};
+		Disassembler disassembler(short_program, sizeof short_program);
+
+		EXPECT_EQ(
+				"block_200:\n"
+				"\t\t0x200  6005  LD V0, 0x05\n"
+				"\t\t0x202  1200  JP 0x200\n"
+				"data_204:\n"
+				"\t\t0x204        DB 0xF0, 0x90\n",
+				disassembler.GetListing());
+}
+
+TEST(Disassembler, GetBlocks_RunsOffTheEnd)
+{
+		u8 short_program[] = { 0x60, 0x05, 0x70, 0x01, 0xFF };
+		Disassembler disassembler(short_program, sizeof short_program);
+
+		ASSERT_EQ(1, disassembler.GetBlocks().size());
+		EXPECT_EQ(2, disassembler.GetBlocks()[0].instructions);
+		EXPECT_EQ(Exit::stops, disassembler.GetBlocks()[0].exit);
+		ASSERT_EQ(1, disassembler.GetDataRegions().size());
+		EXPECT_EQ(0x204, disassembler.GetDataRegions()[0].address);
+}
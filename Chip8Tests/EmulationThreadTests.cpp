@@ -0,0 +1,138 @@
+#include <gtest\gtest.h>
+#include "../Chip8/EmulationThread.h"
+
+TEST(EmulationThread, Run)
+{
+		EmulationThread emulation_thread;
+		u8 program[] =
+		{
+				0x00, 0xE0,		// 0x200 CLS
+				0xD0, 0x05,		// 0x202 DRW V0, V0, 0x5
+				0x12, 0x04,		// 0x204 JP 0x204
+		};
+
+		EXPECT_TRUE(emulation_thread.LoadProgram(program, sizeof program));
+		emulation_thread.SetMode(Scheduler::Mode::uncapped);
+		emulation_thread.Start();
+		EXPECT_TRUE(emulation_thread.IsRunning());
+
+		Scheduler::Clock::time_point timeout = Scheduler::Clock::now() + std::chrono::seconds(5);
+
+		while (!emulation_thread.AcquireFrame() && Scheduler::Clock::now() < timeout)
+		{
+				std::this_thread::yield();
+		}
+
+		emulation_thread.Stop();
+		EXPECT_FALSE(emulation_thread.IsRunning());
+		EXPECT_EQ(0xF0, emulation_thread.GetFrame().pixels[0][0]);
+		EXPECT_EQ(0x00, emulation_thread.GetFrame().pixels[0][1]);
+		EXPECT_LT(0, emulation_thread.GetFrame().number);
+}
+
+TEST(EmulationThread, LoadProgram_TooLarge)
+{
+		EmulationThread emulation_thread;
+		u8 program[Cpu::program_size + 1] = {};
+
+		EXPECT_FALSE(emulation_thread.LoadProgram(program, sizeof program));
+}
+
+TEST(EmulationThread, SetKey_WaitKey)
+{
+		EmulationThread emulation_thread;
+		u8 program[] =
+		{
+				0xF0, 0x0A,		// 0x200 LD V0, K
+				0xF0, 0x29,		// 0x202 LD F, V0
+				0xD1, 0x15,		// 0x204 DRW V1, V1, 0x5
+				0x12, 0x06,		// 0x206 JP 0x206
+		};
+
+		emulation_thread.LoadProgram(program, sizeof program);
+		emulation_thread.Start();
+
+		Scheduler::Clock::time_point timeout = Scheduler::Clock::now() + std::chrono::seconds(5);
+
+		while (!emulation_thread.IsParked() && Scheduler::Clock::now() < timeout)
+		{
+				std::this_thread::yield();
+		}
+
+		EXPECT_TRUE(emulation_thread.IsParked());
+
+		Scheduler::Clock::time_point pressed = Scheduler::Clock::now();
+
+		EXPECT_TRUE(emulation_thread.SetKey(0x1, true, pressed));
+
+		// The blank first frame may still be waiting to be picked up.
+		while (Scheduler::Clock::now() < timeout && !(emulation_thread.AcquireFrame() && emulation_thread.GetFrame().pixels[0][0]))
+		{
+				std::this_thread::yield();
+		}
+
+		emulation_thread.Stop();
+		EXPECT_FALSE(emulation_thread.IsParked());
+		EXPECT_EQ(0x20, emulation_thread.GetFrame().pixels[0][0]);
+		EXPECT_EQ(static_cast<u64>(pressed.time_since_epoch().count()), emulation_thread.GetFrame().input_time);
+}
+
+TEST(EmulationThread, SetAudio)
+{
+		EmulationThread emulation_thread;
+		AudioBuffer audio_buffer(4096);
+		u8 program[] =
+		{
+				0x60, 0x3C,		// 0x200 LD V0, 0x3C
+				0xF0, 0x18,		// 0x202 LD ST, V0
+				0x12, 0x04,		// 0x204 JP 0x204
+		};
+
+		emulation_thread.SetAudio(&audio_buffer);
+		emulation_thread.LoadProgram(program, sizeof program);
+		emulation_thread.Start();
+
+		Scheduler::Clock::time_point timeout = Scheduler::Clock::now() + std::chrono::seconds(5);
+
+		while (!audio_buffer.GetBuffered() && Scheduler::Clock::now() < timeout)
+		{
+				std::this_thread::yield();
+		}
+
+		emulation_thread.Stop();
+
+		u8 samples[2];
+		u8 silence = AudioBuffer::silence;
+
+		EXPECT_LE(2, audio_buffer.Read(samples, sizeof samples));
+		EXPECT_NE(silence, samples[0]);
+}
+
+TEST(EmulationThread, SetProfiler)
+{
+		EmulationThread emulation_thread;
+		Profiler profiler;
+		u8 program[] =
+		{
+				0x70, 0x01,		// 0x200 ADD V0, 0x01
+				0x12, 0x00,		// 0x202 JP 0x200
+		};
+
+		emulation_thread.SetProfiler(&profiler);
+		emulation_thread.LoadProgram(program, sizeof program);
+		emulation_thread.Start();
+
+		Scheduler::Clock::time_point timeout = Scheduler::Clock::now() + std::chrono::seconds(5);
+
+		while (!emulation_thread.AcquireFrame() && Scheduler::Clock::now() < timeout)
+		{
+				std::this_thread::yield();
+		}
+
+		emulation_thread.Stop();
+
+		ASSERT_FALSE(profiler.GetFrameCycles().empty());
+		EXPECT_LT(0U, profiler.GetFrameCycles()[0]);
+		EXPECT_LT(0U, profiler.GetOpcodeCount(0x7001));
+		EXPECT_LT(0U, profiler.GetHeatmap()[0x202]);
+}
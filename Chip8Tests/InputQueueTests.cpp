@@ -0,0 +1,73 @@
+#include <gtest\gtest.h>
+#include "../Chip8/InputQueue.h"
+#include <thread>
+
+TEST(InputQueue, Peek_Empty)
+{
+		InputQueue input_queue;
+		InputQueue::Event event;
+
+		EXPECT_TRUE(input_queue.IsEmpty());
+		EXPECT_FALSE(input_queue.Peek(event));
+}
+
+TEST(InputQueue, Push_Full)
+{
+		InputQueue input_queue;
+		InputQueue::Event event = { InputQueue::Clock::now(), 0x0, true };
+		u32 capacity = InputQueue::capacity;
+
+		for (u32 pushed = 0; pushed < capacity; ++pushed)
+		{
+				event.key = pushed % Cpu::keys;
+				EXPECT_TRUE(input_queue.Push(event));
+		}
+
+		EXPECT_FALSE(input_queue.Push(event));
+		EXPECT_TRUE(input_queue.Peek(event));
+		EXPECT_EQ(0x0, event.key);
+		input_queue.Pop();
+		EXPECT_TRUE(input_queue.Push(event));
+}
+
+TEST(InputQueue, Push_Threads)
+{
+		InputQueue input_queue;
+		const u32 events = 100000;
+
+		std::thread producer([&]()
+		{
+				InputQueue::Event event = { InputQueue::Clock::now(), 0x0, false };
+
+				for (u32 pushed = 0; pushed < events; ++pushed)
+				{
+						event.key = pushed % Cpu::keys;
+						event.pressed = pushed % 2 == 0;
+
+						while (!input_queue.Push(event))
+						{
+								std::this_thread::yield();
+						}
+				}
+		});
+
+		InputQueue::Event event;
+		u32 popped = 0;
+
+		while (popped < events)
+		{
+				if (!input_queue.Peek(event))
+				{
+						std::this_thread::yield();
+						continue;
+				}
+
+				ASSERT_EQ(popped % Cpu::keys, event.key);
+				ASSERT_EQ(popped % 2 == 0, event.pressed);
+				input_queue.Pop();
+				++popped;
+		}
+
+		producer.join();
+		EXPECT_TRUE(input_queue.IsEmpty());
+}
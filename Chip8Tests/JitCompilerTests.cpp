@@ -0,0 +1,261 @@
+#include <gtest\gtest.h>
+#include "../Chip8/Disassembler.h"
+#include "../Chip8/JitCompiler.h"
+
+using DataRegisters = Cpu::DataRegisters;
+
+namespace
+{
+		void ExpectSameState(Cpu &expected, Cpu &actual)
+		{
+				EXPECT_EQ(0, memcmp(expected.GetDataRegisters(), actual.GetDataRegisters(), Cpu::data_registers));
+				EXPECT_EQ(0, memcmp(expected.GetRam(), actual.GetRam(), Cpu::ram_size));
+				EXPECT_EQ(expected.GetProgramCounter(), actual.GetProgramCounter());
+				EXPECT_EQ(expected.GetIndex(), actual.GetIndex());
+				EXPECT_EQ(expected.GetCycles(), actual.GetCycles());
+		}
+}
+
+TEST(JitCompiler, Run_MatchesCpu)
+{
+		Cpu cpu;
+		Cpu jit_cpu;
+		JitCompiler jit_compiler(jit_cpu);
+		u8 program[] =
+		{
+				0x60, 0xF0,		// 0x200 LD V0, 0xF0
+				0x61, 0x33,		// 0x202 LD V1, 0x33
+				0x70, 0x07,		// 0x204 ADD V0, 0x07
+				0x82, 0x00,		// 0x206 LD V2, V0
+				0x82, 0x11,		// 0x208 OR V2, V1
+				0x83, 0x02,		// 0x20A AND V3, V0
+				0x84, 0x13,		// 0x20C XOR V4, V1
+				0x85, 0x04,		// 0x20E ADD V5, V0
+				0x86, 0x15,		// 0x210 SUB V6, V1
+				0x87, 0x27,		// 0x212 SUBN V7, V2
+				0x88, 0x06,		// 0x214 SHR V8, V0
+				0x89, 0x1E,		// 0x216 SHL V9, V1
+				0xA3, 0x00,		// 0x218 LD I, 0x300
+				0xF5, 0x33,		// 0x21A LD B, V5
+				0x22, 0x28,		// 0x21C CALL 0x228
+				0x35, 0x10,		// 0x21E SE V5, 0x10
+				0x45, 0x20,		// 0x220 SNE V5, 0x20
+				0x50, 0x10,		// 0x222 SE V0, V1
+				0x12, 0x04,		// 0x224 JP 0x204
+				0x00, 0x00,		// 0x226
+				0x90, 0x20,		// 0x228 SNE V0, V2
+				0x00, 0xEE,		// 0x22A RET
+				0x00, 0xEE,		// 0x22C RET
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		jit_cpu.LoadProgram(program, sizeof program);
+
+		for (u32 cycles = 1; cycles < 2000; cycles += 37)
+		{
+				EXPECT_EQ(cpu.Run(cycles), jit_compiler.Run(cycles));
+				ExpectSameState(cpu, jit_cpu);
+		}
+}
+
+TEST(JitCompiler, Run_SelfModifyingCode)
+{
+		Cpu cpu;
+		JitCompiler jit_compiler(cpu);
+		u8 program[] =
+		{
+				0x60, 0x64,		// 0x200 LD V0, 100
+				0x71, 0x01,		// 0x202 ADD V1, 0x01
+				0x31, 0x02,		// 0x204 SE V1, 0x02
+				0x12, 0x02,		// 0x206 JP 0x202
+				0xA2, 0x0E,		// 0x208 LD I, 0x20E
+				0xF0, 0x33,		// 0x20A LD B, V0 - overwrites 0x20E with 01 00 00
+				0x12, 0x0E,		// 0x20C JP 0x20E
+				0x72, 0x05,		// 0x20E ADD V2, 0x05
+				0x73, 0x07,		// 0x210 ADD V3, 0x07
+				0x12, 0x12,		// 0x212 JP 0x212
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		jit_compiler.Run(20);
+		EXPECT_EQ(2, cpu.GetDataRegister(DataRegisters::v1));
+		EXPECT_EQ(0, cpu.GetDataRegister(DataRegisters::v2));
+		EXPECT_EQ(0, cpu.GetDataRegister(DataRegisters::v3));
+		EXPECT_EQ(0x212, cpu.GetProgramCounter());
+}
+
+TEST(JitCompiler, Run_InvalidOpcode)
+{
+		Cpu cpu;
+		JitCompiler jit_compiler(cpu);
+		u8 program[] = { 0x70, 0x01, 0x80, 0x0F, 0x70, 0x01 };
+
+		cpu.LoadProgram(program, sizeof program);
+		EXPECT_EQ(2, jit_compiler.Run(100));
+		EXPECT_EQ(Cpu::Fault::invalid_opcode, cpu.GetFault());
+		EXPECT_EQ(Cpu::program_start + 2, cpu.GetProgramCounter());
+}
+
+TEST(JitCompiler, Run_StackUnderflow)
+{
+		Cpu cpu;
+		JitCompiler jit_compiler(cpu);
+		u8 program[] = { 0x70, 0x01, 0x00, 0xEE, 0x70, 0x01 };
+
+		cpu.LoadProgram(program, sizeof program);
+		EXPECT_EQ(2, jit_compiler.Run(100));
+		EXPECT_EQ(Cpu::Fault::stack_underflow, cpu.GetFault());
+		EXPECT_EQ(0x202, cpu.GetProgramCounter());
+		EXPECT_EQ(1, cpu.GetDataRegister(DataRegisters::v0));
+}
+
+TEST(JitCompiler, Run_Timers)
+{
+		Cpu cpu;
+		Cpu jit_cpu;
+		JitCompiler jit_compiler(jit_cpu);
+		u8 program[] =
+		{
+				0x60, 0x20,		// 0x200 LD V0, 0x20
+				0xF0, 0x15,		// 0x202 LD DT, V0
+				0x72, 0x01,		// 0x204 ADD V2, 0x01
+				0xF1, 0x07,		// 0x206 LD V1, DT
+				0x31, 0x00,		// 0x208 SE V1, 0x00
+				0x12, 0x04,		// 0x20A JP 0x204
+				0x12, 0x00,		// 0x20C JP 0x200
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.SetCyclesPerTick(7);
+		jit_cpu.LoadProgram(program, sizeof program);
+		jit_cpu.SetCyclesPerTick(7);
+
+		for (u32 cycles = 1; cycles < 2000; cycles += 37)
+		{
+				EXPECT_EQ(cpu.Run(cycles), jit_compiler.Run(cycles));
+				ExpectSameState(cpu, jit_cpu);
+				EXPECT_EQ(cpu.GetDelayTimer(), jit_cpu.GetDelayTimer());
+		}
+}
+
+TEST(JitCompiler, Run_WaitKey)
+{
+		Cpu cpu;
+		Cpu jit_cpu;
+		JitCompiler jit_compiler(jit_cpu);
+		u8 program[] =
+		{
+				0x70, 0x01,		// 0x200 ADD V0, 0x01
+				0xF1, 0x0A,		// 0x202 LD V1, K
+				0x72, 0x01,		// 0x204 ADD V2, 0x01
+				0x12, 0x00,		// 0x206 JP 0x200
+		};
+
+		cpu.LoadProgram(program, sizeof program);
+		jit_cpu.LoadProgram(program, sizeof program);
+		EXPECT_EQ(cpu.Run(100), jit_compiler.Run(100));
+		ExpectSameState(cpu, jit_cpu);
+		EXPECT_EQ(0x202, jit_cpu.GetProgramCounter());
+		cpu.SetKey(0x03, true);
+		jit_cpu.SetKey(0x03, true);
+		EXPECT_EQ(cpu.Run(100), jit_compiler.Run(100));
+		ExpectSameState(cpu, jit_cpu);
+		EXPECT_EQ(0x03, jit_cpu.GetDataRegister(DataRegisters::v1));
+}
+
+// Key skips run through their handlers, which move the program counter
+// past the next instruction, so the block has to end there.
+TEST(JitCompiler, Run_SkipKey)
+{
+		u8 program[] =
+		{
+				0x60, 0x05,		// 0x200 LD V0, 0x05
+				0xE0, 0x9E,		// 0x202 SKP V0
+				0x61, 0x01,		// 0x204 LD V1, 0x01
+				0xE0, 0xA1,		// 0x206 SKNP V0
+				0x62, 0x01,		// 0x208 LD V2, 0x01
+				0x73, 0x01,		// 0x20A ADD V3, 0x01
+				0x12, 0x0C,		// 0x20C JP 0x20C
+		};
+
+		for (bool pressed : { false, true })
+		{
+				Cpu cpu;
+				Cpu jit_cpu;
+				JitCompiler jit_compiler(jit_cpu);
+
+				cpu.LoadProgram(program, sizeof program);
+				jit_cpu.LoadProgram(program, sizeof program);
+				cpu.SetKey(0x05, pressed);
+				jit_cpu.SetKey(0x05, pressed);
+				EXPECT_EQ(cpu.Run(20), jit_compiler.Run(20));
+				ExpectSameState(cpu, jit_cpu);
+				EXPECT_EQ(pressed ? 0 : 1, jit_cpu.GetDataRegister(DataRegisters::v1));
+				EXPECT_EQ(pressed ? 1 : 0, jit_cpu.GetDataRegister(DataRegisters::v2));
+		}
+}
+
+TEST(JitCompiler, Run_Quirks)
+{
+		Cpu cpu;
+		Cpu jit_cpu;
+		JitCompiler jit_compiler(jit_cpu);
+		u8 program[] =
+		{
+				0x60, 0x81,		// 0x200 LD V0, 0x81
+				0x61, 0x06,		// 0x202 LD V1, 0x06
+				0x80, 0x1E,		// 0x204 SHL V0, V1
+				0x81, 0x06,		// 0x206 SHR V1, V0
+				0xA3, 0x00,		// 0x208 LD I, 0x300
+				0xF1, 0x55,		// 0x20A LD [I], V1
+				0xF1, 0x65,		// 0x20C LD V1, [I]
+				0xB1, 0x10,		// 0x20E JP V1, 0x110
+				0x00, 0x00,		// 0x210
+				0x00, 0x00,		// 0x212
+				0x12, 0x00,		// 0x214 JP 0x200
+		};
+
+		cpu.SetQuirks(Cpu::chip48_quirks);
+		cpu.LoadProgram(program, sizeof program);
+		jit_cpu.LoadProgram(program, sizeof program);
+
+		// Blocks built for the old quirks have to go.
+		jit_compiler.Run(10);
+		jit_cpu = Cpu();
+		jit_cpu.SetQuirks(Cpu::chip48_quirks);
+		jit_cpu.LoadProgram(program, sizeof program);
+
+		for (u32 cycles = 1; cycles < 500; cycles += 13)
+		{
+				EXPECT_EQ(cpu.Run(cycles), jit_compiler.Run(cycles));
+				ExpectSameState(cpu, jit_cpu);
+		}
+}
+
+TEST(JitCompiler, Prewarm)
+{
+		Cpu cpu;
+		Cpu jit_cpu;
+		JitCompiler jit_compiler(jit_cpu);
+		u8 program[] =
+		{
+				0x60, 0x00,		// 0x200 LD V0, 0x00
+				0x22, 0x0A,		// 0x202 CALL 0x20A
+				0x30, 0x20,		// 0x204 SE V0, 0x20
+				0x12, 0x02,		// 0x206 JP 0x202
+				0x00, 0x00,		// 0x208
+				0x70, 0x01,		// 0x20A ADD V0, 0x01
+				0x00, 0xEE,		// 0x20C RET
+		};
+		Disassembler disassembler(program, sizeof program);
+
+		cpu.LoadProgram(program, sizeof program);
+		jit_cpu.LoadProgram(program, sizeof program);
+		jit_compiler.Prewarm(disassembler.GetBlockAddresses());
+
+		for (u32 cycles = 1; cycles < 300; cycles += 11)
+		{
+				EXPECT_EQ(cpu.Run(cycles), jit_compiler.Run(cycles));
+				ExpectSameState(cpu, jit_cpu);
+		}
+}
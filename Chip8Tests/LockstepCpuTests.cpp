@@ -0,0 +1,173 @@
+#include <gtest\gtest.h>
+#include "../Chip8/LockstepCpu.h"
+#include <memory>
+
+using DataRegisters = Cpu::DataRegisters;
+
+namespace
+{
+		// Lanes take different paths through the skips depending on V0, draw,
+		// store and reload registers, call a subroutine and then loop forever.
+		const u8 divergent_program[] =
+		{
+				0x61, 0x03,		// 0x200 LD V1, 0x03
+				0x30, 0x05,		// 0x202 SE V0, 0x05
+				0x81, 0x04,		// 0x204 ADD V1, V0
+				0x81, 0x15,		// 0x206 SUB V1, V1
+				0x82, 0x06,		// 0x208 SHR V2, V0
+				0x83, 0x0E,		// 0x20A SHL V3, V0
+				0x84, 0x07,		// 0x20C SUBN V4, V0
+				0x70, 0xFF,		// 0x20E ADD V0, 0xFF
+				0xF0, 0x29,		// 0x210 LD F, V0
+				0xD0, 0x05,		// 0x212 DRW V0, V0, 0x5
+				0xA3, 0x00,		// 0x214 LD I, 0x300
+				0xF0, 0x33,		// 0x216 LD B, V0
+				0xF2, 0x65,		// 0x218 LD V2, [I]
+				0x22, 0x22,		// 0x21A CALL 0x222
+				0x40, 0x00,		// 0x21C SNE V0, 0x00
+				0x75, 0x01,		// 0x21E ADD V5, 0x01
+				0x12, 0x1C,		// 0x220 JP 0x21C
+				0xF0, 0x1E,		// 0x222 ADD I, V0
+				0x00, 0xEE,		// 0x224 RET
+		};
+}
+
+TEST(LockstepCpu, Run_MatchesCpu)
+{
+		std::unique_ptr<LockstepCpu> lockstep_cpu(new LockstepCpu);
+		u32 cycles = 60;
+
+		lockstep_cpu->LoadProgram(divergent_program, sizeof divergent_program);
+
+		for (u8 lane = 0; lane < LockstepCpu::lanes; ++lane)
+		{
+				lockstep_cpu->SetDataRegister(lane, DataRegisters::v0, lane * 0x11);
+		}
+
+		EXPECT_EQ(cycles * LockstepCpu::lanes, lockstep_cpu->Run(cycles));
+
+		for (u8 lane = 0; lane < LockstepCpu::lanes; ++lane)
+		{
+				Cpu cpu;
+
+				cpu.LoadProgram(divergent_program, sizeof divergent_program);
+				cpu.SetDataRegister(DataRegisters::v0, lane * 0x11);
+				cpu.Run(cycles);
+
+				for (u8 data_register = 0; data_register < Cpu::data_registers; ++data_register)
+				{
+						ASSERT_EQ(cpu.GetDataRegister(static_cast<DataRegisters>(data_register)), lockstep_cpu->GetDataRegister(lane, static_cast<DataRegisters>(data_register)));
+				}
+
+				ASSERT_EQ(cpu.GetProgramCounter(), lockstep_cpu->GetProgramCounter(lane));
+				ASSERT_EQ(cpu.GetIndex(), lockstep_cpu->GetIndex(lane));
+				ASSERT_EQ(cpu.GetCycles(), lockstep_cpu->GetCycles(lane));
+				ASSERT_EQ(0, memcmp(cpu.GetScreen(), lockstep_cpu->GetScreen(lane), Cpu::screen_height * sizeof(u64)));
+				ASSERT_EQ(0, memcmp(cpu.GetRam(), lockstep_cpu->GetRam(lane), Cpu::ram_size));
+		}
+}
+
+TEST(LockstepCpu, Run_JumpPlusWraps)
+{
+		std::unique_ptr<LockstepCpu> lockstep_cpu(new LockstepCpu);
+		std::unique_ptr<Cpu[]> cpus(new Cpu[LockstepCpu::lanes]);
+		u8 program[] =
+		{
+				0xBF, 0x03,		// 0x200 JP V0, 0xF03
+		};
+
+		// The last lanes jump past the end of ram, and land at the same
+		// addresses as lanes that did not.
+		lockstep_cpu->LoadProgram(program, sizeof program);
+
+		for (u8 lane = 0; lane < LockstepCpu::lanes; ++lane)
+		{
+				lockstep_cpu->SetDataRegister(lane, DataRegisters::v0, 0xF0 + lane);
+				cpus[lane].LoadProgram(program, sizeof program);
+				cpus[lane].SetDataRegister(DataRegisters::v0, 0xF0 + lane);
+		}
+
+		for (u32 run = 0; run < 3; ++run)
+		{
+				lockstep_cpu->Run(1);
+
+				for (u8 lane = 0; lane < LockstepCpu::lanes; ++lane)
+				{
+						cpus[lane].Run(1);
+						ASSERT_EQ(cpus[lane].GetProgramCounter(), lockstep_cpu->GetProgramCounter(lane));
+						ASSERT_EQ(cpus[lane].GetFault(), lockstep_cpu->GetFault(lane));
+						ASSERT_EQ(cpus[lane].GetCycles(), lockstep_cpu->GetCycles(lane));
+				}
+		}
+}
+
+TEST(LockstepCpu, Run_InvalidOpcode)
+{
+		std::unique_ptr<LockstepCpu> lockstep_cpu(new LockstepCpu);
+		u8 program[] = { 0x30, 0x01, 0x80, 0x0F, 0x71, 0x01, 0x12, 0x04 };
+
+		lockstep_cpu->LoadProgram(program, sizeof program);
+		lockstep_cpu->SetDataRegister(1, DataRegisters::v0, 0x01);
+		lockstep_cpu->Run(10);
+		EXPECT_EQ(Cpu::Fault::invalid_opcode, lockstep_cpu->GetFault(0));
+		EXPECT_EQ(0x202, lockstep_cpu->GetProgramCounter(0));
+		EXPECT_EQ(2, lockstep_cpu->GetCycles(0));
+		EXPECT_EQ(Cpu::Fault::none, lockstep_cpu->GetFault(1));
+		EXPECT_EQ(10, lockstep_cpu->GetCycles(1));
+		EXPECT_EQ(5, lockstep_cpu->GetDataRegister(1, DataRegisters::v1));
+}
+
+TEST(LockstepCpu, SetKey)
+{
+		std::unique_ptr<LockstepCpu> lockstep_cpu(new LockstepCpu);
+		u8 program[] = { 0x60, 0x07, 0xE0, 0x9E, 0x12, 0x02, 0x61, 0x01, 0x12, 0x08 };
+
+		lockstep_cpu->LoadProgram(program, sizeof program);
+		lockstep_cpu->SetKey(3, 0x7, true);
+		lockstep_cpu->Run(10);
+		EXPECT_EQ(0, lockstep_cpu->GetDataRegister(0, DataRegisters::v1));
+		EXPECT_EQ(1, lockstep_cpu->GetDataRegister(3, DataRegisters::v1));
+}
+
+TEST(LockstepCpu, WaitKey)
+{
+		std::unique_ptr<LockstepCpu> lockstep_cpu(new LockstepCpu);
+		u8 program[] = { 0xF0, 0x0A, 0x71, 0x01, 0x12, 0x04 };
+
+		lockstep_cpu->LoadProgram(program, sizeof program);
+		lockstep_cpu->SetKey(5, 0xC, true);
+		lockstep_cpu->Run(10);
+		EXPECT_EQ(0x200, lockstep_cpu->GetProgramCounter(0));
+		EXPECT_EQ(0, lockstep_cpu->GetDataRegister(0, DataRegisters::v1));
+		EXPECT_EQ(0xC, lockstep_cpu->GetDataRegister(5, DataRegisters::v0));
+		EXPECT_LT(0, lockstep_cpu->GetDataRegister(5, DataRegisters::v1));
+}
+
+TEST(LockstepCpu, SetSeed)
+{
+		std::unique_ptr<LockstepCpu> lockstep_cpu(new LockstepCpu);
+		u8 program[] = { 0xC0, 0xFF, 0xC1, 0xFF, 0xC2, 0xFF, 0xC3, 0xFF };
+
+		lockstep_cpu->LoadProgram(program, sizeof program);
+
+		for (u8 lane = 0; lane < LockstepCpu::lanes; ++lane)
+		{
+				lockstep_cpu->SetSeed(lane, lane);
+		}
+
+		lockstep_cpu->Run(4);
+
+		for (u8 lane = 0; lane < LockstepCpu::lanes; ++lane)
+		{
+				Cpu cpu;
+
+				cpu.LoadProgram(program, sizeof program);
+				cpu.SetSeed(lane);
+				cpu.Run(4);
+
+				for (u8 data_register = 0; data_register < 4; ++data_register)
+				{
+						ASSERT_EQ(cpu.GetDataRegister(static_cast<DataRegisters>(data_register)), lockstep_cpu->GetDataRegister(lane, static_cast<DataRegisters>(data_register)));
+				}
+		}
+}
@@ -0,0 +1,132 @@
+#include <gtest\gtest.h>
+#include "../Chip8/Profiler.h"
+
+using DataRegisters = Cpu::DataRegisters;
+
+namespace
+{
+		const u8 program[] =
+		{
+				0x60, 0x00,		// 0x200 LD V0, 0x00
+				0x70, 0x01,		// 0x202 ADD V0, 0x01
+				0x30, 0x03,		// 0x204 SE V0, 0x03
+				0x12, 0x02,		// 0x206 JP 0x202
+				0x12, 0x08,		// 0x208 JP 0x208
+		};
+}
+
+TEST(Profiler, Run_MatchesCpu)
+{
+		Cpu cpu;
+		Cpu profiled_cpu;
+		Profiler profiler;
+		u32 cycles = 20;
+
+		cpu.LoadProgram(program, sizeof program);
+		profiled_cpu.LoadProgram(program, sizeof program);
+		EXPECT_EQ(cpu.Run(cycles), profiled_cpu.Run(cycles, profiler));
+		EXPECT_EQ(cpu.GetProgramCounter(), profiled_cpu.GetProgramCounter());
+		EXPECT_EQ(cpu.GetCycles(), profiled_cpu.GetCycles());
+		EXPECT_EQ(cpu.GetDataRegister(DataRegisters::v0), profiled_cpu.GetDataRegister(DataRegisters::v0));
+}
+
+TEST(Profiler, CountInstruction)
+{
+		Cpu cpu;
+		Profiler profiler;
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Run(20, profiler);
+
+		// Three turns of the loop, then the jump to itself idles away the rest.
+		EXPECT_EQ(3, profiler.GetOpcodeCount(0x7001));
+		EXPECT_EQ(2, profiler.GetOpcodeCount(0x1202));
+		EXPECT_EQ(1, profiler.GetHeatmap()[0x200]);
+		EXPECT_EQ(3, profiler.GetHeatmap()[0x204]);
+		EXPECT_EQ(10, profiler.GetInstructions());
+		EXPECT_EQ(10, profiler.GetIdleCycles());
+		EXPECT_EQ(11, profiler.GetHeatmap()[0x208]);
+}
+
+TEST(Profiler, GetOperationCounts)
+{
+		Cpu cpu;
+		Profiler profiler;
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Run(20, profiler);
+
+		std::vector<Profiler::OperationCount> operations = profiler.GetOperationCounts();
+
+		ASSERT_EQ(4, operations.size());
+		EXPECT_STREQ("AddByte", operations[0].name);
+		EXPECT_EQ(3, operations[0].count);
+		EXPECT_STREQ("Jump", operations[1].name);
+		EXPECT_EQ(3, operations[1].count);
+		EXPECT_STREQ("SkipEqualByte", operations[2].name);
+		EXPECT_STREQ("StoreByte", operations[3].name);
+}
+
+TEST(Profiler, CountFrame)
+{
+		Profiler profiler;
+
+		profiler.CountFrame(1000);
+		profiler.CountFrame(250);
+
+		ASSERT_EQ(2, profiler.GetFrameCycles().size());
+		EXPECT_EQ(1000, profiler.GetFrameCycles()[0]);
+		EXPECT_EQ(250, profiler.GetFrameCycles()[1]);
+}
+
+TEST(Profiler, ExportCsv)
+{
+		Cpu cpu;
+		Profiler profiler;
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Run(20, profiler);
+		profiler.CountFrame(20);
+
+		std::string csv = profiler.ExportCsv();
+
+		EXPECT_EQ(0, csv.find("section,key,value\n"));
+		EXPECT_NE(std::string::npos, csv.find("operation,AddByte,3\n"));
+		EXPECT_NE(std::string::npos, csv.find("address,0x208,11\n"));
+		EXPECT_NE(std::string::npos, csv.find("frame,0,20\n"));
+		EXPECT_NE(std::string::npos, csv.find("idle,cycles,10\n"));
+}
+
+TEST(Profiler, ExportJson)
+{
+		Cpu cpu;
+		Profiler profiler;
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Run(20, profiler);
+		profiler.CountFrame(20);
+
+		std::string json = profiler.ExportJson();
+
+		EXPECT_NE(std::string::npos, json.find("\"AddByte\": 3"));
+		EXPECT_NE(std::string::npos, json.find("\"0x208\": 11"));
+		EXPECT_NE(std::string::npos, json.find("\"frame_cycles\": [20]"));
+		EXPECT_NE(std::string::npos, json.find("\"idle_cycles\": 10"));
+}
+
+TEST(Profiler, Reset)
+{
+		Cpu cpu;
+		Profiler profiler;
+
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Run(20, profiler);
+		profiler.CountFrame(20);
+		profiler.Reset();
+
+		EXPECT_EQ(0, profiler.GetInstructions());
+		EXPECT_EQ(0, profiler.GetIdleCycles());
+		EXPECT_EQ(0, profiler.GetHeatmap()[0x202]);
+		EXPECT_TRUE(profiler.GetFrameCycles().empty());
+		EXPECT_TRUE(profiler.GetOperationCounts().empty());
+}
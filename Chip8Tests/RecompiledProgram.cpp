@@ -0,0 +1,346 @@
+// Generated by StaticRecompiler. Declare as:
+// u32 RunRecompiledProgram(Cpu &cpu, u32 cycles);
+
+#include "Cpu.h"
+#include <cstring>
+
+namespace
+{
+		using DataRegisters = Cpu::DataRegisters;
+
+		struct CodeRange
+		{
+				u16 address;
+				u16 size;
+		};
+
+		const u8 program[] =
+		{
+				0x60, 0x00, 0x61, 0x00, 0x22, 0x1C, 0x30, 0x05, 0x12, 0x04, 0xA3, 0x00,
+				0xF1, 0x33, 0xF1, 0x15, 0x60, 0x73, 0x61, 0x04, 0xA2, 0x22, 0xF1, 0x55,
+				0xF3, 0x07, 0x12, 0x22, 0x70, 0x01, 0x81, 0x04, 0x00, 0xEE, 0x62, 0x07,
+				0x12, 0x24,
+		};
+
+		const CodeRange code_ranges[] =
+		{
+				{ 0x200, 0x026 },
+		};
+
+		bool IsCodeIntact(Cpu &cpu)
+		{
+				for (const CodeRange &code_range : code_ranges)
+				{
+						if (memcmp(cpu.GetRam() + code_range.address, program + code_range.address - Cpu::program_start, code_range.size) != 0)
+								return false;
+				}
+
+				return true;
+		}
+
+		bool TouchesCode(u16 address, u16 size)
+		{
+				for (u16 offset = 0; offset < size; ++offset)
+				{
+						u16 written_address = (address + offset) & 0xFFF;
+
+						for (const CodeRange &code_range : code_ranges)
+						{
+								if (written_address >= code_range.address && written_address < code_range.address + code_range.size)
+										return true;
+						}
+				}
+
+				return false;
+		}
+}
+
+u32 RunRecompiledProgram(Cpu &cpu, u32 cycles)
+{
+		u32 executed = 0;
+		u32 native = 0;
+
+		if (!IsCodeIntact(cpu))
+				return cpu.Run(cycles);
+
+dispatch:
+		if (executed == cycles || cpu.GetFault() != Cpu::Fault::none)
+				goto finish;
+
+		switch (cpu.GetProgramCounter())
+		{
+		case 0x200: goto pc_200;
+		case 0x202: goto pc_202;
+		case 0x204: goto pc_204;
+		case 0x206: goto pc_206;
+		case 0x208: goto pc_208;
+		case 0x20A: goto pc_20A;
+		case 0x20C: goto pc_20C;
+		case 0x20E: goto pc_20E;
+		case 0x210: goto pc_210;
+		case 0x212: goto pc_212;
+		case 0x214: goto pc_214;
+		case 0x216: goto pc_216;
+		case 0x218: goto pc_218;
+		case 0x21A: goto pc_21A;
+		case 0x21C: goto pc_21C;
+		case 0x21E: goto pc_21E;
+		case 0x220: goto pc_220;
+		case 0x222: goto pc_222;
+		case 0x224: goto pc_224;
+		}
+
+		executed += cpu.Run(1);
+		goto dispatch;
+
+pc_200:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x200);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.SetDataRegister(DataRegisters::v0, 0x00);
+
+pc_202:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x202);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.SetDataRegister(DataRegisters::v1, 0x00);
+
+pc_204:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x204);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.Jump(0x206);
+		cpu.Call(0x21C);
+
+		if (cpu.GetFault() != Cpu::Fault::none)
+				goto finish;
+
+		goto pc_21C;
+
+pc_206:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x206);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		if (cpu.GetDataRegister(DataRegisters::v0) == 0x05)
+		{
+				goto pc_20A;
+		}
+
+pc_208:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x208);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		goto pc_204;
+
+pc_20A:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x20A);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.StoreAddress(0x300);
+
+pc_20C:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x20C);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		{
+				u16 index = cpu.GetIndex();
+
+				cpu.StoreBinaryCodedDecimal(DataRegisters::v1);
+
+				if (TouchesCode(index, 3))
+				{
+						cpu.Jump(0x20E);
+						goto interpret;
+				}
+		}
+
+pc_20E:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x20E);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.AddCycles(native - 1);
+		native = 1;
+		cpu.SetDelayTimer(DataRegisters::v1);
+
+pc_210:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x210);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.SetDataRegister(DataRegisters::v0, 0x73);
+
+pc_212:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x212);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.SetDataRegister(DataRegisters::v1, 0x04);
+
+pc_214:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x214);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.StoreAddress(0x222);
+
+pc_216:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x216);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		{
+				u16 index = cpu.GetIndex();
+
+				cpu.StoreDataRegisters(DataRegisters::v1);
+
+				if (TouchesCode(index, 2))
+				{
+						cpu.Jump(0x218);
+						goto interpret;
+				}
+		}
+
+pc_218:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x218);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.AddCycles(native - 1);
+		native = 1;
+		cpu.StoreDelayTimer(DataRegisters::v3);
+
+pc_21A:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x21A);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		goto pc_222;
+
+pc_21C:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x21C);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.AddByte(DataRegisters::v0, 0x01);
+
+pc_21E:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x21E);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.AddRegisters(DataRegisters::v1, DataRegisters::v0);
+
+pc_220:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x220);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.Return();
+		goto dispatch;
+
+pc_222:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x222);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		cpu.SetDataRegister(DataRegisters::v2, 0x07);
+
+pc_224:
+		if (executed == cycles)
+		{
+				cpu.Jump(0x224);
+				goto finish;
+		}
+
+		++executed;
+		++native;
+		goto pc_224;
+
+finish:
+		cpu.AddCycles(native);
+		return executed;
+
+interpret:
+		cpu.AddCycles(native);
+		return executed + cpu.Run(cycles - executed);
+}
@@ -0,0 +1,112 @@
+#include <gtest\gtest.h>
+#include "../Chip8/RewindBuffer.h"
+#include <vector>
+
+namespace
+{
+		// Counts in V0, draws its digit and stores it as decimal, so every
+		// frame changes registers, the screen and ram.
+		const u8 counter_display[] =
+		{
+				0x70, 0x01,		// 0x200 ADD V0, 0x01
+				0xF0, 0x29,		// 0x202 LD F, V0
+				0x00, 0xE0,		// 0x204 CLS
+				0xD1, 0x25,		// 0x206 DRW V1, V2, 0x5
+				0xA3, 0x00,		// 0x208 LD I, 0x300
+				0xF0, 0x33,		// 0x20A LD B, V0
+				0x12, 0x00,		// 0x20C JP 0x200
+		};
+
+		const u32 cycles_per_frame = 7;
+}
+
+TEST(RewindBuffer, GetState)
+{
+		Cpu cpu;
+		RewindBuffer rewind_buffer(100, 10);
+		std::vector<Cpu::State> states(25);
+		Cpu::State state;
+
+		cpu.LoadProgram(counter_display, sizeof counter_display);
+
+		for (auto &expected_state : states)
+		{
+				cpu.Run(cycles_per_frame);
+				cpu.SaveState(expected_state);
+				rewind_buffer.Push(cpu);
+		}
+
+		EXPECT_EQ(states.size(), rewind_buffer.GetLength());
+
+		for (u32 frames_ago = 0; frames_ago < states.size(); ++frames_ago)
+		{
+				ASSERT_EQ(true, rewind_buffer.GetState(frames_ago, state));
+				ASSERT_EQ(0, memcmp(&states[states.size() - 1 - frames_ago], &state, sizeof state));
+		}
+
+		EXPECT_EQ(false, rewind_buffer.GetState(static_cast<u32>(states.size()), state));
+}
+
+TEST(RewindBuffer, Rewind)
+{
+		Cpu cpu;
+		RewindBuffer rewind_buffer(100, 10);
+		std::vector<Cpu::State> states(25);
+		Cpu::State state;
+
+		cpu.LoadProgram(counter_display, sizeof counter_display);
+
+		for (auto &expected_state : states)
+		{
+				cpu.Run(cycles_per_frame);
+				cpu.SaveState(expected_state);
+				rewind_buffer.Push(cpu);
+		}
+
+		EXPECT_EQ(true, rewind_buffer.Rewind(cpu, 16));
+		EXPECT_EQ(9, rewind_buffer.GetLength());
+		cpu.SaveState(state);
+		EXPECT_EQ(0, memcmp(&states[8], &state, sizeof state));
+
+		cpu.Run(cycles_per_frame);
+		rewind_buffer.Push(cpu);
+		cpu.SaveState(state);
+		EXPECT_EQ(0, memcmp(&states[9], &state, sizeof state));
+		EXPECT_EQ(false, rewind_buffer.Rewind(cpu, 10));
+}
+
+TEST(RewindBuffer, Push_DropsOldestFrames)
+{
+		Cpu cpu;
+		RewindBuffer rewind_buffer(100, 10);
+		std::vector<Cpu::State> states(250);
+		Cpu::State state;
+
+		cpu.LoadProgram(counter_display, sizeof counter_display);
+
+		for (auto &expected_state : states)
+		{
+				cpu.Run(cycles_per_frame);
+				cpu.SaveState(expected_state);
+				rewind_buffer.Push(cpu);
+		}
+
+		u32 length = rewind_buffer.GetLength();
+
+		EXPECT_LE(100, length);
+		EXPECT_GE(110, length);
+		EXPECT_EQ(true, rewind_buffer.GetState(length - 1, state));
+		EXPECT_EQ(0, memcmp(&states[states.size() - length], &state, sizeof state));
+		EXPECT_GT(sizeof(Cpu::State) * 20, rewind_buffer.GetMemoryUsage());
+}
+
+TEST(RewindBuffer, Clear)
+{
+		Cpu cpu;
+		RewindBuffer rewind_buffer(100);
+
+		rewind_buffer.Push(cpu);
+		rewind_buffer.Clear();
+		EXPECT_EQ(0, rewind_buffer.GetLength());
+		EXPECT_EQ(false, rewind_buffer.Rewind(cpu, 0));
+}
@@ -0,0 +1,158 @@
+#include <gtest\gtest.h>
+#include "../Chip8/Scheduler.h"
+#include <vector>
+
+using Clock = Scheduler::Clock;
+using DataRegisters = Cpu::DataRegisters;
+
+namespace
+{
+		// Sets both timers to 0x80 and then counts forever in V1.
+		const u8 timer_program[] =
+		{
+				0x60, 0x80,		// 0x200 LD V0, 0x80
+				0xF0, 0x15,		// 0x202 LD DT, V0
+				0xF0, 0x18,		// 0x204 LD ST, V0
+				0x71, 0x01,		// 0x206 ADD V1, 0x01
+				0x12, 0x06,		// 0x208 JP 0x206
+		};
+
+		Clock::time_point At(Clock::time_point start, u32 milliseconds)
+		{
+				return start + std::chrono::milliseconds(milliseconds);
+		}
+}
+
+TEST(Scheduler, RunFrame)
+{
+		Cpu cpu;
+		Scheduler scheduler(cpu);
+
+		cpu.LoadProgram(timer_program, sizeof timer_program);
+		scheduler.SetInstructionsPerFrame(20);
+		EXPECT_EQ(20, scheduler.RunFrame());
+		EXPECT_EQ(0x7F, cpu.GetDelayTimer());
+		EXPECT_EQ(0x7F, cpu.GetSoundTimer());
+		EXPECT_EQ(20, cpu.GetCycles());
+		EXPECT_EQ(1, scheduler.GetFrames());
+}
+
+TEST(Scheduler, Update_RealTime)
+{
+		Cpu cpu;
+		Scheduler scheduler(cpu);
+		Clock::time_point start = Clock::now();
+		u32 instructions_per_frame = Scheduler::default_instructions_per_frame;
+
+		cpu.LoadProgram(timer_program, sizeof timer_program);
+		EXPECT_EQ(0, scheduler.Update(start));
+		EXPECT_EQ(3, scheduler.Update(At(start, 50)));
+		EXPECT_EQ(0, scheduler.Update(At(start, 60)));
+		EXPECT_EQ(3, scheduler.Update(At(start, 100)));
+		EXPECT_EQ(6 * instructions_per_frame, cpu.GetCycles());
+		EXPECT_EQ(0x80 - 6, cpu.GetDelayTimer());
+		EXPECT_LT(Clock::duration::zero(), scheduler.GetTimeUntilNextFrame(At(start, 100)));
+		EXPECT_GE(std::chrono::milliseconds(17), scheduler.GetTimeUntilNextFrame(At(start, 100)));
+}
+
+TEST(Scheduler, Update_Multiplier)
+{
+		Cpu cpu;
+		Scheduler scheduler(cpu);
+		Clock::time_point start = Clock::now();
+
+		scheduler.SetMode(Scheduler::Mode::multiplier, 2.0);
+		EXPECT_EQ(0, scheduler.Update(start));
+		EXPECT_EQ(6, scheduler.Update(At(start, 50)));
+		EXPECT_EQ(2.0, scheduler.GetTargetSpeed());
+}
+
+TEST(Scheduler, Update_FallsBehind)
+{
+		Cpu cpu;
+		Scheduler scheduler(cpu);
+		Clock::time_point start = Clock::now();
+		u32 max_frames_behind = Scheduler::max_frames_behind;
+
+		EXPECT_EQ(0, scheduler.Update(start));
+		EXPECT_EQ(max_frames_behind, scheduler.Update(At(start, 1000)));
+		EXPECT_EQ(1, scheduler.Update(At(start, 1017)));
+}
+
+TEST(Scheduler, Update_Uncapped)
+{
+		Cpu cpu;
+		Scheduler scheduler(cpu);
+		Clock::time_point start = Clock::now();
+		u32 uncapped_frames = Scheduler::uncapped_frames;
+
+		scheduler.SetMode(Scheduler::Mode::uncapped);
+		EXPECT_EQ(uncapped_frames, scheduler.Update(start));
+		EXPECT_EQ(uncapped_frames, scheduler.Update(start));
+		EXPECT_EQ(Clock::duration::zero(), scheduler.GetTimeUntilNextFrame(start));
+		EXPECT_EQ(0.0, scheduler.GetTargetSpeed());
+}
+
+TEST(Scheduler, GetSpeed)
+{
+		Cpu cpu;
+		Scheduler scheduler(cpu);
+		Clock::time_point start = Clock::now();
+
+		cpu.LoadProgram(timer_program, sizeof timer_program);
+		scheduler.Update(start);
+
+		for (u32 milliseconds = 10; milliseconds <= 1000; milliseconds += 10)
+		{
+				scheduler.Update(At(start, milliseconds));
+		}
+
+		EXPECT_NEAR(1.0, scheduler.GetSpeed(), 0.05);
+}
+
+TEST(Scheduler, SetRunner)
+{
+		Cpu cpu;
+		Scheduler scheduler(cpu);
+		u32 requested_cycles = 0;
+
+		scheduler.SetInstructionsPerFrame(33);
+		scheduler.SetRunner([&](u32 cycles) { requested_cycles = cycles; return cycles; });
+		scheduler.RunFrame();
+		EXPECT_EQ(33, requested_cycles);
+		EXPECT_EQ(0, cpu.GetCycles());
+}
+
+TEST(Scheduler, GetFrameStart)
+{
+		Cpu cpu;
+		Scheduler scheduler(cpu);
+		Clock::time_point start = Clock::now();
+		std::vector<double> frame_starts;
+		std::vector<double> frame_lengths;
+
+		scheduler.SetRunner([&](u32 cycles)
+		{
+				frame_starts.push_back(std::chrono::duration<double>(scheduler.GetFrameStart() - start).count());
+				frame_lengths.push_back(std::chrono::duration<double>(scheduler.GetFrameEnd() - scheduler.GetFrameStart()).count());
+				return cycles;
+		});
+		scheduler.Update(start);
+		EXPECT_EQ(3, scheduler.Update(At(start, 50)));
+		EXPECT_EQ(0.0, frame_starts[0]);
+		EXPECT_NEAR(2.0 / 60, frame_starts[2], 0.000001);
+		EXPECT_NEAR(1.0 / 60, frame_lengths[1], 0.000001);
+}
+
+TEST(Scheduler, Resume)
+{
+		Cpu cpu;
+		Scheduler scheduler(cpu);
+		Clock::time_point start = Clock::now();
+
+		scheduler.Update(start);
+		EXPECT_EQ(1, scheduler.Update(At(start, 20)));
+		scheduler.Resume();
+		EXPECT_EQ(0, scheduler.Update(At(start, 1000)));
+		EXPECT_EQ(1, scheduler.Update(At(start, 1017)));
+}
@@ -0,0 +1,141 @@
+#include <gtest\gtest.h>
+#include "../Chip8/StaticRecompiler.h"
+#include <fstream>
+#include <iterator>
+
+// RecompiledProgram.cpp is the translation of this program, generated with
+// Chip8Recompiler. Translate_MatchesRecompiledProgram fails when the two drift
+// apart, and the file has to be generated again.
+u32 RunRecompiledProgram(Cpu &cpu, u32 cycles);
+
+using DataRegisters = Cpu::DataRegisters;
+
+namespace
+{
+		const u8 recompiled_program[] =
+		{
+				0x60, 0x00,		// 0x200 LD V0, 0x00
+				0x61, 0x00,		// 0x202 LD V1, 0x00
+				0x22, 0x1C,		// 0x204 CALL 0x21C
+				0x30, 0x05,		// 0x206 SE V0, 0x05
+				0x12, 0x04,		// 0x208 JP 0x204
+				0xA3, 0x00,		// 0x20A LD I, 0x300
+				0xF1, 0x33,		// 0x20C LD B, V1
+				0xF1, 0x15,		// 0x20E LD DT, V1
+				0x60, 0x73,		// 0x210 LD V0, 0x73
+				0x61, 0x04,		// 0x212 LD V1, 0x04
+				0xA2, 0x22,		// 0x214 LD I, 0x222
+				0xF1, 0x55,		// 0x216 LD [I], V1 - turns the LD below into ADD V3, 0x04
+				0xF3, 0x07,		// 0x218 LD V3, DT
+				0x12, 0x22,		// 0x21A JP 0x222
+				0x70, 0x01,		// 0x21C ADD V0, 0x01
+				0x81, 0x04,		// 0x21E ADD V1, V0
+				0x00, 0xEE,		// 0x220 RET
+				0x62, 0x07,		// 0x222 LD V2, 0x07
+				0x12, 0x24,		// 0x224 JP 0x224
+		};
+}
+
+TEST(StaticRecompiler, GetInstructionAddresses)
+{
+		u8 program[] =
+		{
+				0x22, 0x08,		// 0x200 CALL 0x208
+				0x30, 0x00,		// 0x202 SE V0, 0x00
+				0x12, 0x0C,		// 0x204 JP 0x20C
+				0x00, 0xE0,		// 0x206 CLS
+				0x70, 0x01,		// 0x208 ADD V0, 0x01
+				0x00, 0xEE,		// 0x20A RET
+				0x12, 0x0C,		// 0x20C JP 0x20C
+		};
+		std::vector<u16> expected_addresses = { 0x200, 0x202, 0x204, 0x206, 0x208, 0x20A, 0x20C };
+		StaticRecompiler static_recompiler(program, sizeof program);
+
+		EXPECT_EQ(expected_addresses, static_recompiler.GetInstructionAddresses());
+		EXPECT_EQ(true, static_recompiler.GetComputedJumps().empty());
+}
+
+TEST(StaticRecompiler, GetInstructionAddresses_SkipsData)
+{
+		u8 program[] =
+		{
+				0x12, 0x04,		// 0x200 JP 0x204
+				0xFF, 0xFF,		// 0x202 data
+				0x12, 0x04,		// 0x204 JP 0x204
+		};
+		std::vector<u16> expected_addresses = { 0x200, 0x204 };
+		StaticRecompiler static_recompiler(program, sizeof program);
+
+		EXPECT_EQ(expected_addresses, static_recompiler.GetInstructionAddresses());
+}
+
+TEST(StaticRecompiler, GetComputedJumps)
+{
+		u8 program[] = { 0x60, 0x02, 0xB2, 0x04, 0x12, 0x04 };
+		std::vector<u16> expected_computed_jumps = { 0x202 };
+		StaticRecompiler static_recompiler(program, sizeof program);
+
+		EXPECT_EQ(expected_computed_jumps, static_recompiler.GetComputedJumps());
+}
+
+TEST(StaticRecompiler, Translate)
+{
+		u8 program[] = { 0x70, 0x01, 0x12, 0x00 };
+		StaticRecompiler static_recompiler(program, sizeof program);
+		std::string code = static_recompiler.Translate("RunCounter");
+
+		EXPECT_NE(std::string::npos, code.find("u32 RunCounter(Cpu &cpu, u32 cycles)"));
+		EXPECT_NE(std::string::npos, code.find("cpu.AddByte(DataRegisters::v0, 0x01);"));
+		EXPECT_NE(std::string::npos, code.find("goto pc_200;"));
+}
+
+TEST(StaticRecompiler, Translate_Timers)
+{
+		u8 program[] = { 0x70, 0x01, 0xF0, 0x07, 0x12, 0x00 };
+		StaticRecompiler static_recompiler(program, sizeof program);
+		std::string code = static_recompiler.Translate("RunTimers");
+
+		EXPECT_NE(std::string::npos, code.find("cpu.AddCycles(native - 1);\n\t\tnative = 1;\n\t\tcpu.StoreDelayTimer(DataRegisters::v0);"));
+}
+
+TEST(StaticRecompiler, Translate_MatchesRecompiledProgram)
+{
+		StaticRecompiler static_recompiler(recompiled_program, sizeof recompiled_program);
+		std::string test_file_name = __FILE__;
+		std::string file_name = test_file_name.substr(0, test_file_name.find_last_of("/\\") + 1) + "RecompiledProgram.cpp";
+		std::ifstream file(file_name);
+
+		ASSERT_TRUE(file) << "Unable to open " << file_name;
+
+		std::string translation((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		EXPECT_EQ(translation, static_recompiler.Translate("RunRecompiledProgram"));
+}
+
+TEST(StaticRecompiler, RunRecompiledProgram_MatchesCpu)
+{
+		// Small budgets stop the translation between any two instructions, and
+		// all of them run on past the store that rewrites code.
+		for (u32 cycles : { 1, 2, 3, 5, 8, 13, 100 })
+		{
+				Cpu cpu;
+				Cpu recompiled_cpu;
+
+				cpu.LoadProgram(recompiled_program, sizeof recompiled_program);
+				recompiled_cpu.LoadProgram(recompiled_program, sizeof recompiled_program);
+
+				for (u32 run = 0; run < 60; ++run)
+				{
+						ASSERT_EQ(cpu.Run(cycles), RunRecompiledProgram(recompiled_cpu, cycles));
+						ASSERT_EQ(0, memcmp(cpu.GetDataRegisters(), recompiled_cpu.GetDataRegisters(), Cpu::data_registers));
+						ASSERT_EQ(0, memcmp(cpu.GetRam(), recompiled_cpu.GetRam(), Cpu::ram_size));
+						ASSERT_EQ(cpu.GetProgramCounter(), recompiled_cpu.GetProgramCounter());
+						ASSERT_EQ(cpu.GetIndex(), recompiled_cpu.GetIndex());
+						ASSERT_EQ(cpu.GetCycles(), recompiled_cpu.GetCycles());
+				}
+
+				EXPECT_EQ(0x73, recompiled_cpu.GetRam()[0x222]);
+				EXPECT_EQ(0, recompiled_cpu.GetDataRegister(DataRegisters::v2));
+				EXPECT_EQ(0x224, recompiled_cpu.GetProgramCounter());
+		}
+}
@@ -0,0 +1,196 @@
+#include <gtest\gtest.h>
+#include "../Chip8/TraceReader.h"
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+
+namespace
+{
+		const u8 program[] =
+		{
+				0x60, 0x00,		// 0x200 LD V0, 0x00
+				0xA3, 0x00,		// 0x202 LD I, 0x300
+				0x70, 0x01,		// 0x204 ADD V0, 0x01
+				0x81, 0x04,		// 0x206 ADD V1, V0
+				0x30, 0x03,		// 0x208 SE V0, 0x03
+				0x12, 0x04,		// 0x20A JP 0x204
+				0x12, 0x0E,		// 0x20C JP 0x20E
+				0x12, 0x0E,		// 0x20E JP 0x20E
+		};
+
+		// Never idles, so every cycle is a record.
+		const u8 counter_loop[] =
+		{
+				0x70, 0x01,		// 0x200 ADD V0, 0x01
+				0x71, 0x03,		// 0x202 ADD V1, 0x03
+				0x12, 0x00,		// 0x204 JP 0x200
+		};
+}
+
+TEST(TraceReader, Next)
+{
+		Cpu cpu;
+		Cpu stepped_cpu;
+		TraceRecorder recorder;
+		TraceReader reader;
+		TraceReader::Record record;
+		const char *file_name = "TraceReaderTests.trace";
+		u32 instructions = 0;
+
+		cpu.LoadProgram(program, sizeof program);
+		stepped_cpu.LoadProgram(program, sizeof program);
+		recorder.Open(file_name);
+		cpu.Run(40, recorder);
+		recorder.Close();
+
+		ASSERT_TRUE(reader.Open(file_name));
+
+		// Every instruction record matches a Cpu stepped alongside, up to the
+		// jump to itself that idles away the rest of the cycles.
+		while (reader.Next(record) && !record.idle_cycles)
+		{
+				EXPECT_EQ(stepped_cpu.GetProgramCounter(), record.address);
+				stepped_cpu.Step();
+				EXPECT_EQ(0, memcmp(stepped_cpu.GetDataRegisters(), record.data_registers, Cpu::data_registers));
+				EXPECT_EQ(stepped_cpu.GetIndex(), record.index);
+				++instructions;
+		}
+
+		EXPECT_EQ(15, instructions);
+		EXPECT_EQ(0x20E, record.address);
+		EXPECT_EQ(25, record.idle_cycles);
+		EXPECT_FALSE(reader.Next(record));
+		EXPECT_FALSE(reader.IsDamaged());
+		reader.Close();
+		std::remove(file_name);
+}
+
+TEST(TraceReader, Next_Changes)
+{
+		Cpu cpu;
+		TraceRecorder recorder;
+		TraceReader reader;
+		TraceReader::Record record;
+		const char *file_name = "TraceReaderTests.trace";
+
+		cpu.LoadProgram(program, sizeof program);
+		recorder.Open(file_name);
+		cpu.Run(4, recorder);
+		recorder.Close();
+		reader.Open(file_name);
+
+		EXPECT_TRUE(reader.Next(record));
+		EXPECT_EQ(0x6000, record.opcode);
+		EXPECT_EQ(0xFFFF, record.changed_registers);
+		EXPECT_TRUE(record.index_changed);
+
+		EXPECT_TRUE(reader.Next(record));
+		EXPECT_EQ(0xA300, record.opcode);
+		EXPECT_EQ(0, record.changed_registers);
+		EXPECT_TRUE(record.index_changed);
+		EXPECT_EQ(0x300, record.index);
+
+		EXPECT_TRUE(reader.Next(record));
+		EXPECT_EQ(0x204, record.address);
+		EXPECT_EQ(0x0001, record.changed_registers);
+		EXPECT_FALSE(record.index_changed);
+		EXPECT_EQ(0x300, record.index);
+
+		EXPECT_TRUE(reader.Next(record));
+		EXPECT_EQ(0x0002, record.changed_registers);
+		EXPECT_EQ(1, record.data_registers[0x1]);
+
+		EXPECT_FALSE(reader.Next(record));
+		reader.Close();
+		std::remove(file_name);
+}
+
+TEST(TraceReader, Next_Compressed)
+{
+		Cpu cpu;
+		Cpu compressed_cpu;
+		TraceRecorder recorder;
+		TraceRecorder compressed_recorder;
+		TraceReader reader;
+		TraceReader compressed_reader;
+		TraceReader::Record record;
+		TraceReader::Record compressed_record;
+		const char *file_name = "TraceReaderTests.trace";
+		const char *compressed_file_name = "TraceReaderTests.compressed.trace";
+		u32 cycles = 600000;
+		u32 records = 0;
+
+		// Enough records for several blocks.
+		cpu.LoadProgram(counter_loop, sizeof counter_loop);
+		compressed_cpu.LoadProgram(counter_loop, sizeof counter_loop);
+		recorder.Open(file_name);
+		compressed_recorder.Open(compressed_file_name, true);
+		cpu.Run(cycles, recorder);
+		compressed_cpu.Run(cycles, compressed_recorder);
+		recorder.Close();
+		compressed_recorder.Close();
+		EXPECT_GT(recorder.GetBytesWritten(), TraceRecorder::block_size);
+		EXPECT_GT(recorder.GetBytesWritten() / 10, compressed_recorder.GetBytesWritten());
+
+		ASSERT_TRUE(reader.Open(file_name));
+		ASSERT_TRUE(compressed_reader.Open(compressed_file_name));
+
+		while (reader.Next(record))
+		{
+				ASSERT_TRUE(compressed_reader.Next(compressed_record));
+				EXPECT_EQ(record.address, compressed_record.address);
+				EXPECT_EQ(record.opcode, compressed_record.opcode);
+				++records;
+		}
+
+		EXPECT_FALSE(compressed_reader.Next(compressed_record));
+		EXPECT_FALSE(compressed_reader.IsDamaged());
+		EXPECT_EQ(cycles, records);
+		EXPECT_EQ(0, memcmp(cpu.GetDataRegisters(), record.data_registers, Cpu::data_registers));
+		reader.Close();
+		compressed_reader.Close();
+		std::remove(file_name);
+		std::remove(compressed_file_name);
+}
+
+TEST(TraceReader, Open_NotATrace)
+{
+		TraceReader reader;
+		const char *file_name = "TraceReaderTests.trace";
+		std::ofstream file(file_name, std::ios::binary);
+
+		file << "RIFF and more";
+		file.close();
+		EXPECT_FALSE(reader.Open(file_name));
+		EXPECT_FALSE(reader.IsOpen());
+		EXPECT_FALSE(reader.Open("MissingDirectory/TraceReaderTests.trace"));
+		std::remove(file_name);
+}
+
+TEST(TraceReader, Next_Damaged)
+{
+		Cpu cpu;
+		TraceRecorder recorder;
+		TraceReader reader;
+		TraceReader::Record record;
+		const char *file_name = "TraceReaderTests.trace";
+
+		cpu.LoadProgram(counter_loop, sizeof counter_loop);
+		recorder.Open(file_name, true);
+		cpu.Run(1000, recorder);
+		recorder.Close();
+
+		// Cut the block short.
+		std::ifstream in(file_name, std::ios::binary);
+		std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+		in.close();
+		std::ofstream(file_name, std::ios::binary).write(bytes.data(), bytes.size() - 4);
+
+		ASSERT_TRUE(reader.Open(file_name));
+		EXPECT_FALSE(reader.Next(record));
+		EXPECT_TRUE(reader.IsDamaged());
+		reader.Close();
+		std::remove(file_name);
+}
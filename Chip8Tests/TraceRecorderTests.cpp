@@ -0,0 +1,126 @@
+#include <gtest\gtest.h>
+#include "../Chip8/TraceRecorder.h"
+#include "../Chip8/TraceReader.h"
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+using DataRegisters = Cpu::DataRegisters;
+
+namespace
+{
+		const u8 program[] =
+		{
+				0x60, 0x00,		// 0x200 LD V0, 0x00
+				0x70, 0x01,		// 0x202 ADD V0, 0x01
+				0x30, 0x03,		// 0x204 SE V0, 0x03
+				0x12, 0x02,		// 0x206 JP 0x202
+				0x12, 0x08,		// 0x208 JP 0x208
+		};
+
+		std::vector<u8> ReadFile(const char *file_name)
+		{
+				std::ifstream file(file_name, std::ios::binary);
+
+				return std::vector<u8>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		}
+}
+
+TEST(TraceRecorder, Run_MatchesCpu)
+{
+		Cpu cpu;
+		Cpu traced_cpu;
+		TraceRecorder recorder;
+		const char *file_name = "TraceRecorderTests.trace";
+		u32 cycles = 20;
+
+		cpu.LoadProgram(program, sizeof program);
+		traced_cpu.LoadProgram(program, sizeof program);
+		EXPECT_TRUE(recorder.Open(file_name));
+		EXPECT_EQ(cpu.Run(cycles), traced_cpu.Run(cycles, recorder));
+		EXPECT_TRUE(recorder.Close());
+		std::remove(file_name);
+		EXPECT_EQ(cpu.GetProgramCounter(), traced_cpu.GetProgramCounter());
+		EXPECT_EQ(cpu.GetCycles(), traced_cpu.GetCycles());
+		EXPECT_EQ(cpu.GetDataRegister(DataRegisters::v0), traced_cpu.GetDataRegister(DataRegisters::v0));
+}
+
+TEST(TraceRecorder, Retire)
+{
+		Cpu cpu;
+		TraceRecorder recorder;
+		const char *file_name = "TraceRecorderTests.trace";
+
+		cpu.LoadProgram(program, sizeof program);
+		recorder.Open(file_name);
+		cpu.Run(3, recorder);
+		EXPECT_EQ(3, recorder.GetRecords());
+
+		// Nothing but the header goes out before the block is full or closed.
+		EXPECT_EQ(8, recorder.GetBytesWritten());
+		EXPECT_TRUE(recorder.Close());
+
+		std::vector<u8> bytes = ReadFile(file_name);
+		const u8 expected[] =
+		{
+				'C', '8', 'T', 'R', 0x01, 0x00, 0x00, 0x00,
+				0x21, 0x00, 0x00, 0x00, 0x21, 0x00, 0x00, 0x00,
+
+				// LD V0, 0x00 jumped to 0x200 and holds the whole state.
+				0x15, 0x00, 0x02, 0x00, 0x60, 0x00, 0x00, 0xFF, 0xFF,
+				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+
+				// ADD V0, 0x01 follows on and changes V0.
+				0x08, 0x01, 0x70, 0x00, 0x01,
+
+				// SE V0, 0x03 changes nothing.
+				0x00, 0x03, 0x30,
+		};
+
+		std::remove(file_name);
+		ASSERT_EQ(sizeof expected, bytes.size());
+		EXPECT_EQ(0, memcmp(expected, bytes.data(), sizeof expected));
+		EXPECT_EQ(bytes.size(), recorder.GetBytesWritten());
+}
+
+TEST(TraceRecorder, Compress)
+{
+		std::vector<u8> input;
+		u32 seed = 1;
+
+		// Repeated records followed by noise that cannot be compressed.
+		for (u32 byte = 0; byte < 0x8000; ++byte)
+		{
+				input.push_back(static_cast<u8>(byte % 5 ? byte % 3 : 0x12));
+		}
+
+		for (u32 byte = 0; byte < 0x1000; ++byte)
+		{
+				seed = seed * 1103515245 + 12345;
+				input.push_back(static_cast<u8>(seed >> 16));
+		}
+
+		std::vector<u8> compressed(TraceRecorder::GetCompressBound(static_cast<u32>(input.size())));
+		std::vector<u8> output(input.size());
+		u32 compressed_size = TraceRecorder::Compress(input.data(), static_cast<u32>(input.size()), compressed.data());
+
+		EXPECT_GT(0x2000, compressed_size);
+		EXPECT_TRUE(TraceReader::Decompress(compressed.data(), compressed_size, output.data(), static_cast<u32>(output.size())));
+		EXPECT_EQ(input, output);
+}
+
+TEST(TraceRecorder, Open_Fails)
+{
+		TraceRecorder recorder;
+		Cpu cpu;
+
+		EXPECT_FALSE(recorder.Open("MissingDirectory/TraceRecorderTests.trace"));
+		EXPECT_FALSE(recorder.IsOpen());
+
+		// Running with a recorder that is not open records nothing.
+		cpu.LoadProgram(program, sizeof program);
+		cpu.Run(3, recorder);
+		EXPECT_EQ(0, recorder.GetRecords());
+		EXPECT_FALSE(recorder.Close());
+}
@@ -0,0 +1,70 @@
+#include <gtest\gtest.h>
+#include "../Chip8/TripleBuffer.h"
+#include <cstring>
+#include <thread>
+
+TEST(TripleBuffer, Acquire_Empty)
+{
+		TripleBuffer triple_buffer;
+
+		EXPECT_FALSE(triple_buffer.Acquire());
+}
+
+TEST(TripleBuffer, Acquire_Newest)
+{
+		TripleBuffer triple_buffer;
+
+		for (u64 number = 1; number <= 3; ++number)
+		{
+				triple_buffer.GetBack().number = number;
+				triple_buffer.Publish();
+		}
+
+		EXPECT_TRUE(triple_buffer.Acquire());
+		EXPECT_EQ(3, triple_buffer.GetFront().number);
+		EXPECT_FALSE(triple_buffer.Acquire());
+		EXPECT_EQ(3, triple_buffer.GetFront().number);
+}
+
+TEST(TripleBuffer, Publish_Threads)
+{
+		TripleBuffer triple_buffer;
+		const u64 frames = 100000;
+
+		std::thread producer([&]()
+		{
+				for (u64 number = 1; number <= frames; ++number)
+				{
+						TripleBuffer::Frame &frame = triple_buffer.GetBack();
+
+						memset(frame.pixels, static_cast<u8>(number), sizeof frame.pixels);
+
+						frame.number = number;
+						triple_buffer.Publish();
+				}
+		});
+
+		u64 last_number = 0;
+
+		while (last_number < frames)
+		{
+				if (!triple_buffer.Acquire())
+						continue;
+
+				const TripleBuffer::Frame &frame = triple_buffer.GetFront();
+
+				ASSERT_LT(last_number, frame.number);
+
+				for (auto &row : frame.pixels)
+				{
+						for (auto byte : row)
+						{
+								ASSERT_EQ(static_cast<u8>(frame.number), byte);
+						}
+				}
+
+				last_number = frame.number;
+		}
+
+		producer.join();
+}
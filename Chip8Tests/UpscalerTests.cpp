@@ -0,0 +1,135 @@
+#include <gtest\gtest.h>
+#include "../Chip8/Upscaler.h"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+		const u32 off = 0xFF000000;
+		const u32 on = 0xFFFFFFFF;
+
+		void SetPixel(TripleBuffer::Frame &frame, u8 x, u8 y)
+		{
+				frame.pixels[y][x / 8] |= 0x80 >> (x % 8);
+		}
+
+		std::vector<u32> Scale(const TripleBuffer::Frame &frame, Upscaler::Filter filter, u8 scale)
+		{
+				Upscaler upscaler;
+				u32 stride = Cpu::screen_width * scale;
+				std::vector<u32> pixels(stride * Cpu::screen_height * scale);
+
+				EXPECT_TRUE(upscaler.Scale(frame, filter, scale, pixels.data(), stride));
+
+				return pixels;
+		}
+}
+
+TEST(Upscaler, Scale_Nearest)
+{
+		TripleBuffer::Frame frame = {};
+		u32 stride = Cpu::screen_width * 2;
+
+		SetPixel(frame, 0, 0);
+		SetPixel(frame, 63, 31);
+
+		std::vector<u32> pixels = Scale(frame, Upscaler::Filter::nearest, 2);
+
+		EXPECT_EQ(on, pixels[0]);
+		EXPECT_EQ(on, pixels[1]);
+		EXPECT_EQ(on, pixels[stride]);
+		EXPECT_EQ(on, pixels[stride + 1]);
+		EXPECT_EQ(off, pixels[2]);
+		EXPECT_EQ(off, pixels[stride * 2]);
+		EXPECT_EQ(on, pixels.back());
+		EXPECT_EQ(off, pixels[pixels.size() - 3]);
+}
+
+// A diagonal step rounds off its inside corner.
+TEST(Upscaler, Scale_Scale2x)
+{
+		TripleBuffer::Frame frame = {};
+		u32 stride = Cpu::screen_width * 2;
+
+		SetPixel(frame, 1, 0);
+		SetPixel(frame, 0, 1);
+
+		std::vector<u32> pixels = Scale(frame, Upscaler::Filter::scale2x, 2);
+
+		EXPECT_EQ(on, pixels[2 * stride + 2]);
+		EXPECT_EQ(off, pixels[2 * stride + 3]);
+		EXPECT_EQ(off, pixels[3 * stride + 2]);
+		EXPECT_EQ(off, pixels[3 * stride + 3]);
+		EXPECT_EQ(on, pixels[2]);
+		EXPECT_EQ(on, pixels[3]);
+}
+
+TEST(Upscaler, Scale_Scale3x)
+{
+		TripleBuffer::Frame frame = {};
+		u32 stride = Cpu::screen_width * 3;
+
+		SetPixel(frame, 1, 0);
+		SetPixel(frame, 0, 1);
+
+		std::vector<u32> pixels = Scale(frame, Upscaler::Filter::scale3x, 3);
+
+		for (u32 y = 3; y < 6; ++y)
+		{
+				for (u32 x = 3; x < 6; ++x)
+				{
+						EXPECT_EQ(x == 3 && y == 3 ? on : off, pixels[y * stride + x]);
+				}
+		}
+}
+
+TEST(Upscaler, Scale_Multiple)
+{
+		TripleBuffer::Frame frame = {};
+		u32 stride = Cpu::screen_width * 2;
+		u32 scaled_stride = Cpu::screen_width * 4;
+
+		for (u8 y = 0; y < Cpu::screen_height; ++y)
+		{
+				for (u8 x = 0; x < Cpu::screen_width; ++x)
+				{
+						if ((x * 7 + y * 3) % 5 < 2)
+								SetPixel(frame, x, y);
+				}
+		}
+
+		std::vector<u32> pixels = Scale(frame, Upscaler::Filter::scale2x, 2);
+		std::vector<u32> scaled_pixels = Scale(frame, Upscaler::Filter::scale2x, 4);
+
+		for (u32 y = 0; y < Cpu::screen_height * 4u; ++y)
+		{
+				for (u32 x = 0; x < scaled_stride; ++x)
+				{
+						ASSERT_EQ(pixels[y / 2 * stride + x / 2], scaled_pixels[y * scaled_stride + x]);
+				}
+		}
+}
+
+TEST(Upscaler, Scale_InvalidScale)
+{
+		TripleBuffer::Frame frame = {};
+		Upscaler upscaler;
+		std::vector<u32> pixels(Cpu::screen_size * 81);
+
+		EXPECT_FALSE(upscaler.Scale(frame, Upscaler::Filter::scale2x, 3, pixels.data(), Cpu::screen_width * 3));
+		EXPECT_FALSE(upscaler.Scale(frame, Upscaler::Filter::nearest, 9, pixels.data(), Cpu::screen_width * 9));
+		EXPECT_FALSE(upscaler.Scale(frame, Upscaler::Filter::nearest, 0, pixels.data(), 0));
+}
+
+TEST(Upscaler, SetColors)
+{
+		TripleBuffer::Frame frame = {};
+		Upscaler upscaler;
+		u32 pixels[Cpu::screen_size];
+
+		SetPixel(frame, 0, 0);
+		upscaler.SetColors(0x12345678, 0x9ABCDEF0);
+		upscaler.Scale(frame, Upscaler::Filter::nearest, 1, pixels, Cpu::screen_width);
+		EXPECT_EQ(0x9ABCDEF0, pixels[0]);
+		EXPECT_EQ(0x12345678, pixels[1]);
+}
@@ -0,0 +1,47 @@
+#include <gtest\gtest.h>
+#include "../Chip8/WavSink.h"
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+TEST(WavSink, Write)
+{
+		WavSink wav_sink;
+		const char *file_name = "WavSinkTests.wav";
+		u8 samples[] = { 0x80, 0xA0, 0x60 };
+
+		EXPECT_TRUE(wav_sink.Open(file_name, 8000));
+		wav_sink.Write(samples, sizeof samples);
+		wav_sink.Write(samples, sizeof samples);
+		EXPECT_EQ(6, wav_sink.GetSamples());
+		EXPECT_TRUE(wav_sink.Close());
+		EXPECT_FALSE(wav_sink.IsOpen());
+
+		std::ifstream file(file_name, std::ios::binary);
+		std::vector<u8> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		file.close();
+		std::remove(file_name);
+		ASSERT_EQ(50, bytes.size());
+		EXPECT_EQ(0, memcmp(bytes.data(), "RIFF", 4));
+		EXPECT_EQ(42, bytes[4]);
+		EXPECT_EQ(0, memcmp(bytes.data() + 8, "WAVEfmt ", 8));
+		EXPECT_EQ(0x40, bytes[24]);
+		EXPECT_EQ(0x1F, bytes[25]);
+		EXPECT_EQ(8, bytes[34]);
+		EXPECT_EQ(0, memcmp(bytes.data() + 36, "data", 4));
+		EXPECT_EQ(6, bytes[40]);
+		EXPECT_EQ(0xA0, bytes[45]);
+}
+
+TEST(WavSink, Open_Fails)
+{
+		WavSink wav_sink;
+		u8 sample = 0x80;
+
+		EXPECT_FALSE(wav_sink.Open("missing directory/WavSinkTests.wav", 8000));
+		wav_sink.Write(&sample, 1);
+		EXPECT_EQ(0, wav_sink.GetSamples());
+		EXPECT_FALSE(wav_sink.Close());
+}